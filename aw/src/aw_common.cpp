@@ -1,12 +1,24 @@
 
 #include <stdexcept>
 #include <iostream>
-#include <stdexcept>
+#include <fstream>
+#include <limits>
+#include <algorithm>
 
 
 // Need this for getting user home directory when not set to HOME
 #include <pwd.h>
 
+// for memory mapping files
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 // Anything that includes common will need to include -l boost_filesystem -l boost_system to run the Env code here
 #include <boost/filesystem.hpp>
 
@@ -55,6 +67,310 @@ void print(SampleT* out, FrameSizeT size) {
     std::cout << '>' << std::endl;
 }
 
+OutputsSizeT checked_outputs_size(PIndexT count, FrameSizeT frame_size) {
+    // the bound is the largest vector of samples that might be allocated
+    const std::uint64_t limit {std::min<std::uint64_t>(VSampleT().max_size(),
+            std::numeric_limits<OutputsSizeT>::max())};
+    if (frame_size > limit || (count > 0 && frame_size > limit / count)) {
+        std::stringstream msg;
+        msg << "outputs of " << count << " x " << frame_size
+                << " samples exceed the maximum size"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::domain_error(msg.str());
+    }
+    return static_cast<OutputsSizeT>(count) * frame_size;
+}
+
+std::size_t get_sample_format_bytes(SampleFormat format) {
+    if (format == SampleFormat::PCM16) return 2;
+    else if (format == SampleFormat::PCM24) return 3;
+    else if (format == SampleFormat::Float32) return 4;
+    return sizeof(SampleT);
+}
+
+void encode_samples(const SampleT* src, UINT8* dst, std::size_t n,
+        SampleFormat format) {
+    if (format == SampleFormat::PCM16) {
+        std::int16_t* d = reinterpret_cast<std::int16_t*>(dst);
+        for (std::size_t i=0; i < n; ++i) {
+            d[i] = static_cast<std::int16_t>(std::max(-32768.0,
+                    std::min(32767.0, std::round(src[i] * 32768))));
+        }
+    }
+    else if (format == SampleFormat::PCM24) {
+        for (std::size_t i=0; i < n; ++i) {
+            std::int32_t v = static_cast<std::int32_t>(std::max(-8388608.0,
+                    std::min(8388607.0, std::round(src[i] * 8388608))));
+            dst[i * 3] = v & 0xFF;
+            dst[i * 3 + 1] = (v >> 8) & 0xFF;
+            dst[i * 3 + 2] = (v >> 16) & 0xFF;
+        }
+    }
+    else if (format == SampleFormat::Float32) {
+        to_float(src, reinterpret_cast<float*>(dst), n);
+    }
+    else {
+        std::copy(src, src + n, reinterpret_cast<SampleT*>(dst));
+    }
+}
+
+void decode_samples(const UINT8* src, SampleT* dst, std::size_t n,
+        SampleFormat format) {
+    std::size_t i {0};
+    if (format == SampleFormat::PCM16) {
+        const std::int16_t* s = reinterpret_cast<const std::int16_t*>(src);
+#ifdef __SSE2__
+        // eight at a time: sign extend to 32 bits, then convert pairs
+        const __m128d scale = _mm_set1_pd(1.0 / 32768);
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                    s + i));
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_pd(dst + i, _mm_mul_pd(_mm_cvtepi32_pd(lo), scale));
+            _mm_storeu_pd(dst + i + 2, _mm_mul_pd(
+                    _mm_cvtepi32_pd(_mm_srli_si128(lo, 8)), scale));
+            _mm_storeu_pd(dst + i + 4, _mm_mul_pd(_mm_cvtepi32_pd(hi), scale));
+            _mm_storeu_pd(dst + i + 6, _mm_mul_pd(
+                    _mm_cvtepi32_pd(_mm_srli_si128(hi, 8)), scale));
+        }
+#endif
+        for (; i < n; ++i) {
+            dst[i] = s[i] * (1.0 / 32768);
+        }
+    }
+    else if (format == SampleFormat::Float32) {
+        const float* s = reinterpret_cast<const float*>(src);
+#ifdef __SSE2__
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(s + i);
+            _mm_storeu_pd(dst + i, _mm_cvtps_pd(v));
+            _mm_storeu_pd(dst + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+        }
+#endif
+        for (; i < n; ++i) {
+            dst[i] = s[i];
+        }
+    }
+    else if (format == SampleFormat::PCM24) {
+        // packed three byte samples are not aligned for SSE2 loads
+        for (; i < n; ++i) {
+            dst[i] = decode_sample(src, i, format);
+        }
+    }
+    else {
+        const SampleT* s = reinterpret_cast<const SampleT*>(src);
+        std::copy(s, s + n, dst);
+    }
+}
+
+void to_float(const SampleT* src, float* dst, FrameSizeT n) {
+    FrameSizeT i {0};
+#ifdef __SSE2__
+    // four at a time: two pairs of doubles to one register of floats
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+        __m128 b = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+        _mm_storeu_ps(dst + i, _mm_movelh_ps(a, b));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = static_cast<float>(src[i]);
+    }
+}
+
+void interleave_to_float(const SampleT* const* src, PIndexT channels,
+        float* dst, FrameSizeT n) {
+    PIndexT c {0};
+#ifdef __SSE2__
+    // channels c and c+1 are written as adjacent floats in each frame
+    for (; c + 2 <= channels; c += 2) {
+        const SampleT* l = src[c];
+        const SampleT* r = src[c + 1];
+        float* d = dst + c;
+        FrameSizeT i {0};
+        for (; i + 2 <= n; i += 2) {
+            __m128d lv = _mm_loadu_pd(l + i);
+            __m128d rv = _mm_loadu_pd(r + i);
+            // (l0, r0) and (l1, r1)
+            _mm_storel_pi(reinterpret_cast<__m64*>(d),
+                    _mm_cvtpd_ps(_mm_unpacklo_pd(lv, rv)));
+            d += channels;
+            _mm_storel_pi(reinterpret_cast<__m64*>(d),
+                    _mm_cvtpd_ps(_mm_unpackhi_pd(lv, rv)));
+            d += channels;
+        }
+        for (; i < n; ++i) {
+            d[0] = static_cast<float>(l[i]);
+            d[1] = static_cast<float>(r[i]);
+            d += channels;
+        }
+    }
+#endif
+    for (; c < channels; ++c) {
+        const SampleT* s = src[c];
+        float* d = dst + c;
+        for (FrameSizeT i=0; i < n; ++i) {
+            *d = static_cast<float>(s[i]);
+            d += channels;
+        }
+    }
+}
+
+SampleT dot(const SampleT* a, const SampleT* b, std::size_t n) {
+    std::size_t i {0};
+    SampleT sum {0};
+#ifdef __SSE2__
+    // two accumulators of two doubles each
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i),
+                _mm_loadu_pd(b + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2),
+                _mm_loadu_pd(b + i + 2)));
+    }
+    s0 = _mm_add_pd(s0, s1);
+    double pair[2];
+    _mm_storeu_pd(pair, s0);
+    sum = pair[0] + pair[1];
+#endif
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// Taylor coefficients of sine, from x^21 down to x^3, for Horner evaluation in x^2; within +/- PI/2 the first omitted term is below 1e-18
+static const SampleT _sin_coefficients[10] {
+        1.0 / 51090942171709440000.0, // 21!
+        -1.0 / 121645100408832000.0,
+        1.0 / 355687428096000.0,
+        -1.0 / 1307674368000.0,
+        1.0 / 6227020800.0,
+        -1.0 / 39916800.0,
+        1.0 / 362880.0,
+        -1.0 / 5040.0,
+        1.0 / 120.0,
+        -1.0 / 6.0};
+
+SampleT const PI_HALF {PI * .5};
+
+//! The sine of a phase from 0 to PI2, with the same operations as the SSE2 path of sin_samples().
+inline SampleT _sin_phase(SampleT x) {
+    // sin(x) = -sin(x - PI), with x - PI within +/- PI; then fold into +/- PI/2, as sin(y) = sin(+/-PI - y)
+    SampleT y = x - PI;
+    if (std::fabs(y) > PI_HALF) {
+        y = std::copysign(PI, y) - y;
+    }
+    SampleT y2 = y * y;
+    SampleT p = _sin_coefficients[0];
+    for (std::size_t k=1; k < 10; ++k) {
+        p = p * y2 + _sin_coefficients[k];
+    }
+    return -(y + y * (y2 * p));
+}
+
+void sin_samples(const SampleT* src, SampleT* dst, std::size_t n) {
+    std::size_t i {0};
+#ifdef __SSE2__
+    const __m128d pi = _mm_set1_pd(PI);
+    const __m128d pi_half = _mm_set1_pd(PI_HALF);
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d y;
+    __m128d folded;
+    __m128d fold;
+    __m128d y2;
+    __m128d p;
+    for (; i + 2 <= n; i += 2) {
+        y = _mm_sub_pd(_mm_loadu_pd(src + i), pi);
+        // copysign(PI, y) - y where |y| > PI/2
+        folded = _mm_sub_pd(_mm_or_pd(pi, _mm_and_pd(sign, y)), y);
+        fold = _mm_cmpgt_pd(_mm_andnot_pd(sign, y), pi_half);
+        y = _mm_or_pd(_mm_and_pd(fold, folded), _mm_andnot_pd(fold, y));
+        y2 = _mm_mul_pd(y, y);
+        p = _mm_set1_pd(_sin_coefficients[0]);
+        for (std::size_t k=1; k < 10; ++k) {
+            p = _mm_add_pd(_mm_mul_pd(p, y2),
+                    _mm_set1_pd(_sin_coefficients[k]));
+        }
+        p = _mm_add_pd(y, _mm_mul_pd(y, _mm_mul_pd(y2, p)));
+        _mm_storeu_pd(dst + i, _mm_xor_pd(p, sign));
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = _sin_phase(src[i]);
+    }
+}
+
+void map_samples(const SampleT* src, const SampleT* src_lower,
+        const SampleT* src_upper, const SampleT* dst_lower,
+        const SampleT* dst_upper, SampleT* dst, std::size_t n) {
+    std::size_t i {0};
+#ifdef __SSE2__
+    // each comparison selects as the scalar code below, such that results are identical
+    const __m128d zero = _mm_setzero_pd();
+    __m128d lower;
+    __m128d upper;
+    __m128d m;
+    __m128d v_min_src;
+    __m128d v_max_src;
+    __m128d v_min_dst;
+    __m128d v_max_dst;
+    __m128d v;
+    __m128d v_range_src;
+    __m128d v_range_dst;
+    for (; i + 2 <= n; i += 2) {
+        lower = _mm_loadu_pd(src_lower + i);
+        upper = _mm_loadu_pd(src_upper + i);
+        m = _mm_cmplt_pd(upper, lower);
+        v_min_src = _mm_or_pd(_mm_and_pd(m, upper), _mm_andnot_pd(m, lower));
+        v_max_src = _mm_or_pd(_mm_and_pd(m, lower), _mm_andnot_pd(m, upper));
+        lower = _mm_loadu_pd(dst_lower + i);
+        upper = _mm_loadu_pd(dst_upper + i);
+        m = _mm_cmplt_pd(upper, lower);
+        v_min_dst = _mm_or_pd(_mm_and_pd(m, upper), _mm_andnot_pd(m, lower));
+        v_max_dst = _mm_or_pd(_mm_and_pd(m, lower), _mm_andnot_pd(m, upper));
+        // clip the source
+        v = _mm_loadu_pd(src + i);
+        m = _mm_cmpge_pd(v, v_max_src);
+        v = _mm_or_pd(_mm_and_pd(m, v_max_src), _mm_andnot_pd(m, v));
+        m = _mm_cmple_pd(_mm_loadu_pd(src + i), v_min_src);
+        v = _mm_or_pd(_mm_and_pd(m, v_min_src), _mm_andnot_pd(m, v));
+        v_range_src = _mm_sub_pd(v_max_src, v_min_src);
+        v_range_dst = _mm_sub_pd(v_max_dst, v_min_dst);
+        // a zero range divides by zero here, but that value is not selected
+        v = _mm_add_pd(_mm_mul_pd(_mm_div_pd(_mm_sub_pd(v, v_min_src),
+                v_range_src), v_range_dst), v_min_dst);
+        m = _mm_and_pd(_mm_cmpneq_pd(v_range_src, zero),
+                _mm_cmpneq_pd(v_range_dst, zero));
+        _mm_storeu_pd(dst + i, _mm_or_pd(_mm_and_pd(m, v),
+                _mm_andnot_pd(m, v_min_dst)));
+    }
+#endif
+    SampleT min_src;
+    SampleT max_src;
+    SampleT min_dst;
+    SampleT max_dst;
+    SampleT limit_src;
+    SampleT range_src;
+    SampleT range_dst;
+    for (; i < n; ++i) {
+        true_min_max(src_lower[i], src_upper[i], &min_src, &max_src);
+        true_min_max(dst_lower[i], dst_upper[i], &min_dst, &max_dst);
+        limit_src = double_limiter(src[i], min_src, max_src);
+        range_src = max_src - min_src;
+        range_dst = max_dst - min_dst;
+        if (range_src != 0 && range_dst != 0) {
+            dst[i] = (((limit_src - min_src) / range_src) * range_dst) +
+                    min_dst;
+        }
+        else {
+            dst[i] = min_dst;
+        }
+    }
+}
+
 const char* get_fp_home() {
     // do not need anyimport to use getnev
     const char* homeDir = getenv("HOME");
@@ -82,7 +398,7 @@ const char* get_fp_home() {
 
 
 // must initialize private static member attribute in impl file
-Random::Core Random::core = Random::Core();
+thread_local Random::Core Random::core = Random::Core();
 
 // must initialize private static member attribute in impl file
 EnvPtr Env::_default_env = nullptr;
@@ -94,6 +410,24 @@ Env :: Env(FrameSizeT fs)
     _load_defaults(); // file paths, not frame size
 }
 
+IOPool& Env :: get_io_pool() const {
+    std::lock_guard<std::mutex> lock(_pool_mutex);
+    if (!_io_pool) {
+        std::size_t n = std::max(2u, std::thread::hardware_concurrency());
+        _io_pool.reset(new IOPool(n));
+    }
+    return *_io_pool;
+}
+
+IOPool& Env :: get_render_pool() const {
+    std::lock_guard<std::mutex> lock(_pool_mutex);
+    if (!_render_pool) {
+        std::size_t n = std::max(1u, std::thread::hardware_concurrency());
+        _render_pool.reset(new IOPool(n));
+    }
+    return *_render_pool;
+}
+
 EnvPtr Env :: make_with_frame_size(FrameSizeT fs) {
     // static method
     return EnvPtr(new Env(fs));
@@ -132,6 +466,259 @@ std::string Env :: get_fp_temp(std::string name) const {
     return (_temp_directory / name).string();
 }
 
+std::string Env :: get_fp_cache(std::string name) const {
+    boost::filesystem::path dir = _temp_directory / "cache";
+    if (not boost::filesystem::exists(dir)) {
+        boost::system::error_code ec;
+        // another process may create it at the same time
+        boost::filesystem::create_directory(dir, ec);
+        if (not boost::filesystem::exists(dir)) {
+            throw std::invalid_argument("cannot create directory: " + 
+                    dir.string());
+        }
+    }
+    return (dir / name).string();
+}
+
+
+
+//-----------------------------------------------------------------------------
+void StateBlob :: write_to_fp(const std::string& fp) const {
+    std::ofstream f(fp, std::ios::binary | std::ios::trunc);
+    f.write(reinterpret_cast<const char*>(_bytes.data()), _bytes.size());
+    if (!f) {
+        std::stringstream msg;
+        msg << "could not write state to: " << fp
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+void StateBlob :: read_from_fp(const std::string& fp) {
+    std::ifstream f(fp, std::ios::binary);
+    if (!f) {
+        std::stringstream msg;
+        msg << "could not read state from: " << fp
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    _bytes.assign(std::istreambuf_iterator<char>(f),
+            std::istreambuf_iterator<char>());
+    _pos = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+//! The zeroth order modified Bessel function of the first kind, for the Kaiser window.
+inline double bessel_i0(double x) {
+    double sum {1};
+    double term {1};
+    for (int k=1; k < 50; ++k) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-17) break;
+    }
+    return sum;
+}
+
+PolyphaseResampler :: PolyphaseResampler(ResampleQuality q)
+    : _quality{q} {
+    double beta;
+    if (q == ResampleQuality::Low) {
+        _zero_crossings = 4;
+        _resolution = 128;
+        _rolloff = .85;
+        beta = 5;
+    }
+    else if (q == ResampleQuality::High) {
+        _zero_crossings = 32;
+        _resolution = 1024;
+        _rolloff = .97;
+        beta = 10;
+    }
+    else { // None is treated as Medium, as conversion is requested
+        _zero_crossings = 16;
+        _resolution = 512;
+        _rolloff = .94;
+        beta = 8;
+    }
+    std::size_t size = _zero_crossings * _resolution;
+    _table.resize(size + 2, 0);
+    double i0_beta = bessel_i0(beta);
+    for (std::size_t i=0; i <= size; ++i) {
+        double u = static_cast<double>(i) / _resolution;
+        double r = u / _zero_crossings;
+        double w = bessel_i0(beta * std::sqrt(std::max(0.0, 1 - r * r)))
+                / i0_beta;
+        double sinc = i == 0 ? 1 : std::sin(PI * u) / (PI * u);
+        _table[i] = sinc * w;
+    }
+    // the last two are zero, such that interpolation at the end is safe
+    _table[size] = 0;
+}
+
+SampleT PolyphaseResampler :: _kernel(double t, double cutoff) const {
+    double u = std::abs(t) * cutoff * _resolution;
+    std::size_t i = static_cast<std::size_t>(u);
+    if (i >= _table.size() - 1) return 0;
+    double frac = u - i;
+    return cutoff * (_table[i] + frac * (_table[i + 1] - _table[i]));
+}
+
+std::size_t PolyphaseResampler :: get_reach(double cutoff) const {
+    return static_cast<std::size_t>(std::ceil(_zero_crossings / cutoff)) + 1;
+}
+
+double PolyphaseResampler :: get_cutoff(double input_per_output) const {
+    // above a ratio of 1, the output Nyquist is lower
+    return _rolloff * (input_per_output > 1 ? 1 / input_per_output : 1);
+}
+
+SampleT PolyphaseResampler :: interpolate(const SampleT* x, double pos,
+        double cutoff) const {
+    std::int64_t center = static_cast<std::int64_t>(std::floor(pos));
+    std::int64_t reach = get_reach(cutoff);
+    SampleT sum {0};
+    SampleT weights {0};
+    SampleT w;
+    for (std::int64_t n = center - reach + 1; n <= center + reach; ++n) {
+        w = _kernel(pos - n, cutoff);
+        sum += x[n] * w;
+        weights += w;
+    }
+    // normalize for unity gain at DC
+    return weights == 0 ? 0 : sum / weights;
+}
+
+std::uint64_t PolyphaseResampler :: get_output_size(std::uint64_t n,
+        OutputsSizeT src_rate, OutputsSizeT dst_rate) {
+    return (n * dst_rate + src_rate - 1) / src_rate;
+}
+
+void PolyphaseResampler :: convert(const SampleT* src, std::uint64_t n,
+        OutputsSizeT src_rate, OutputsSizeT dst_rate, VSampleT& dst) const {
+    if (src_rate == 0 || dst_rate == 0) {
+        std::stringstream msg;
+        msg << "sampling rates must be greater than zero"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    std::uint64_t out_n = get_output_size(n, src_rate, dst_rate);
+    dst.assign(out_n, 0);
+    if (n == 0) return;
+    // reduce the ratio: output m is at input position m * down / up
+    std::uint64_t a = src_rate;
+    std::uint64_t b = dst_rate;
+    while (b != 0) {
+        std::uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    std::uint64_t up = dst_rate / a;
+    std::uint64_t down = src_rate / a;
+    double cutoff = get_cutoff(static_cast<double>(src_rate) / dst_rate);
+    std::int64_t reach = get_reach(cutoff);
+    // zero padded on both sides, such that no bounds are checked
+    VSampleT padded(n + (2 * reach) + 1, 0);
+    std::copy(src, src + n, padded.begin() + reach);
+    const SampleT* x = padded.data() + reach;
+
+    if (up > _max_phases) {
+        for (std::uint64_t m=0; m < out_n; ++m) {
+            double pos = static_cast<double>(m) * src_rate / dst_rate;
+            dst[m] = interpolate(x, pos, cutoff);
+        }
+        return;
+    }
+    // one row of taps for each phase, normalized for unity gain at DC
+    std::size_t taps = 2 * reach;
+    VSampleT bank(up * taps, 0);
+    for (std::uint64_t p=0; p < up; ++p) {
+        double frac = static_cast<double>(p) / up;
+        SampleT* row = bank.data() + (p * taps);
+        SampleT weights {0};
+        for (std::size_t k=0; k < taps; ++k) {
+            // tap k reads input center - reach + 1 + k
+            row[k] = _kernel(frac + reach - 1 - static_cast<double>(k),
+                    cutoff);
+            weights += row[k];
+        }
+        if (weights != 0) {
+            for (std::size_t k=0; k < taps; ++k) {
+                row[k] /= weights;
+            }
+        }
+    }
+    std::uint64_t center {0};
+    std::uint64_t phase {0};
+    for (std::uint64_t m=0; m < out_n; ++m) {
+        dst[m] = dot(bank.data() + (phase * taps), x + center - reach + 1,
+                taps);
+        // advance by down / up input samples
+        phase += down;
+        center += phase / up;
+        phase %= up;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+IOPool :: IOPool(std::size_t threads) {
+    for (std::size_t i=0; i < std::max(threads, std::size_t(1)); ++i) {
+        _threads.push_back(std::thread(&IOPool::_run, this));
+    }
+}
+
+IOPool :: ~IOPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _ready.notify_all();
+    for (auto& t : _threads) {
+        t.join();
+    }
+}
+
+void IOPool :: _run() {
+    std::function<void()> task;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _ready.wait(lock, [this](){return _stopping || !_tasks.empty();});
+            if (_tasks.empty()) return; // only when stopping
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+        // exceptions are stored in the task's future
+        task();
+    }
+}
+
+//-----------------------------------------------------------------------------
+MappedFile :: MappedFile(const std::string& fp) {
+    int fd = open(fp.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            _data = static_cast<const UINT8*>(p);
+            _size = st.st_size;
+        }
+    }
+    // the mapping remains valid after closing
+    close(fd);
+}
+
+MappedFile :: ~MappedFile() {
+    if (_data != nullptr) {
+        munmap(const_cast<UINT8*>(_data), _size);
+    }
+}
+
 
 } // end namespace aw
 
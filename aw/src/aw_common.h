@@ -14,6 +14,15 @@
 #include <unordered_map>
 #include <initializer_list>
 #include <random>
+#include <atomic>
+#include <stdexcept>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
 
 #include <boost/filesystem.hpp>
 #include <boost/exception/all.hpp> // needed for filesystem?
@@ -44,11 +53,11 @@ typedef std::vector<VSampleT> VVSampleT;
 
     
 //! The size of a single frame (or vector), or the number of samples processed per computation cycle or stored in a single channel of output data. This is a very large integer as we might need to accomodate loading in large audio files as a single frame.
-// 32 bit int is 2,147,483,647, which gives over 13.5 hours at 44.1 sr
-typedef std::uint32_t FrameSizeT;
+// 32 bit int gave only about 27 hours at 44.1 sr; 64 bit is unbounded in practice
+typedef std::uint64_t FrameSizeT;
 
-//! Output size. Was uint16_t, but for handling audio files was increased to uint32_t. In general, the outputs is the frame size times the number of outputs, so outputs is always greater than or equal to frame size. 
-typedef std::uint32_t OutputsSizeT;
+//! Output size. Was uint16_t, then uint32_t; increased to uint64_t as multi-channel files of multiple days exceed 4G samples. In general, the outputs is the frame size times the number of outputs, so outputs is always greater than or equal to frame size. 
+typedef std::uint64_t OutputsSizeT;
 
 
 //! An unsigned integer to represent the position of a parameter type, i.e., an input or output position. Assumed to never have more thean 200 parameter inputs for a Gen.
@@ -60,12 +69,18 @@ typedef std::vector<PIndexT> VPIndexT;
 //! A vector of frame size types. This is used for offsets into the outputs.
 typedef std::vector<FrameSizeT> VFrameSizeType;
 
+//! A vector of vectors of frame size types. This is used for per-output lists of sample offsets, such as trigger events.
+typedef std::vector<VFrameSizeType> VVFrameSizeType;
+
 //! A small unsigned interger for specialized cases. 
 typedef std::uint8_t UINT8; 
 
 //! An unsigned integer for each Gen that counts the number of frames that have passed; this number needs to be very large and overflow gracefully. 
 typedef std::uint64_t RenderCountT; 
 
+//! An absolute position in time measured in samples from the start of rendering (the first sample of render count 1 is sample 0). 
+typedef std::uint64_t SampleTimeT;
+
 
 
 // TODO: replace with a SharedGenerator: but, we need a SharedGenerator to be hashable, which requires us to extend std::hash or similar
@@ -161,6 +176,67 @@ void escape(std::string& str,
 //! Print an arry of SampleT of size type FrameSizeT.
 void print(SampleT* out, FrameSizeT size);
 
+//! Return the count of samples in count outputs of frame_size, raising if the product cannot be stored in OutputsSizeT or allocated.
+OutputsSizeT checked_outputs_size(PIndexT count, FrameSizeT frame_size);
+
+//! Sample encodings, for writing sound files and for compact storage of samples.
+enum class SampleFormat {
+    PCM16,
+    PCM24,
+    Float32,
+    Float64,
+};
+
+//! Return the number of bytes of a sample encoded as format.
+std::size_t get_sample_format_bytes(SampleFormat format);
+
+//! Encode n samples as format into dst, which holds n * get_sample_format_bytes(format) bytes. Integer encodings are scaled by their greatest magnitude and clipped.
+void encode_samples(const SampleT* src, UINT8* dst, std::size_t n,
+        SampleFormat format);
+
+//! Decode n samples encoded as format into dst. Uses SSE2, when available, for 16-bit and 32-bit float encodings.
+void decode_samples(const UINT8* src, SampleT* dst, std::size_t n,
+        SampleFormat format);
+
+//! Return a single decoded sample at index i.
+inline SampleT decode_sample(const UINT8* src, std::size_t i,
+        SampleFormat format) {
+    if (format == SampleFormat::PCM16) {
+        return reinterpret_cast<const std::int16_t*>(src)[i] * (1.0 / 32768);
+    }
+    else if (format == SampleFormat::Float32) {
+        return reinterpret_cast<const float*>(src)[i];
+    }
+    else if (format == SampleFormat::PCM24) {
+        const UINT8* p = src + (i * 3);
+        // sign extend from the high byte
+        std::int32_t v = static_cast<std::int32_t>(
+                (static_cast<std::uint32_t>(p[0]) << 8) |
+                (static_cast<std::uint32_t>(p[1]) << 16) |
+                (static_cast<std::uint32_t>(p[2]) << 24)) >> 8;
+        return v * (1.0 / 8388608);
+    }
+    return reinterpret_cast<const SampleT*>(src)[i];
+}
+
+//! Convert n samples to 32-bit floats, as used by audio devices and files. Uses SSE2 when available.
+void to_float(const SampleT* src, float* dst, FrameSizeT n);
+
+//! Interleave n samples from each of channels source arrays into dst as 32-bit floats, such that dst holds n * channels values. The same source may be given for more than one channel. Uses SSE2 when available, converting and interleaving pairs of channels at once.
+void interleave_to_float(const SampleT* const* src, PIndexT channels,
+        float* dst, FrameSizeT n);
+
+//! Return the sum of the products of n pairs of samples. Uses SSE2 when available.
+SampleT dot(const SampleT* a, const SampleT* b, std::size_t n);
+
+//! Write the sine of n phases, each in radians from 0 to PI2, to dst, which may be src. A polynomial is used rather than sin(), with an absolute error below 1e-15; results are the same with or without SSE2, which, when available, computes two at once.
+void sin_samples(const SampleT* src, SampleT* dst, std::size_t n);
+
+//! Map n samples of src, clipped to the range of src_lower and src_upper, to the range of dst_lower and dst_upper, writing to dst; each boundary is read for each sample, and may be given in either order. Where either range is zero, dst is the lesser destination boundary. Results are those of Map; uses SSE2, when available, to map two at once.
+void map_samples(const SampleT* src, const SampleT* src_lower,
+        const SampleT* src_upper, const SampleT* dst_lower,
+        const SampleT* dst_upper, SampleT* dst, std::size_t n);
+
 //! Return the users home directory as a const char pointer. This is what is returned by low-level calls, and is thus returned here to reduce creating temporary objects.
 const char* get_fp_home();
 
@@ -330,7 +406,7 @@ class Random {
     private://-----------------------------------------------------------------
     public://-------------------------------------------------------------------
 
-    //! Struct storage of core engines and distributions, shared across by a single static instance.
+    //! Struct storage of core engines and distributions, shared across by a single static instance for each thread.
     struct Core {
         // basic and high-precision engeinges
         std::minstd_rand re_lin_congruential {std::random_device{}()};
@@ -345,8 +421,8 @@ class Random {
 
     };
 
-    //! Core random engines and distributions, shared by a single static attribute. Init in implementation file.
-    static Core core;
+    //! Core random engines and distributions, shared by a single static attribute for each thread, such that Gens rendering on different threads do not share an engine. Init in implementation file.
+    static thread_local Core core;
 
     //! A random unform distribution between 0 and 1. 
     static inline SampleT uniform() {
@@ -383,6 +459,113 @@ class Random {
 
 
 
+//! Quality levels of a PolyphaseResampler. Higher levels use longer filters, with less aliasing and a narrower transition band, at greater cost. None disables automatic conversion where a quality is selected.
+enum class ResampleQuality {
+    None,
+    Low,
+    Medium,
+    High,
+};
+
+//! A band-limited resampler using a Kaiser-windowed sinc kernel. The kernel is tabulated once for a quality; when converting between rates whose ratio reduces to a small fraction, it is expanded into a polyphase filter bank, such that each output sample is a dot product of contiguous samples and taps. For arbitrary or time-varying ratios, interpolate() evaluates the kernel from the table at any position. When lowering the rate, the cutoff is lowered to the new Nyquist frequency.
+class PolyphaseResampler {
+    private: //-----------------------------------------------------
+
+    ResampleQuality _quality;
+
+    //! Zero crossings of the kernel on each side, at a cutoff of 1.
+    std::size_t _zero_crossings;
+
+    //! Table entries per zero crossing.
+    std::size_t _resolution;
+
+    //! The fraction of the lower Nyquist frequency passed.
+    double _rolloff;
+
+    //! One side of the kernel at a cutoff of 1, from 0 to _zero_crossings, with a final zero.
+    VSampleT _table;
+
+    //! The most phases for which a filter bank is built.
+    static const std::uint64_t _max_phases {4096};
+
+    //! Return the kernel at t input samples from center, at cutoff (scaled by the cutoff).
+    SampleT _kernel(double t, double cutoff) const;
+
+    public: //--------------------------------------------------------
+
+    explicit PolyphaseResampler(ResampleQuality q=ResampleQuality::Medium);
+
+    ResampleQuality get_quality() const {return _quality;};
+
+    //! Return the number of input samples needed on each side of a position for cutoff (0, 1].
+    std::size_t get_reach(double cutoff) const;
+
+    //! Return the cutoff for a ratio of input to output rate.
+    double get_cutoff(double input_per_output) const;
+
+    //! Interpolate x at fractional position pos with a cutoff; x must be valid get_reach(cutoff) samples before and after pos.
+    SampleT interpolate(const SampleT* x, double pos, double cutoff) const;
+
+    //! Return the number of samples produced when converting n samples from src_rate to dst_rate.
+    static std::uint64_t get_output_size(std::uint64_t n,
+            OutputsSizeT src_rate, OutputsSizeT dst_rate);
+
+    //! Convert n samples from src_rate to dst_rate into dst, which is resized to get_output_size(). Samples before and after the source are taken as zero.
+    void convert(const SampleT* src, std::uint64_t n, OutputsSizeT src_rate,
+            OutputsSizeT dst_rate, VSampleT& dst) const;
+
+};
+
+
+//! A pool of threads for blocking file operations, such that several files are read at once, or for rendering independent Gen networks at once. Tasks are started in the order submitted. The destructor completes queued tasks and joins the threads.
+class IOPool {
+    private: //-----------------------------------------------------
+
+    std::vector<std::thread> _threads;
+
+    std::deque<std::function<void()>> _tasks;
+
+    std::mutex _mutex;
+
+    std::condition_variable _ready;
+
+    bool _stopping {false};
+
+    //! The loop of each thread.
+    void _run();
+
+    public: //--------------------------------------------------------
+
+    IOPool() = delete;
+
+    IOPool(const IOPool&) = delete;
+    IOPool& operator=(const IOPool&) = delete;
+
+    //! Start threads; at least one.
+    explicit IOPool(std::size_t threads);
+
+    ~IOPool();
+
+    //! Queue a callable for a thread of the pool. The returned future becomes ready with its result, or its exception, when it completes.
+    template <typename F>
+    auto submit(F f) -> std::future<decltype(f())> {
+        typedef decltype(f()) R;
+        auto t = std::make_shared<std::packaged_task<R()>>(std::move(f));
+        std::future<R> r = t->get_future();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push_back([t](){(*t)();});
+        }
+        _ready.notify_one();
+        return r;
+    }
+
+    //! Return the number of threads.
+    std::size_t get_thread_count() const {return _threads.size();};
+
+};
+
+
 class Env;
 //! The shared Env is always const: it cannot be changed from the outside.
 typedef std::shared_ptr<const Env> EnvPtr;
@@ -405,6 +588,13 @@ class Env {
     //! We store a static (class wid) default environment that is used and set. 
     static EnvPtr _default_env;
 
+    //! The pool for file operations, created on first use.
+    mutable std::unique_ptr<IOPool> _io_pool;
+
+    //! The pool for rendering, created on first use; separate such that renders do not wait on file operations.
+    mutable std::unique_ptr<IOPool> _render_pool;
+    mutable std::mutex _pool_mutex;
+
     public://-------------------------------------------------------------------
     
     explicit Env(FrameSizeT fs);
@@ -430,6 +620,15 @@ class Env {
     //! Return the common (or shared) frame size. 
     FrameSizeT get_common_frame_size() const {return _common_frame_size;};
 
+	//! Return a file path in the cache directory, a subdirectory of the temporary directory created on demand, where decoded sound files are stored for reuse.
+    std::string get_fp_cache(std::string name) const;
+
+    //! Return the pool of threads used for file operations, such as asynchronous buffer loads; created on first use, with a thread for each hardware thread (at least two).
+    IOPool& get_io_pool() const;
+
+    //! Return the pool of threads used for rendering independent Gen networks at once, such as the channels of a SamplesBuffer; created on first use, with a thread for each hardware thread.
+    IOPool& get_render_pool() const;
+
 	//! This returns a file path in the environment-specified temporary directory. By default this is in the user directory .arachnewaro. This returns a string for easier compatibility with clients, rather than a Boost file path
     std::string get_fp_temp(std::string name) const;
 
@@ -507,12 +706,215 @@ class Inj {
             post.push_back(x);
         }
     }
+
+    //! Fill post with a vector for each channel.
+    void fill_planar(std::vector<std::vector<T>>& post) const {
+        OutputsSizeT frames = get_frame_size();
+        post.assign(_channels, std::vector<T>(frames));
+        for (OutputsSizeT i=0; i < frames; ++i) {
+            for (PIndexT c=0; c < _channels; ++c) {
+                post[c][i] = _parsed[i * _channels + c];
+            }
+        }
+    }
     
 };
 
 
 
 
+//! A fixed-capacity, wait-free ring for passing values from exactly one producer thread to exactly one consumer thread. All storage is allocated at creation. Values are exchanged (swapped) into and out of the ring rather than copied, such that neither push() nor pop() allocates or destroys; a value passed to push() receives the (empty) contents of the ring storage it replaces.
+template <typename T>
+class SPSCRing {
+    private: //-----------------------------------------------------
+
+    //! Storage has one more position than the capacity, such that a full ring can be distinguished from an empty one.
+    std::vector<T> _storage;
+
+    std::size_t _size;
+
+    //! The next position to read; only written by the consumer.
+    std::atomic<std::size_t> _head;
+
+    //! The next position to write; only written by the producer.
+    std::atomic<std::size_t> _tail;
+
+    public: //--------------------------------------------------------
+
+    SPSCRing() = delete;
+
+    explicit SPSCRing(std::size_t capacity)
+        : _storage(capacity + 1),
+        _size{capacity + 1},
+        _head{0},
+        _tail{0} {
+    }
+
+    //! Create a ring with all storage initialized to copies of prototype; useful for values that own storage, such as sized vectors, such that circulating values keep their size.
+    SPSCRing(std::size_t capacity, const T& prototype)
+        : _storage(capacity + 1, prototype),
+        _size{capacity + 1},
+        _head{0},
+        _tail{0} {
+    }
+
+    //! Producer only: move v into the ring. Returns false, leaving v unchanged, if the ring is full.
+    bool push(T& v) {
+        std::size_t tail = _tail.load(std::memory_order_relaxed);
+        std::size_t next = tail + 1 == _size ? 0 : tail + 1;
+        if (next == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::swap(_storage[tail], v);
+        _tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    //! Consumer only: move the oldest value into v. Returns false, leaving v unchanged, if the ring is empty.
+    bool pop(T& v) {
+        std::size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::swap(_storage[head], v);
+        _head.store(head + 1 == _size ? 0 : head + 1,
+                std::memory_order_release);
+        return true;
+    }
+
+    //! Return the number of values in the ring. Exact only when called from the producer or the consumer while the other is idle; otherwise a snapshot.
+    std::size_t size() const {
+        std::size_t head = _head.load(std::memory_order_acquire);
+        std::size_t tail = _tail.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : tail + _size - head;
+    }
+
+    //! Return the maximum number of values that can be held.
+    std::size_t capacity() const {return _size - 1;};
+
+};
+
+
+
+//! A compact binary buffer of internal state, written and read in order. Values are stored as their raw bytes in native byte order, such that a blob is only portable between builds of the same platform. Reading past the end throws.
+class StateBlob {
+    private: //-----------------------------------------------------
+
+    std::vector<UINT8> _bytes;
+
+    //! The next position to read.
+    std::size_t _pos {0};
+
+    void _check_available(std::size_t n) const {
+        if (_pos + n > _bytes.size()) {
+            std::stringstream msg;
+            msg << "state blob is truncated: " << n
+                    << " bytes requested at position " << _pos
+                    << str_file_line(__FILE__, __LINE__);
+            throw std::invalid_argument(msg.str());
+        }
+    }
+
+    public: //--------------------------------------------------------
+
+    //! Append a trivial value.
+    template <typename T>
+    void put(const T& v) {
+        static_assert(std::is_trivial<T>::value,
+                "only trivial types can be stored as raw bytes");
+        const UINT8* p = reinterpret_cast<const UINT8*>(&v);
+        _bytes.insert(_bytes.end(), p, p + sizeof(T));
+    }
+
+    //! Read the next value into v.
+    template <typename T>
+    void get(T& v) {
+        static_assert(std::is_trivial<T>::value,
+                "only trivial types can be stored as raw bytes");
+        _check_available(sizeof(T));
+        std::copy(_bytes.begin() + _pos, _bytes.begin() + _pos + sizeof(T),
+                reinterpret_cast<UINT8*>(&v));
+        _pos += sizeof(T);
+    }
+
+    //! Append a vector of trivial values, preceded by its size.
+    template <typename T>
+    void put_vector(const std::vector<T>& v) {
+        put(static_cast<std::uint64_t>(v.size()));
+        for (const T& x : v) put(x);
+    }
+
+    //! Read a vector written with put_vector() into v, resizing v if necessary.
+    template <typename T>
+    void get_vector(std::vector<T>& v) {
+        std::uint64_t size;
+        get(size);
+        _check_available(size * sizeof(T));
+        v.resize(size);
+        for (T& x : v) get(x);
+    }
+
+    //! Append all bytes of another blob, preceded by their size.
+    void put_blob(const StateBlob& other) {
+        put_vector(other._bytes);
+    }
+
+    //! Read a blob written with put_blob() into other, rewound.
+    void get_blob(StateBlob& other) {
+        get_vector(other._bytes);
+        other._pos = 0;
+    }
+
+    //! Move the read position to the start.
+    void rewind() {_pos = 0;};
+
+    //! Return true if all bytes have been read.
+    bool at_end() const {return _pos == _bytes.size();};
+
+    //! Return the number of bytes stored.
+    std::size_t size() const {return _bytes.size();};
+
+    //! Write all bytes to a file path, replacing any existing file.
+    void write_to_fp(const std::string& fp) const;
+
+    //! Replace the contents with the bytes of a file path, and rewind.
+    void read_from_fp(const std::string& fp);
+
+};
+
+
+
+//! A read-only memory mapping of a whole file. Pages are loaded on demand and shared, through the page cache, by all mappings of the same file in any process. The mapping is released on destruction.
+class MappedFile {
+    private: //-----------------------------------------------------
+
+    const UINT8* _data {nullptr};
+
+    std::size_t _size {0};
+
+    public: //--------------------------------------------------------
+
+    MappedFile() = delete;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //! Map the file at fp. If it does not exist, is empty, or cannot be mapped, the mapping is invalid, and data() returns nullptr.
+    explicit MappedFile(const std::string& fp);
+
+    ~MappedFile();
+
+    //! Return true if the file is mapped.
+    bool is_valid() const {return _data != nullptr;};
+
+    const UINT8* data() const {return _data;};
+
+    std::size_t size() const {return _size;};
+
+};
+
+
+
 //! A simple struct to support returning simple error messages from functions that cannot raise exception
 struct Validity {
 
@@ -6,6 +6,9 @@
 #include <vector>
 #include <cassert>
 #include <functional>
+#include <chrono>
+#include <fstream>
+#include <limits>
 
 // needed for SecondsBuffer
 #include <sndfile.hh>
@@ -267,6 +270,31 @@ void DirectedIndex :: set_direction(PTypeDirection::Opt d) {
     }
 }
 
+void DirectedIndex :: write_state(StateBlob& b) const {
+    b.put(_size);
+    b.put(_last_value);
+    b.put(_temp_value);
+    b.put(_forward);
+    b.put(_direction);
+    b.put_vector(_indices);
+}
+
+void DirectedIndex :: read_state(StateBlob& b) {
+    FrameSizeT size;
+    b.get(size);
+    if (size != _size) {
+        std::stringstream msg;
+        msg << "state is for a DirectedIndex of a different size: " << size
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    b.get(_last_value);
+    b.get(_temp_value);
+    b.get(_forward);
+    b.get(_direction);
+    b.get_vector(_indices);
+}
+
 FrameSizeT DirectedIndex :: next() {
     // handle trivial case of size of 1
     if (_size == 1) {
@@ -400,6 +428,15 @@ GenPtr Gen :: make_with_environment(GenID q, EnvPtr e) {
     else if (q == GenID::Sequencer) {
         g = SequencerPtr(new Sequencer(e));
     }        
+    else if (q == GenID::FilePlayer) {
+        g = FilePlayerPtr(new FilePlayer(e));
+    }
+    else if (q == GenID::Resampler) {
+        g = ResamplerPtr(new Resampler(e));
+    }
+    else if (q == GenID::VoiceAllocator) {
+        g = VoiceAllocatorPtr(new VoiceAllocator(e));
+    }
     else {
         std::stringstream msg;
         msg << "no matching GenID" << str_file_line(__FILE__, __LINE__);
@@ -425,6 +462,23 @@ GenPtr Gen :: make(SampleT v){
 }
 
 
+GenPtr Gen :: make_lanes(const VSampleT& values){
+    if (values.empty()) {
+        std::stringstream msg;
+        msg << "at least one lane value is required"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    EnvPtr e = Env::get_default_env();
+    GenPtr g = make_with_environment(GenID::Add, e);
+    g->set_lane_count(values.size());
+    for (PIndexT i=0; i < values.size(); ++i) {
+        g->add_input_by_index(i, values[i]);
+    }
+    return g;
+}
+
+
 void Gen :: doc() {
     int w {40}; // disable to just get tab sep
     
@@ -491,12 +545,11 @@ void Gen :: init() {
 
 void Gen :: reset() {
     PIndexT i;
-    FrameSizeT j;
     SampleT n(0);
     for (i=0; i<_output_count; ++i) {
-        for (j=0; j < _frame_size; ++j) {
-            outputs[i][j] = n;
-        }
+        // outputs of a compact SamplesBuffer are empty
+        std::fill(outputs[i].begin(), outputs[i].end(), n);
+        output_events[i].clear();
     }
     // always reset render count?
     _render_count = 0;
@@ -512,7 +565,8 @@ void Gen :: set_default() {
 void Gen :: _resize_outputs() {
     // size is always dim * _frame_size
     // only do this once to avoid repeating
-    _outputs_size = _output_count * _frame_size;
+    // will throw on overflow
+    _outputs_size = checked_outputs_size(_output_count, _frame_size);
     
     PIndexT i;
     VVSampleT::iterator j; // not a const       
@@ -538,6 +592,14 @@ void Gen :: _resize_outputs() {
     for (j=outputs.begin(); j != outputs.end(); ++j) {
 		// this will also set all values to 0.0
 		(*j).resize(_frame_size, n);
+    }
+    // event lists follow outputs; reserve only where events are kept, such that pushing events in render() never allocates
+    output_events.resize(_output_count);
+    for (i=0; i < _output_count; ++i) {
+        output_events[i].clear();
+        if (_output_has_events[i]) {
+            output_events[i].reserve(_frame_size);
+        }
     }
 	// reset only with the base class, so as to clear data values and reset render count; we do not want to call the virtual resets, as they might be expecting slots in this reset routine. 
 	Gen::reset();
@@ -555,6 +617,8 @@ Validity Gen :: _validate_outputs() {
 PIndexT Gen :: _register_output_parameter_type(PTypePtr pts) {
 	// called in derived init() to setup a output types; this does not preprae storage ; 
     _output_parameter_type[_output_count] = pts;
+    // trigger outputs keep a sparse list of events next to the dense frame
+    _output_has_events.push_back(pts->get_class_id() == PTypeID::Trigger);
     PIndexT set_index = _output_count;    
     _output_count += 1;
 	_resize_outputs(); // will use _output_count value
@@ -565,6 +629,8 @@ void Gen :: _clear_output_parameter_types() {
     _output_count = 0;
     _outputs_size = 0;
     outputs.clear();
+    output_events.clear();
+    _output_has_events.clear();
 }
 
 PIndexT Gen :: _register_input_parameter_type(PTypePtr pts) {
@@ -638,6 +704,302 @@ void Gen :: _reset_inputs() {
     }
 }
 
+void Gen :: _reset_network(std::set<Gen*>& visited, RenderCountT f) {
+    if (!visited.insert(this).second) {
+        return;
+    }
+    reset();
+    _render_count = f;
+    VGenPtrOutPair :: const_iterator j;
+    for (PIndexT i = 0; i < _input_count; ++i) {
+        for (j=_inputs[i].begin(); j != _inputs[i].end(); ++j) {
+            (*j).first->_reset_network(visited, f);
+        }
+    }
+}
+
+void Gen :: reset_network(RenderCountT f) {
+    std::set<Gen*> visited;
+    _reset_network(visited, f);
+}
+
+bool Gen :: _input_is_constant(PIndexT i, SampleT& v) const {
+    v = 0;
+    VGenPtrOutPair :: const_iterator j;
+    for (j=_inputs[i].begin(); j != _inputs[i].end(); ++j) {
+        if ((*j).first->get_class_id() != GenID::Constant) {
+            return false;
+        }
+        v += static_cast<const Constant*>((*j).first.get())->get_value();
+    }
+    return true;
+}
+
+void Gen :: _collect_network(std::set<Gen*>& visited,
+        std::vector<Gen*>& network) {
+    if (!visited.insert(this).second) {
+        return;
+    }
+    network.push_back(this);
+    VGenPtrOutPair :: const_iterator j;
+    for (PIndexT i = 0; i < _input_count; ++i) {
+        for (j=_inputs[i].begin(); j != _inputs[i].end(); ++j) {
+            (*j).first->_collect_network(visited, network);
+        }
+    }
+}
+
+bool Gen :: _inputs_are_disjoint() const {
+    // the input from which each Gen was first reached
+    std::unordered_map<const Gen*, PIndexT> owner;
+    std::vector<const Gen*> stack;
+    VGenPtrOutPair :: const_iterator j;
+    for (PIndexT i = 0; i < _input_count; ++i) {
+        for (j=_inputs[i].begin(); j != _inputs[i].end(); ++j) {
+            stack.push_back((*j).first.get());
+        }
+        while (!stack.empty()) {
+            const Gen* g = stack.back();
+            stack.pop_back();
+            auto found = owner.find(g);
+            if (found != owner.end()) {
+                if (found->second != i) return false;
+                continue;
+            }
+            owner[g] = i;
+            for (PIndexT k = 0; k < g->_input_count; ++k) {
+                for (j=g->_inputs[k].begin(); j != g->_inputs[k].end(); ++j) {
+                    stack.push_back((*j).first.get());
+                }
+            }
+            for (const GenPtr& s : g->_slots) {
+                if (s != nullptr) stack.push_back(s.get());
+            }
+        }
+    }
+    return true;
+}
+
+void Gen :: _set_render_frame_size(FrameSizeT f) {
+    _frame_size = f;
+    _outputs_size = checked_outputs_size(_output_count, _frame_size);
+    for (PIndexT i=0; i < _output_count; ++i) {
+        outputs[i].resize(_frame_size);
+        if (_output_has_events[i]) {
+            output_events[i].reserve(_frame_size);
+        }
+    }
+    // summed inputs are only read up to the frame size
+    for (auto& s : _summed_inputs) {
+        if (s.size() < _frame_size) s.resize(_frame_size);
+    }
+    _update_for_render_frame_size();
+}
+
+bool Gen :: _collect_resizable_network(std::vector<Gen*>& network) {
+    std::set<Gen*> visited;
+    VGenPtrOutPair :: const_iterator j;
+    for (PIndexT i = 0; i < _input_count; ++i) {
+        for (j=_inputs[i].begin(); j != _inputs[i].end(); ++j) {
+            (*j).first->_collect_network(visited, network);
+        }
+    }
+    FrameSizeT cfs = get_common_frame_size();
+    for (Gen* g : network) {
+        if (g == this || !g->_is_frame_size_independent() ||
+                g->_frame_size != cfs || g->_render_count != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Gen :: _set_network_frame_size(const std::vector<Gen*>& network,
+        FrameSizeT f, RenderCountT render_count) {
+    for (Gen* g : network) {
+        g->_set_render_frame_size(f);
+        g->_render_count = render_count;
+    }
+}
+
+GenPtr Gen :: _copy() const {
+    std::stringstream msg;
+    msg << "cannot copy a " << _class_name
+            << str_file_line(__FILE__, __LINE__);
+    throw std::domain_error(msg.str());
+}
+
+GenPtr Gen :: _clone_network(std::unordered_map<const Gen*, GenPtr>& copied) {
+    auto found = copied.find(this);
+    if (found != copied.end()) {
+        return found->second;
+    }
+    // a copy must not share a load in progress
+    wait_loaded();
+    GenPtr c = _copy();
+    copied[this] = c;
+    // slots are kept: Gens at slots are only read, and setting a slot replaces rather than changes its Gen
+    VGenPtrOutPair :: iterator j;
+    for (PIndexT i = 0; i < c->_input_count; ++i) {
+        for (j=c->_inputs[i].begin(); j != c->_inputs[i].end(); ++j) {
+            (*j).first = (*j).first->_clone_network(copied);
+        }
+    }
+    // copies do not keep capacity, which events must have such that rendering does not allocate
+    for (PIndexT i = 0; i < c->_output_count; ++i) {
+        if (c->_output_has_events[i]) {
+            c->output_events[i].reserve(c->_frame_size);
+        }
+    }
+    return c;
+}
+
+GenPtr Gen :: clone() {
+    std::unordered_map<const Gen*, GenPtr> copied;
+    copied.reserve(256);
+    return _clone_network(copied);
+}
+GenPtr Gen :: clone(std::unordered_map<const Gen*, GenPtr>& copied) {
+    return _clone_network(copied);
+}
+
+bool Gen :: can_seek_analytically() {
+    std::set<Gen*> visited;
+    std::vector<Gen*> network;
+    _collect_network(visited, network);
+    for (Gen* g : network) {
+        if (!g->_can_advance()) return false;
+    }
+    return true;
+}
+
+bool Gen :: seek(RenderCountT f) {
+    std::set<Gen*> visited;
+    std::vector<Gen*> network;
+    _collect_network(visited, network);
+    bool analytic {true};
+    bool backward {false};
+    for (Gen* g : network) {
+        if (!g->_can_advance()) analytic = false;
+        if (g->_render_count >= f) backward = true;
+    }
+    // rendering only moves forward
+    if (backward) {
+        reset_network();
+    }
+    if (f == 0) {
+        return true;
+    }
+    if (analytic) {
+        for (Gen* g : network) {
+            if (g->_render_count < f - 1) {
+                g->_advance(static_cast<SampleTimeT>(
+                        f - 1 - g->_render_count) * g->_frame_size);
+                g->_render_count = f - 1;
+            }
+        }
+        render(f);
+        return true;
+    }
+    // render each frame: a render skipping frames renders inputs only at the last frame, such that state carried between frames would be built from that frame alone
+    for (RenderCountT r=_render_count + 1; r <= f; ++r) {
+        render(r);
+    }
+    return false;
+}
+
+// static members passed by reference need a definition
+const std::uint32_t Gen :: _state_magic;
+const FrameSizeT Gen :: _range_frame_size;
+
+void Gen :: write_state(StateBlob& b) const {
+    b.put(static_cast<std::int32_t>(_class_id));
+    b.put(static_cast<std::uint64_t>(_output_count));
+    b.put(_frame_size);
+    b.put(_render_count);
+    for (PIndexT i=0; i<_output_count; ++i) {
+        b.put_vector(outputs[i]);
+        b.put_vector(output_events[i]);
+    }
+}
+
+void Gen :: read_state(StateBlob& b) {
+    std::int32_t class_id;
+    std::uint64_t output_count;
+    FrameSizeT frame_size;
+    b.get(class_id);
+    b.get(output_count);
+    b.get(frame_size);
+    if (class_id != static_cast<std::int32_t>(_class_id) ||
+            output_count != _output_count || frame_size != _frame_size) {
+        std::stringstream msg;
+        msg << "state does not match this Gen: " << *this
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    b.get(_render_count);
+    for (PIndexT i=0; i<_output_count; ++i) {
+        // sizes match, so this does not reallocate outputs
+        b.get_vector(outputs[i]);
+        b.get_vector(output_events[i]);
+    }
+}
+
+void Gen :: _write_network_state(std::set<const Gen*>& visited,
+        StateBlob& b) const {
+    if (!visited.insert(this).second) {
+        return;
+    }
+    write_state(b);
+    VGenPtrOutPair :: const_iterator j;
+    for (PIndexT i = 0; i < _input_count; ++i) {
+        for (j=_inputs[i].begin(); j != _inputs[i].end(); ++j) {
+            (*j).first->_write_network_state(visited, b);
+        }
+    }
+}
+
+void Gen :: _read_network_state(std::set<Gen*>& visited, StateBlob& b) {
+    if (!visited.insert(this).second) {
+        return;
+    }
+    read_state(b);
+    VGenPtrOutPair :: const_iterator j;
+    for (PIndexT i = 0; i < _input_count; ++i) {
+        for (j=_inputs[i].begin(); j != _inputs[i].end(); ++j) {
+            (*j).first->_read_network_state(visited, b);
+        }
+    }
+}
+
+StateBlob Gen :: snapshot_network() const {
+    StateBlob b;
+    b.put(_state_magic);
+    std::set<const Gen*> visited;
+    _write_network_state(visited, b);
+    return b;
+}
+
+void Gen :: restore_network(StateBlob& b) {
+    b.rewind();
+    std::uint32_t magic {0};
+    b.get(magic);
+    if (magic != _state_magic) {
+        std::stringstream msg;
+        msg << "not a network state snapshot"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    std::set<Gen*> visited;
+    _read_network_state(visited, b);
+    if (!b.at_end()) {
+        std::stringstream msg;
+        msg << "snapshot has state for more Gens than this network"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+}
+
 void Gen :: _sum_inputs(FrameSizeT fs) {
     // this is inlined in render() calls
     // note that this is nearly identical to Add :: render(); here we store the results in _summed_inputs, not in outputs; we also do not render inputs
@@ -674,6 +1036,79 @@ void Gen :: _sum_inputs(FrameSizeT fs) {
 	}
 }
 
+void Gen :: _set_lane_outputs(PIndexT n) {
+    if (n < 1) {
+        std::stringstream msg;
+        msg << "lane count must be at least one"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    _lane_count = n;
+    _clear_output_parameter_types();
+    std::stringstream name;
+    for (PIndexT i=0; i < n; ++i) {
+        name.str("");
+        name << "Output";
+        if (n > 1) name << ' ' << i+1;
+        _register_output_parameter_type(
+                PType::make_with_name(PTypeID::Value, name.str()));
+    }
+    _summed_lanes.assign(n > 1 ? _input_count : 0,
+            VSampleT(n * _frame_size, 0));
+}
+
+void Gen :: _sum_input_lanes(FrameSizeT fs) {
+    // lanes are summed lane after lane, such that each lane is read as a contiguous frame
+    PIndexT i;
+    PIndexT l;
+    FrameSizeT k;
+    bool wide;
+    const SampleT* src;
+    SampleT* dst;
+    for (i=0; i < _input_count; ++i) {
+        // only resized if the frame size changed since lanes were set, as when rendering at a larger block size
+        if (_summed_lanes[i].size() != _lane_count * fs) {
+            _summed_lanes[i].resize(_lane_count * fs);
+        }
+        std::fill(_summed_lanes[i].begin(), _summed_lanes[i].end(), 0);
+        for (auto& g : _inputs[i]) {
+            wide = (g.second == 0 &&
+                    g.first->get_lane_count() == _lane_count);
+            for (l=0; l < _lane_count; ++l) {
+                src = g.first->outputs[wide ? l : g.second].data();
+                dst = _summed_lanes[i].data() + l * fs;
+                for (k=0; k < fs; ++k) {
+                    dst[k] += src[k];
+                }
+            }
+        }
+    }
+}
+
+bool Gen :: _collect_input_events(PIndexT i, VFrameSizeType& dst) const {
+    // not inlined: called once per render cycle, not once per sample
+    dst.clear();
+    PIndexT gen_count_at_input = _inputs[i].size();
+    PIndexT j;
+    for (j=0; j < gen_count_at_input; ++j) {
+        // pairs of Gen, output index in that Gen to read
+        if (!_inputs[i][j].first->output_has_events(_inputs[i][j].second)) {
+            return false;
+        }
+    }
+    for (j=0; j < gen_count_at_input; ++j) {
+        const VFrameSizeType& src = _inputs[i][j].first->output_events[
+                _inputs[i][j].second];
+        dst.insert(dst.end(), src.begin(), src.end());
+    }
+    // with more than one Gen, the summed trigger is the union of events
+    if (gen_count_at_input > 1) {
+        std::sort(dst.begin(), dst.end());
+        dst.erase(std::unique(dst.begin(), dst.end()), dst.end());
+    }
+    return true;
+}
+
 //..............................................................................
 // public methods
 
@@ -682,6 +1117,15 @@ void Gen :: render(RenderCountT f) {
     _render_count = f;
 }
 
+void Gen :: set_lane_count(PIndexT n) {
+    if (n != _lane_count) {
+        std::stringstream msg;
+        msg << "cannot set lanes of a " << _class_name
+                << str_file_line(__FILE__, __LINE__);
+        throw std::domain_error(msg.str());
+    }
+}
+
 SampleT Gen :: get_output_average(PIndexT d, bool absolute) const {
     // if d is zero, get all frames/channels, otherwise, just get rquested dimension (i.e., 2d gets vector pos 1
 	if (d > _output_count) {
@@ -716,7 +1160,7 @@ SampleT Gen :: get_output_average(PIndexT d, bool absolute) const {
     // get average of one dim or all 
     for (VPIndexT::const_iterator i=dims.begin(); i!=dims.end(); ++i) {
         // from start of dim to 1 less than frame plus start
-        for (FrameSizeT j=0; j < _frame_size; ++j) {
+        for (FrameSizeT j=0; j < outputs[*i].size(); ++j) {
             if (absolute) {
                 sum += fabs(outputs[*i][j]);                
             }
@@ -845,7 +1289,7 @@ void Gen :: print_outputs(FrameSizeT start, FrameSizeT end) {
     FrameSizeT j;
     for (i=0; i<_output_count; ++i) {
         std::cout << std::endl << space1;            
-        for (j=start; j < end; ++j) {
+        for (j=start; j < end && j < outputs[i].size(); ++j) {
             std::cout << std::setprecision(8) << outputs[i][j] << '|';
         }
     }
@@ -907,6 +1351,68 @@ void Gen :: illustrate_network() {
 //..............................................................................
 // loading and writing outputs
 
+void Gen :: render_range(RenderCountT start, RenderCountT count,
+        SampleT* const* dst, PIndexT channels) {
+    if (start < 1 || channels != _output_count ||
+            count > std::numeric_limits<RenderCountT>::max() - start) {
+        std::stringstream msg;
+        msg << "render range must start at 1 or later, end within the render count range, and write " 
+                << _output_count << " channels"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    if (_render_count + 1 != start) {
+        seek(start - 1);
+    }
+    PIndexT i;
+    OutputsSizeT offset(0);
+    RenderCountT f {start};
+    FrameSizeT cfs = get_common_frame_size();
+    // frames rendered as each larger frame, and the number of larger frames; the last frame is always rendered at the common frame size, such that outputs end as after rendering frame by frame
+    RenderCountT per = _range_frame_size / cfs;
+    RenderCountT big = per > 1 && count > 0 ? (count - 1) / per : 0;
+    if (big > 0) {
+        // the network can render larger frames if each Gen writes the same samples at any frame size, and all are at the same render count
+        std::set<Gen*> visited;
+        std::vector<Gen*> network;
+        _collect_network(visited, network);
+        for (Gen* g : network) {
+            if (!g->_is_frame_size_independent() ||
+                    g->_frame_size != cfs || g->_render_count != start - 1) {
+                big = 0;
+                break;
+            }
+        }
+        if (big > 0) {
+            FrameSizeT bs = per * cfs;
+            _set_network_frame_size(network, bs, 0);
+            try {
+                for (RenderCountT b=1; b <= big; ++b) {
+                    render(b);
+                    for (i=0; i<_output_count; ++i) {
+                        std::copy(outputs[i].begin(), outputs[i].end(),
+                                dst[i] + offset);
+                    }
+                    offset += bs;
+                }
+            }
+            catch (...) {
+                _set_network_frame_size(network, cfs, start - 1);
+                throw;
+            }
+            f = start + big * per;
+            _set_network_frame_size(network, cfs, f - 1);
+        }
+    }
+    for (; f < start + count; ++f) {
+        render(f);
+        for (i=0; i<_output_count; ++i) {
+            std::copy(outputs[i].begin(), outputs[i].end(), dst[i] + offset);
+        }
+        offset += _frame_size;
+    }
+}
+
 void Gen :: write_outputs_to_vector(VSampleT& vst) const {
     // writing out to a flat vector
     
@@ -917,7 +1423,7 @@ void Gen :: write_outputs_to_vector(VSampleT& vst) const {
     OutputsSizeT n(0);
             
     for (i=0; i<_output_count; ++i) {
-        for (j=0; j < _frame_size; ++j) {        
+        for (j=0; j < outputs[i].size(); ++j) {        
             vst[n] = outputs[i][j];
             n += 1;
         }
@@ -925,14 +1431,14 @@ void Gen :: write_outputs_to_vector(VSampleT& vst) const {
 }
 
 void Gen :: write_output_to_fp(const std::string& fp, 
-                                    PIndexT d) const {
+                                    PIndexT d, SampleFormat format) const {
     std::stringstream msg;
     msg << "not implemented on base class"
             << str_file_line(__FILE__, __LINE__);
     throw std::domain_error(msg.str());
 }
 
-Validity Gen :: set_outputs_from_array(SampleT* v, OutputsSizeT s,
+Validity Gen :: set_outputs_from_array(const SampleT* v, OutputsSizeT s,
 								PIndexT ch, bool interleaved){
     // low level method of a raw, interleaved array as input; need size;
     // we need this b/c libsndfile uses raw arrays
@@ -961,8 +1467,19 @@ Validity Gen :: set_outputs_from_array(SampleT* v, OutputsSizeT s,
 		out_count_to_take = _output_count;
 	}
 	    
-	// assuming interleaved source to non-interleved destination; audio inputs are normally interleaved
 	PIndexT j(0);
+    if (!interleaved) {
+        // planar source: copy each run, up to the frame size
+        OutputsSizeT frames = s / ch;
+        OutputsSizeT n = std::min(frames,
+                static_cast<OutputsSizeT>(_frame_size));
+        for (j=0; j<out_count_to_take; ++j) {
+            std::copy(v + (j * frames), v + (j * frames) + n,
+                    outputs[j].begin());
+        }
+        return _validate_outputs();
+    }
+	// assuming interleaved source to non-interleved destination; audio inputs are normally interleaved
 	OutputsSizeT i(0); // for each sample in source
 	OutputsSizeT k(0); // for each sample we write
 	
@@ -1179,6 +1696,17 @@ void Gen :: clear_inputs() {
     }
 }
 
+void Gen :: swap_inputs_by_index(PIndexT i, VGenPtrOutPair& v) {
+    if (_input_count <= 0 or i >= _input_count) {
+        std::stringstream msg;
+        msg << "Parameter index is not available: " << i
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    // exchanges the vector storage only; no pointers are released here
+    _inputs[i].swap(v);
+}
+
 //..............................................................................
 // public slot control 
 void Gen :: set_slot_by_index(PIndexT i, GenPtr gs, bool update){
@@ -1211,6 +1739,19 @@ void Gen :: set_slot_by_index(PIndexT i, SampleT v, bool update){
 }
 
 
+void Gen :: swap_slot_by_index(PIndexT i, GenPtr& gs, bool update) {
+    if (_slot_count <= 0 or i >= _slot_count) {
+        std::stringstream msg;
+        msg << "Slot index is not available: " << i
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    _slots[i].swap(gs);
+	if (update) {
+		_update_for_new_slot();
+	}
+}
+
 GenPtr Gen :: get_slot_gen_at_index(PIndexT i) {
     if (_slot_count <= 0 or i >= _slot_count) {
         throw std::invalid_argument("Parameter index is not available.");		
@@ -1274,18 +1815,88 @@ void Constant :: reset() {
     for (k = _values.begin(); k!=_values.end(); ++k) {
         v += *k;
     }
+    _fill_frame(0, v);
+    _frame_modified = false;
+    // always reset frame count?
+    _render_count = 0;
+}
+
+void Constant :: _fill_frame(FrameSizeT start, SampleT v) {
     PIndexT i;
     PIndexT outs = get_output_count();
     FrameSizeT j;
     FrameSizeT frames = get_frame_size();
     
     for (i=0; i<outs; ++i) {
-        for (j=0; j < frames; ++j) {
+        for (j=start; j < frames; ++j) {
             outputs[i][j] = v;
         }
     }    
-    // always reset frame count?
-    _render_count = 0;
+    // a constant can stand in as a trigger source if it is either never or always triggering; any other value, summed with triggers, could cross the threshold, and thus must be read densely; when filling from an offset, the earlier part must also qualify
+    bool has_events = (v == 0 || v > TRIG_THRESH);
+    _output_has_events[0] = start == 0 ? has_events : 
+            (_output_has_events[0] && has_events);
+    // drop events at or after start; events are sorted
+    while (output_events[0].size() > 0 && output_events[0].back() >= start) {
+        output_events[0].pop_back();
+    }
+    if (v > TRIG_THRESH) {
+        for (j=start; j < frames; ++j) {
+            output_events[0].push_back(j);
+        }
+    }
+}
+
+void Constant :: _update_for_render_frame_size() {
+    _fill_frame(0, get_value());
+}
+
+void Constant :: _restore_frame(RenderCountT f) {
+    if (_frame_modified && _frame_modified_render < f) {
+        // _values has a single value after set_value_at()
+        _fill_frame(0, get_value());
+        _frame_modified = false;
+    }
+}
+
+SampleT Constant :: get_value() const {
+    SampleT v(0);
+    for (auto x : _values) {
+        v += x;
+    }
+    return v;
+}
+
+void Constant :: set_value_at(RenderCountT f, FrameSizeT offset, 
+        SampleT v) {
+    _restore_frame(f);
+    if (offset >= get_frame_size()) {
+        offset = get_frame_size() - 1;
+    }
+    // we know _values has capacity for at least one value
+    _values.clear();
+    _values.push_back(v);
+    _fill_frame(offset, v);
+    _frame_modified = true;
+    _frame_modified_render = f;
+}
+
+void Constant :: set_trigger_at(RenderCountT f, FrameSizeT offset) {
+    _restore_frame(f);
+    if (offset >= get_frame_size()) {
+        offset = get_frame_size() - 1;
+    }
+    if (outputs[0][offset] <= TRIG_THRESH) {
+        outputs[0][offset] = 1;
+        // triggers are delivered in time order, but a later value change may have left events after this offset
+        if (_output_has_events[0]) {
+            output_events[0].insert(std::lower_bound(
+                    output_events[0].begin(), output_events[0].end(), 
+                    offset), offset);
+        }
+    }
+    _frame_modified = true;
+    _frame_modified_render = f;
 }
 
 void Constant :: print_inputs(bool recursive, UINT8 recurse_level, 
@@ -1310,8 +1921,23 @@ void Constant :: print_inputs(bool recursive, UINT8 recurse_level,
     }
 }
 
+void Constant :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put_vector(_values);
+    b.put(_frame_modified);
+    b.put(_frame_modified_render);
+}
+
+void Constant :: read_state(StateBlob& b) {
+    Gen::read_state(b);
+    b.get_vector(_values);
+    b.get(_frame_modified);
+    b.get(_frame_modified_render);
+}
+
 void Constant :: render(RenderCountT f) {
-    // do nothing, as outputs is already set
+    // do nothing, as outputs is already set, unless a previous frame was modified at sub-frame offsets
+    _restore_frame(f);
     _render_count = f;
 }
 
@@ -1401,6 +2027,13 @@ void _BinaryCombined :: _update_for_new_slot() {
     }
 	assert(get_output_count() == outs);
 	assert(get_input_count() == outs);	
+    // channels are lanes only if set with set_lane_count()
+    _lane_count = 1;
+}
+
+void _BinaryCombined :: set_lane_count(PIndexT n) {
+    set_slot_by_index(0, n);
+    _lane_count = n;
 }
 
 
@@ -1513,6 +2146,8 @@ void SamplesBuffer :: _buffer_update_for_new_slot(PTypeTimeContext::Opt tc) {
     // by providing different PTypeTimeContext we can swith between interpreting 
     // will throw on error
     PTypeTimeContext::validate(tc);
+    // outputs are resized below
+    _expand();
 	// slot 0: channels
     // this is a small int; might overflow of trying to create large number of outs
     PIndexT outs = static_cast<PIndexT>(_slots[0]->outputs[0][0]);
@@ -1549,143 +2184,627 @@ void SamplesBuffer :: _buffer_update_for_new_slot(PTypeTimeContext::Opt tc) {
     else if (tc == PTypeTimeContext::Samples) {
        _set_frame_size(_slots[1]->outputs[0][0]);
     }
+    _apply_storage();
 }
 
 void SamplesBuffer :: _update_for_new_slot() {
     _buffer_update_for_new_slot(PTypeTimeContext::Samples);
 }
 
-void SamplesBuffer :: render(RenderCountT f) {
-	// render count must be ignored; instead, we render until we have filled our buffer; this means that the components will have a higher counter than render; need to be reset at beginning and end
-
-	// must reset; might advance to particular render count
-	_reset_inputs(); 
-	
-	// we assume that all inputs have the same frame size as standard frame size
-	FrameSizeT cfs = get_common_frame_size();
-    FrameSizeT fs = get_frame_size();
-	RenderCountT rc(0); // must start with request for frame 1
+void SamplesBuffer :: _fill_outputs(FrameSizeT bs, RenderCountT rc_start,
+        RenderCountT rc_end, FrameSizeT fs) {
 	OutputsSizeT i(0);
 	PIndexT j(0);
 	PIndexT out_count(get_output_count()); // out is always same as in 
-	RenderCountT pos(0);
-    
-	// ignore render count for now; just fill buffer
-    while (true) {
+	OutputsSizeT pos(0);
+    FrameSizeT n(0);
+    for (RenderCountT rc=rc_start; rc < rc_end; ++rc) {
         _render_inputs(rc+1); // render count must start at 1
-		_sum_inputs(cfs); // we use common frame size, not our frame size
-		for (i=0; i < cfs; ++i) {
-            pos = i + (rc * cfs); // where we write in the buffer
-            if (pos >= fs) break; // we end when we are full
-            
+		_sum_inputs(bs); // we use the block size, not our frame size
+        pos = rc * bs; // where we write in the buffer
+        n = pos < fs ? std::min(bs, fs - pos) : 0;
+		for (i=0; i < n; ++i) {
 			for (j=0; j<out_count; ++j) { // iter over inputs/outputs
-				//outputs[i + (rc * cfs) + out_to_matrix_offset[j]] = _summed_inputs[j][i];
-				outputs[j][pos] = _summed_inputs[j][i];                
+				outputs[j][pos + i] = _summed_inputs[j][i];                
 			}
 		}
-        if (pos >= fs) break; // we end when we are full        
-		rc++;
     }
-	// we reset after to return inputs to starting state
+}
+
+void SamplesBuffer :: _fill_output(PIndexT j, FrameSizeT bs,
+        RenderCountT rc_start, RenderCountT rc_end, FrameSizeT fs) {
+    // as _fill_outputs() with _sum_inputs(), for one input
+    const VGenPtrOutPair& gens = _inputs[j];
+    PIndexT gen_count_at_input = gens.size();
+    OutputsSizeT pos(0);
+    FrameSizeT k;
+    FrameSizeT n;
+    SampleT sum;
+    for (RenderCountT rc=rc_start; rc < rc_end; ++rc) {
+        for (PIndexT g=0; g < gen_count_at_input; ++g) {
+            gens[g].first->render(rc+1); // render count must start at 1
+        }
+        pos = rc * bs;
+        n = pos < fs ? std::min(bs, fs - pos) : 0;
+        for (k=0; k < n; ++k) {
+            if (gen_count_at_input == 1) {
+                outputs[j][pos + k] = gens[0].first->outputs[gens[0].second][k];
+            }
+            else {
+                sum = 0;
+                for (PIndexT g=0; g < gen_count_at_input; ++g) {
+                    sum += gens[g].first->outputs[gens[g].second][k];
+                }
+                outputs[j][pos + k] = sum;
+            }
+        }
+    }
+}
+
+void SamplesBuffer :: _fill_outputs_parallel(FrameSizeT bs,
+        RenderCountT rc_start, RenderCountT rc_end, FrameSizeT fs) {
+    IOPool& pool = get_environment()->get_render_pool();
+    std::vector<std::future<void>> fills;
+    for (PIndexT j=1; j < get_output_count(); ++j) {
+        fills.push_back(pool.submit([this, j, bs, rc_start, rc_end, fs](){
+            _in_parallel_fill = true;
+            try {
+                _fill_output(j, bs, rc_start, rc_end, fs);
+            }
+            catch (...) {
+                _in_parallel_fill = false;
+                throw;
+            }
+            _in_parallel_fill = false;
+        }));
+    }
+    // this thread fills the first output while the pool fills the rest
+    std::exception_ptr error;
+    _in_parallel_fill = true;
+    try {
+        _fill_output(0, bs, rc_start, rc_end, fs);
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+    _in_parallel_fill = false;
+    // wait for all before raising, as each refers to this buffer
+    for (auto& f : fills) {
+        try {
+            f.get();
+        }
+        catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void SamplesBuffer :: _expand() {
+    if (!_compacted) return;
+    for (PIndexT j=0; j < get_output_count(); ++j) {
+        outputs[j].resize(_frame_size);
+        decode_samples(_compact[j].data(), outputs[j].data(), _frame_size,
+                _storage);
+    }
+    std::vector<std::vector<UINT8>>().swap(_compact);
+    _compacted = false;
+}
+
+void SamplesBuffer :: _apply_storage() {
+    if (_storage == SampleFormat::Float64 || _compacted) return;
+    std::size_t bytes = get_sample_format_bytes(_storage);
+    _compact.resize(get_output_count());
+    for (PIndexT j=0; j < get_output_count(); ++j) {
+        _compact[j].resize(_frame_size * bytes);
+        encode_samples(outputs[j].data(), _compact[j].data(), _frame_size,
+                _storage);
+        // release storage, not only the size
+        VSampleT().swap(outputs[j]);
+    }
+    _compacted = true;
+}
+
+Validity SamplesBuffer :: _validate_outputs() {
+    // outputs were written; samples compacted before are replaced
+    if (_compacted) {
+        std::vector<std::vector<UINT8>>().swap(_compact);
+        _compacted = false;
+    }
+    _apply_storage();
+    return Validity {true, "OK"};
+}
+
+void SamplesBuffer :: reset() {
+    for (auto& c : _compact) {
+        std::fill(c.begin(), c.end(), 0);
+    }
+    Gen::reset();
+}
+
+void SamplesBuffer :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put(static_cast<std::int32_t>(_storage));
+    b.put(_compacted);
+    if (_compacted) {
+        for (PIndexT j=0; j < get_output_count(); ++j) {
+            b.put_vector(_compact[j]);
+        }
+    }
+}
+
+void SamplesBuffer :: read_state(StateBlob& b) {
+    // outputs are restored as stored: empty if compacted
+    Gen::read_state(b);
+    std::int32_t storage;
+    b.get(storage);
+    b.get(_compacted);
+    _storage = static_cast<SampleFormat>(storage);
+    if (_compacted) {
+        _compact.resize(get_output_count());
+        for (PIndexT j=0; j < get_output_count(); ++j) {
+            b.get_vector(_compact[j]);
+        }
+    }
+    else {
+        std::vector<std::vector<UINT8>>().swap(_compact);
+    }
+}
+
+void SamplesBuffer :: set_storage(SampleFormat format) {
+    if (_class_id == GenID::BreakPoints && format != SampleFormat::Float64) {
+        std::stringstream msg;
+        msg << "break points are always stored as Float64"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    if (format == _storage) return;
+    _expand();
+    _storage = format;
+    _apply_storage();
+}
+
+std::size_t SamplesBuffer :: get_storage_bytes() const {
+    std::size_t bytes {0};
+    for (PIndexT j=0; j < get_output_count(); ++j) {
+        bytes += _compacted ? _compact[j].size() :
+                outputs[j].size() * sizeof(SampleT);
+    }
+    return bytes;
+}
+
+void SamplesBuffer :: decode(PIndexT d, FrameSizeT start, FrameSizeT n,
+        SampleT* dst) const {
+    if (_compacted) {
+        decode_samples(_compact[d].data() +
+                (start * get_sample_format_bytes(_storage)), dst, n, _storage);
+    }
+    else {
+        std::copy(outputs[d].begin() + start, outputs[d].begin() + start + n,
+                dst);
+    }
+}
+
+void SamplesBuffer :: gather(PIndexT d, const FrameSizeT* indices,
+        FrameSizeT n, SampleT* dst) const {
+    FrameSizeT i {0};
+    FrameSizeT run;
+    while (i < n) {
+        // find a run of consecutive indices
+        run = 1;
+        while (i + run < n && indices[i + run] == indices[i] + run) {
+            ++run;
+        }
+        if (run >= 4) {
+            decode(d, indices[i], run, dst + i);
+        }
+        else {
+            for (FrameSizeT k=i; k < i + run; ++k) {
+                dst[k] = get_sample(d, indices[k]);
+            }
+        }
+        i += run;
+    }
+}
+
+void SamplesBuffer :: render(RenderCountT f) {
+	// render count must be ignored; instead, we render until we have filled our buffer; this means that the components will have a higher counter than render; need to be reset at beginning and end
+    wait_loaded();
+
+	// must reset; might advance to particular render count
 	_reset_inputs(); 
+    _expand();
 	
+	// we assume that all inputs have the same frame size as standard frame size
+	FrameSizeT cfs = get_common_frame_size();
+    FrameSizeT fs = get_frame_size();
+    // blocks at the common frame size; the last writes nothing if fs is a multiple of cfs, but is rendered such that inputs are always left as after this many blocks
+    RenderCountT blocks = fs / cfs + 1;
+	RenderCountT rc(0); // must start with request for frame 1
+
+    // independent networks at each input can be rendered at once
+    bool parallel = get_output_count() > 1 && _parallel_fill.load() &&
+            !_in_parallel_fill && _inputs_are_disjoint();
+
+    // render most blocks at a larger frame size, leaving at least one block at the common frame size such that the inputs end as if never resized
+    FrameSizeT bs = (_block_size.load() / cfs) * cfs;
+    RenderCountT big = bs > cfs ? ((blocks - 1) * cfs) / bs : 0;
+    std::vector<Gen*> network;
+    if (big > 0 && _collect_resizable_network(network)) {
+        _set_network_frame_size(network, bs, 0);
+        for (auto& s : _summed_inputs) {
+            if (s.size() < bs) s.resize(bs);
+        }
+        try {
+            if (parallel) _fill_outputs_parallel(bs, 0, big, fs);
+            else _fill_outputs(bs, 0, big, fs);
+        }
+        catch (...) {
+            _set_network_frame_size(network, cfs, 0);
+            throw;
+        }
+        rc = (big * bs) / cfs;
+        _set_network_frame_size(network, cfs, rc);
+    }
+    if (parallel) _fill_outputs_parallel(cfs, rc, blocks, fs);
+    else _fill_outputs(cfs, rc, blocks, fs);
+
+	// we reset after to return inputs to starting state
+	_reset_inputs(); 
+    _apply_storage();
 }
 
 void SamplesBuffer :: write_output_to_fp(const std::string& fp, 
-                                    PIndexT d) const {
+                                    PIndexT d, SampleFormat format) const {
     // default is d is 0, which is all 
     // if want ch 2 of stereo, d is 2
     if (d > get_output_count()) {
 		throw std::invalid_argument("dimension greater than that supported is requested");
     }
-    // can select format here
-	int format = SF_FORMAT_AIFF | SF_FORMAT_PCM_16;
-                                    
     VPIndexT dims; 
-    OutputsSizeT count(0);
     PIndexT p;    
-    
-    PIndexT reqDim(1); // one if requested a specific dim
     if (d==0) {
-        reqDim = get_output_count(); // number of dims
-        //dims = out_to_matrix_offset; //copy entire vector     
         for (p=0; p<get_output_count(); ++p) {
             dims.push_back(p);
         }
-        count = get_outputs_size();        
     } 
     else { // just write the single dim specified 
-        PIndexT dPos = d - 1; // if request dim 2, want offset for 1
-        //dims.push_back(out_to_matrix_offset[dPos]);    
-        dims.push_back(dPos);        
-        count = get_frame_size(); // only need one frame
+        dims.push_back(d - 1); // if request dim 2, want offset for 1
     }
 
-    FrameSizeT sr(_sampling_rate);
-	SndfileHandle outfile(fp, SFM_WRITE, format, reqDim, sr);
-	if (not outfile){
-        throw std::bad_alloc();    
+    SoundFileWriter outfile(fp, dims.size(), _sampling_rate, format);
+    // interleave dimensions into one chunk at a time
+    FrameSizeT chunk_frames = outfile.get_chunk_frames();
+    VSampleT v(chunk_frames * dims.size(), 0);
+    FrameSizeT frameSize = get_frame_size();
+    OutputsSizeT j(0);
+    for (FrameSizeT i = 0; i < frameSize; ++i) {
+        for (VPIndexT::const_iterator p = dims.begin(); p != dims.end(); ++p) {
+            v[j] = get_sample(*p, i);
+            ++j;
+        }
+        if (j == v.size() || i + 1 == frameSize) {
+            outfile.write(v.data(), j / dims.size());
+            j = 0;
+        }
     }
+    outfile.close();
+}
 
-    double* v = new SampleT[count];
-	if (not v) {
-        throw std::bad_alloc();    
-    }
-    OutputsSizeT i(0);
-    OutputsSizeT j(0);
-    
-    FrameSizeT frameSize = get_frame_size();
+//! The header of a decoded sample cache file, followed by the source path and then planar samples, 8-byte aligned.
+struct DecodeCacheHeader {
+    char magic[4];
+    std::uint32_t sample_size;
+    std::uint64_t modified;
+    std::uint64_t file_size;
+    std::uint64_t frames;
+    std::uint32_t channels;
+    std::uint32_t sampling_rate;
+    std::int32_t format;
+    std::uint32_t path_size;
+};
 
-    // interleave dimensions if more than one requested
-    // iterate over frame size; for each frame, we will write that many dimensiosn
-    for (i = 0; i < frameSize; ++i) {
-        for (VPIndexT::const_iterator p = dims.begin(); p != dims.end(); ++p) {
-            // if we are stereo, for each frame point we write two points, one at each offset position
-            v[j] = outputs[*p][i];
-            ++j; // abs position
+static const char DECODE_CACHE_MAGIC[4] {'A', 'W', 'C', '1'};
+
+//! Return the offset of samples in a cache file with a path of path_size.
+inline std::size_t decode_cache_data_offset(std::size_t path_size) {
+    return ((sizeof(DecodeCacheHeader) + path_size + 7) / 8) * 8;
+}
+
+std::atomic<bool> SamplesBuffer :: _cache_enabled {true};
+
+std::atomic<bool> SamplesBuffer :: _load_async {false};
+
+std::atomic<bool> SamplesBuffer :: _parallel_fill {true};
+
+std::atomic<FrameSizeT> SamplesBuffer :: _block_size {4096};
+
+thread_local bool SamplesBuffer :: _in_parallel_fill {false};
+
+std::atomic<ResampleQuality> SamplesBuffer :: _resample_quality {
+        ResampleQuality::Medium};
+
+void SamplesBuffer :: _resample_outputs(OutputsSizeT sampling_rate) {
+    ResampleQuality q = _resample_quality.load();
+    if (q == ResampleQuality::None || sampling_rate == 0 ||
+            sampling_rate == _sampling_rate) {
+        return;
+    }
+    _expand();
+    PolyphaseResampler r(q);
+    VVSampleT converted(get_output_count());
+    for (PIndexT j=0; j < get_output_count(); ++j) {
+        r.convert(outputs[j].data(), _frame_size, sampling_rate,
+                _sampling_rate, converted[j]);
+    }
+    _set_frame_size(static_cast<FrameSizeT>(converted[0].size()));
+    for (PIndexT j=0; j < get_output_count(); ++j) {
+        outputs[j].swap(converted[j]);
+    }
+    _apply_storage();
+}
+
+std::string SamplesBuffer :: _cache_name(const std::string& fp) {
+    boost::system::error_code ec;
+    boost::filesystem::path p = boost::filesystem::absolute(fp);
+    std::time_t modified = boost::filesystem::last_write_time(p, ec);
+    if (ec) return "";
+    std::uintmax_t size = boost::filesystem::file_size(p, ec);
+    if (ec) return "";
+    std::stringstream key;
+    key << p.string() << "|" << modified << "|" << size << "|"
+            << sizeof(SampleT);
+    std::stringstream name;
+    name << std::hex << std::hash<std::string>()(key.str()) << ".awc";
+    return name.str();
+}
+
+bool SamplesBuffer :: _set_outputs_from_cache(const std::string& fp,
+        const std::string& cache_fp, OutputsSizeT& sampling_rate) {
+    MappedFile m(cache_fp);
+    if (!m.is_valid() || m.size() < sizeof(DecodeCacheHeader)) {
+        return false;
+    }
+    DecodeCacheHeader h;
+    std::copy(m.data(), m.data() + sizeof(h), reinterpret_cast<UINT8*>(&h));
+    // the name is a hash: confirm that this is the same file, as it was
+    std::string p = boost::filesystem::absolute(fp).string();
+    boost::system::error_code ec;
+    std::time_t modified = boost::filesystem::last_write_time(p, ec);
+    std::size_t offset = decode_cache_data_offset(h.path_size);
+    if (ec || !std::equal(h.magic, h.magic + 4, DECODE_CACHE_MAGIC) ||
+            h.sample_size != sizeof(SampleT) ||
+            h.modified != static_cast<std::uint64_t>(modified) ||
+            h.file_size != boost::filesystem::file_size(p, ec) ||
+            h.channels == 0 || h.frames == 0 ||
+            h.path_size != p.size() ||
+            m.size() != offset + (h.frames * h.channels * sizeof(SampleT)) ||
+            !std::equal(p.begin(), p.end(),
+            reinterpret_cast<const char*>(m.data() + sizeof(h)))) {
+        return false;
+    }
+    // the mapping is only read; offset is aligned for SampleT
+    Validity ok = set_outputs_from_array(
+            reinterpret_cast<const SampleT*>(m.data() + offset),
+            static_cast<OutputsSizeT>(h.frames * h.channels),
+            h.channels, false);
+    if (!ok.ok) {
+        throw std::invalid_argument(ok.msg);
+    }
+    sampling_rate = h.sampling_rate;
+    return true;
+}
+
+void SamplesBuffer :: _write_cache(const std::string& fp,
+        const std::string& cache_fp, const SampleT* v,
+        std::uint64_t frames, PIndexT ch, OutputsSizeT sampling_rate,
+        int format) {
+    std::string p = boost::filesystem::absolute(fp).string();
+    boost::system::error_code ec;
+    DecodeCacheHeader h;
+    std::copy(DECODE_CACHE_MAGIC, DECODE_CACHE_MAGIC + 4, h.magic);
+    h.sample_size = sizeof(SampleT);
+    h.modified = boost::filesystem::last_write_time(p, ec);
+    h.file_size = boost::filesystem::file_size(p, ec);
+    if (ec) return;
+    h.frames = frames;
+    h.channels = static_cast<std::uint32_t>(ch);
+    h.sampling_rate = static_cast<std::uint32_t>(sampling_rate);
+    h.format = format;
+    h.path_size = static_cast<std::uint32_t>(p.size());
+
+    // write to a unique name and rename, such that readers in other processes never see a partial file
+    std::stringstream tmp;
+    tmp << cache_fp << "." << std::this_thread::get_id() << ".tmp";
+    {
+        std::ofstream f(tmp.str(), std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        f.write(p.data(), p.size());
+        std::size_t pad = decode_cache_data_offset(p.size()) -
+                sizeof(h) - p.size();
+        f.write("\0\0\0\0\0\0\0\0", pad);
+        // de-interleave in bounded chunks
+        VSampleT chunk;
+        chunk.reserve(4096);
+        for (PIndexT c=0; c < ch; ++c) {
+            for (std::uint64_t i=0; i < frames; ++i) {
+                chunk.push_back(v[i * ch + c]);
+                if (chunk.size() == chunk.capacity() || i + 1 == frames) {
+                    f.write(reinterpret_cast<const char*>(chunk.data()),
+                            chunk.size() * sizeof(SampleT));
+                    chunk.clear();
+                }
+            }
+        }
+        if (!f) {
+            f.close();
+            boost::filesystem::remove(tmp.str(), ec);
+            return;
         }
     }
-    assert(j==count);
-    outfile.write(v, count);
-    delete[] v;
-    
+    boost::filesystem::rename(tmp.str(), cache_fp, ec);
+    if (ec) {
+        boost::filesystem::remove(tmp.str(), ec);
+    }
 }
 
 void SamplesBuffer :: set_outputs_from_fp(const std::string& fp) {
     // vitual method overridden in SecondsBuffer (so as to localize use of libsndfile
     // an exception to call on base class
+    // a pending load would replace these outputs when taken
+    wait_loaded();
+    auto start = std::chrono::steady_clock::now();
+    std::string cache_fp;
+    if (_cache_enabled.load()) {
+        std::string name = _cache_name(fp);
+        if (!name.empty()) {
+            cache_fp = get_environment()->get_fp_cache(name);
+            OutputsSizeT sr {0};
+            if (_set_outputs_from_cache(fp, cache_fp, sr)) {
+                _resample_outputs(sr);
+                _load_seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start).count();
+                return;
+            }
+        }
+    }
     // libsndfile nomenclature is different than used here: For a sound file with only one channel, a frame is the same as a item (ie a single sample) while for multi channel sound files, a single frame contains a single item for each channel.
 	SndfileHandle sh(fp);
+    if (sh.frames() < 0 || sh.channels() < 0) {
+        std::stringstream msg;
+        msg << "invalid sound file header: " << fp
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
     // read into temporary array; this means that we use 2x the memory that we really need, but it means that we can un-interleave the audio file when passing in the array; ideally we would pass in our outputs directly
-    OutputsSizeT s = static_cast<OutputsSizeT>(sh.frames() * sh.channels());
+    // will throw on overflow
+    OutputsSizeT s = checked_outputs_size(static_cast<PIndexT>(sh.channels()),
+            static_cast<FrameSizeT>(sh.frames()));
     // we need to use a double, as that seems to be what we get out of sndfile
     double* v = new double[s]; // why not use SampleT instaed of double
     sh.readf(v, sh.frames());
     // this call will resize frame if necessary
     Validity ok = set_outputs_from_array(v, s, sh.channels());
+    if (ok.ok && !cache_fp.empty() && s > 0) {
+        _write_cache(fp, cache_fp, v, sh.frames(), sh.channels(),
+                sh.samplerate(), sh.format());
+    }
     // delte temporary array first
     delete[] v;
     // raise exception after cleanup.
     if (!ok.ok) {    
         throw std::invalid_argument(ok.msg);
     }
+    _resample_outputs(sh.samplerate());
+    _load_seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+void SamplesBuffer :: load_async(const std::string& fp) {
+    wait_loaded();
+    // read the header here, such that the size of outputs is known at once
+    SndfileHandle sh(fp);
+    if (not sh || sh.frames() < 1) {
+        std::stringstream msg;
+        msg << "cannot open file for reading: " << fp
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    std::uint64_t frames = sh.frames();
+    if (_resample_quality.load() != ResampleQuality::None &&
+            static_cast<OutputsSizeT>(sh.samplerate()) != _sampling_rate) {
+        frames = PolyphaseResampler::get_output_size(frames,
+                sh.samplerate(), _sampling_rate);
+    }
+    _expand();
+    _set_frame_size(static_cast<FrameSizeT>(frames));
+    // decode into a buffer of the same shape, touched only by the pool thread until taken
+    EnvPtr e = get_environment();
+    PIndexT ch = get_output_count();
+    _loading = e->get_io_pool().submit([e, ch, fp](){
+        GenPtr b = Gen::make_with_environment(GenID::SamplesBuffer, e);
+        b->set_slot_by_index(0, ch);
+        b->set_outputs_from_fp(fp);
+        return b;
+    });
+}
+
+void SamplesBuffer :: wait_loaded() {
+    if (!_loading.valid()) return;
+    // moving leaves _loading invalid, also if get() throws
+    std::shared_future<GenPtr> loading(std::move(_loading));
+    GenPtr b = loading.get();
+    SamplesBufferPtr sb = std::dynamic_pointer_cast<SamplesBuffer>(b);
+    _expand();
+    if (b->get_frame_size() != _frame_size) {
+        // the file changed since its header was read
+        _set_frame_size(b->get_frame_size());
+    }
+    outputs.swap(b->outputs);
+    _load_seconds = sb->get_load_seconds();
+    _apply_storage();
+}
+
+bool SamplesBuffer :: is_loaded() const {
+    return !_loading.valid() || _loading.wait_for(
+            std::chrono::seconds(0)) == std::future_status::ready;
 }
 
 void SamplesBuffer :: set_outputs(const Inj<SampleT>& bi) {
     // vitual method overridden in SecondsBuffer
     //std::cout << "SecondsBuffer: set_outputs: " << bi->get_frame_size() << " channels: " << bi->get_channels() << std::endl;    
-    VSampleT vst;
-    bi.fill_interleaved(vst);
-    PIndexT ch = bi.get_channels();
-    set_slot_by_index(0, ch); // set channels
-    // will get a pointer to vst and pass to set from array
-    set_outputs_from_vector(vst, ch);
-    // vector will be auto destroyed here
+    VVSampleT vvst;
+    bi.fill_planar(vvst);
+    // samples are copied only once, into vvst
+    set_outputs_from_vectors(std::move(vvst));
+}
+
+void SamplesBuffer :: set_outputs_from_vectors(VVSampleT&& vvst) {
+    if (vvst.size() < 1 || vvst[0].size() < 1) {
+        std::stringstream msg;
+        msg << "at least one channel of at least one sample is required"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    PIndexT ch = vvst.size();
+    FrameSizeT fs = vvst[0].size();
+    for (PIndexT j=1; j < ch; ++j) {
+        if (vvst[j].size() != fs) {
+            std::stringstream msg;
+            msg << "all channels must have the same size"
+                    << str_file_line(__FILE__, __LINE__);
+            throw std::invalid_argument(msg.str());
+        }
+    }
+    wait_loaded();
+    if (ch != get_output_count()) {
+        set_slot_by_index(0, ch); // set channels
+    }
+    for (PIndexT j=0; j < ch; ++j) {
+        outputs[j].swap(vvst[j]);
+    }
+    // outputs are already of the frame size: this sets sizes without resetting values
+    _set_render_frame_size(fs);
+    for (PIndexT j=0; j < ch; ++j) {
+        output_events[j].clear();
+    }
+    _render_count = 0;
+    Validity ok = _validate_outputs();
+    if (!ok.ok) {
+        std::stringstream msg;
+        msg << ok.msg << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
 }
 
 void SamplesBuffer :: set_outputs(const std::string& fp) {
     // vitual method overridden in SecondsBuffer
-    set_outputs_from_fp(fp);
+    if (_load_async.load()) {
+        load_async(fp);
+    }
+    else {
+        set_outputs_from_fp(fp);
+    }
 }
 
 
@@ -1819,6 +2938,7 @@ void BPIntegrator :: init() {
 
 void BPIntegrator :: _update_for_new_slot() {
     //std::cout << *this << ": _update_for_new_slot()" << std::endl;
+    _slots[_slot_index_bps]->wait_loaded();
     _points_len = _slots[_slot_index_bps]->get_frame_size();
     // set to last y value of all bps
     _amp = _slots[_slot_index_bps]->outputs[1][_points_len-1];
@@ -1837,6 +2957,123 @@ void BPIntegrator :: reset() {
 }
 
 
+OutputsSizeT BPIntegrator :: _segment_width(FrameSizeT k,
+        PTypeTimeContext::Opt tc) const {
+    SampleT x_src = _slots[_slot_index_bps]->outputs[0][k];
+    SampleT x_dst = _slots[_slot_index_bps]->outputs[0][k + 1];
+    if (tc == PTypeTimeContext::Seconds) {
+        // TODO: averaged, or floored?
+        return (x_dst - x_src) * static_cast<SampleT>(_sampling_rate);
+    }
+    return x_dst - x_src; // integer subtractionof samples
+}
+
+bool BPIntegrator :: _can_advance() const {
+    SampleT trigger;
+    SampleT cycle;
+    if (!_input_is_constant(_input_index_trigger, trigger) ||
+            !_input_is_constant(_input_index_cycle, cycle) ||
+            trigger > TRIG_THRESH) {
+        return false;
+    }
+    // a segment of zero samples is never left in render()
+    PTypeTimeContext::Opt tc = PTypeTimeContext::resolve(
+            _slots[_slot_index_t_context]->outputs[0][0]);
+    for (FrameSizeT k=0; k + 1 < _points_len; ++k) {
+        if (_segment_width(k, tc) == 0) return false;
+    }
+    return true;
+}
+
+void BPIntegrator :: _advance(SampleTimeT samples) {
+    SampleT cycle;
+    _input_is_constant(_input_index_cycle, cycle);
+    bool cycling = cycle > TRIG_THRESH;
+    if (samples == 0 || (!_running && !cycling)) {
+        return; // holding the last value
+    }
+    _t_context = PTypeTimeContext::resolve(
+            _slots[_slot_index_t_context]->outputs[0][0]);
+    SampleTimeT total {0};
+    for (FrameSizeT k=0; k + 1 < _points_len; ++k) {
+        total += _segment_width(k, _t_context);
+    }
+    // samples written in the current pass; when not running but cycling, a pass starts with the next sample
+    SampleTimeT pos = (_running ? _samps_in_bp : 0) + samples;
+    if (cycling) {
+        pos %= total;
+    }
+    else if (pos >= total) {
+        pos = 0;
+    }
+    if (pos == 0) {
+        // at the end of a pass, as render() leaves it
+        _point_count = _points_len - 1;
+        _samps_in_bp = total;
+        _samps_next_point = total;
+        _running = false;
+        _start = false;
+        _amp = _slots[_slot_index_bps]->outputs[1][_points_len-1];
+        return;
+    }
+    // find the segment of the last sample written, pos - 1
+    SampleTimeT seg_start {0};
+    FrameSizeT k {0};
+    OutputsSizeT w {_segment_width(0, _t_context)};
+    while (pos > seg_start + w) {
+        seg_start += w;
+        ++k;
+        w = _segment_width(k, _t_context);
+    }
+    _x_src = _slots[_slot_index_bps]->outputs[0][k];
+    _x_dst = _slots[_slot_index_bps]->outputs[0][k + 1];
+    _y_src = _slots[_slot_index_bps]->outputs[1][k];
+    _y_dst = _slots[_slot_index_bps]->outputs[1][k + 1];
+    _y_span = _y_dst - _y_src;
+    _samps_width = w;
+    _samps_last_point = seg_start;
+    _samps_next_point = seg_start + w;
+    _samps_in_bp = pos;
+    // at the end of a segment, render() has already moved to the next point
+    _point_count = pos == seg_start + w ? k + 1 : k;
+    _running = true;
+    _start = false;
+}
+
+void BPIntegrator :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put(_point_count);
+    b.put(_running);
+    b.put(_start);
+    b.put(_samps_in_bp);
+    b.put(_samps_last_point);
+    b.put(_samps_next_point);
+    b.put(_samps_width);
+    b.put(_x_src);
+    b.put(_x_dst);
+    b.put(_y_src);
+    b.put(_y_dst);
+    b.put(_y_span);
+    b.put(_amp);
+}
+
+void BPIntegrator :: read_state(StateBlob& b) {
+    Gen::read_state(b);
+    b.get(_point_count);
+    b.get(_running);
+    b.get(_start);
+    b.get(_samps_in_bp);
+    b.get(_samps_last_point);
+    b.get(_samps_next_point);
+    b.get(_samps_width);
+    b.get(_x_src);
+    b.get(_x_dst);
+    b.get(_y_src);
+    b.get(_y_dst);
+    b.get(_y_span);
+    b.get(_amp);
+}
+
 void BPIntegrator :: render(RenderCountT f) {
     // note that witht this implementation we do not actually ever get to the last y value in the break points; we interpolate across the suggested interval but will not actually get to the last value; this is useful for looping but perhaps not intuitive in all cases
     // once per render call, or per render frame?
@@ -1855,6 +3092,7 @@ void BPIntegrator :: render(RenderCountT f) {
         
         // translate to an enum in the Ptype and get enum value from Ptype
         // _points = slots[_slot_index_t_context]
+        output_events[1].clear();
         
 		for (FrameSizeT i=0; i < _frame_size; ++i) {
             // if cycle is active and not runnin start
@@ -1899,14 +3137,7 @@ void BPIntegrator :: render(RenderCountT f) {
                 _y_src = _slots[_slot_index_bps]->outputs[1][_point_count];
                 _y_dst = _slots[_slot_index_bps]->outputs[1][_point_count + 1];
                 
-                if (_t_context == PTypeTimeContext::Seconds) { // not zero
-                    // TODO: averaged, or floored?                
-                    _samps_width = (_x_dst - _x_src) *
-                            static_cast<SampleT>(_sampling_rate);
-                }
-                else { // integer subtractionof samples
-                    _samps_width = _x_dst - _x_src;
-                }
+                _samps_width = _segment_width(_point_count, _t_context);
                 _y_span = _y_dst - _y_src;
                 // this is the last position in samples
                 _samps_last_point = _samps_next_point; // store before update
@@ -1916,6 +3147,7 @@ void BPIntegrator :: render(RenderCountT f) {
                 //std::cout << "    _samps_width: " << _samps_width << " _x_src: " << _x_src << " _x_dst: " << _x_dst << " _samps_last_point " << _samps_last_point << " _samps_next_point " << _samps_next_point <<  std::endl;
                 // set start of segment
                 outputs[1][i] = 1;
+                output_events[1].push_back(i);
             }
             else { // not a start of segment
                 outputs[1][i] = 0;
@@ -2020,6 +3252,72 @@ void Phasor :: reset() {
     _rate_prev = 0; // should never be zero, so a good init
 }
 
+bool Phasor :: _can_advance() const {
+    SampleT v;
+    return _input_is_constant(_input_index_rate, v) &&
+            _input_is_constant(_input_index_phase, v);
+}
+
+void Phasor :: _advance(SampleTimeT samples) {
+    _input_is_constant(_input_index_rate, _sum_rate);
+    if (_sum_rate != _rate_prev) {
+        _rate_prev = _sum_rate;
+        _period_samples = rate_context_to_samples(
+                _sum_rate,
+                PTypeRateContext::resolve(
+                _slots[_slot_index_rate_context]->outputs[0][0]),
+                _sampling_rate,
+                _nyquist
+                );
+    }
+    SampleT inc = 1.0 / static_cast<SampleT>((_period_samples - 1));
+    // step exactly as render() does up to the next wrap; from a wrap, every cycle is identical, so whole cycles can be skipped
+    SampleTimeT n {0};
+    SampleT amp = _amp_prev;
+    while (n < samples) {
+        ++n;
+        amp += inc;
+        if (amp >= _amp_threshold) {
+            amp = 0.0;
+            break;
+        }
+    }
+    if (n < samples) {
+        SampleTimeT cycle {0};
+        SampleT a {0};
+        do {
+            ++cycle;
+            a += inc;
+        } while (a < _amp_threshold);
+        amp = 0.0;
+        for (n = (samples - n) % cycle; n > 0; --n) {
+            amp += inc;
+        }
+    }
+    _amp = amp;
+    _amp_prev = amp;
+}
+
+void Phasor :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put(_rate_prev);
+    b.put(_sum_rate);
+    b.put(_sum_phase);
+    b.put(_amp);
+    b.put(_amp_prev);
+    b.put(_period_samples);
+}
+
+void Phasor :: read_state(StateBlob& b) {
+    Gen::read_state(b);
+    b.get(_rate_prev);
+    b.get(_sum_rate);
+    b.get(_sum_phase);
+    b.get(_amp);
+    b.get(_amp_prev);
+    b.get(_period_samples);
+}
+
 void Phasor :: render(RenderCountT f) {
 	// given a frequency and a sample rate, we can calculate the number of samples per cycle
 	// 1 / fq is time in seconds
@@ -2035,7 +3333,8 @@ void Phasor :: render(RenderCountT f) {
         _render_inputs(f);
 		// get a vector  for each input summing accross all dimensions
 		_sum_inputs(_frame_size);
-		
+		output_events[1].clear();
+        
 		for (i=0; i < _frame_size; ++i) {
 			// for each frame position, must get sum across all frequency values calculated.
 			_sum_rate = _summed_inputs[_input_index_rate][i];
@@ -2061,6 +3360,7 @@ void Phasor :: render(RenderCountT f) {
 			if (_amp >= _amp_threshold) {
                 _amp = 0.0;
                 outputs[1][i] = 1; // set trigger           
+                output_events[1].push_back(i);
             }
             else {
                 outputs[1][i] = 0; // set trigger  
@@ -2130,41 +3430,142 @@ void Sine :: reset() {
     _phase_cur = 0;
     _rate_cur = 0;
     _phase_increment = 0;
+    // a rate of zero does not differ from _rate_cur, and would keep a previous increment
+    _angle_increment = 0;
+    _lane_angle_increment.assign(_lane_count, 0);
+    _lane_phase_increment.assign(_lane_count, 0);
+    _lane_phase_cur.assign(_lane_count, 0);
+    _lane_rate_cur.assign(_lane_count, 0);
+}
+
+void Sine :: set_lane_count(PIndexT n) {
+    _set_lane_outputs(n);
+    reset();
+}
+
+bool Sine :: _can_advance() const {
+    SampleT v;
+    // lanes are not advanced analytically
+    return _lane_count == 1 &&
+            _input_is_constant(_input_index_rate, v) &&
+            _input_is_constant(_input_index_phase, v);
+}
+
+void Sine :: _advance(SampleTimeT samples) {
+    SampleT phase;
+    SampleT rate;
+    _input_is_constant(_input_index_phase, phase);
+    _input_is_constant(_input_index_rate, rate);
+    if (phase != _phase_increment) {
+        _phase_increment = phase;
+        _phase_cur = phase;
+    }
+    if (rate != _rate_cur) {
+        _rate_cur = rate;
+        _angle_increment = rate_context_to_angle_increment(
+                _rate_cur,
+                PTypeRateContext::resolve(
+                _slots[_slot_index_rate_context]->outputs[0][0]),
+                _sampling_rate,
+                _nyquist);
+    }
+    _phase_cur = std::fmod(_phase_cur + std::fmod(
+            static_cast<SampleT>(samples) * _angle_increment, PI2), PI2);
+    phase_limiter(_phase_cur); // inllined, in place
+}
+
+void Sine :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put(_angle_increment);
+    b.put(_phase_increment);
+    b.put(_phase_cur);
+    b.put(_rate_cur);
+    b.put(_rate_prev);
+    b.put(_sample_count);
+    if (_lane_count > 1) {
+        b.put_vector(_lane_angle_increment);
+        b.put_vector(_lane_phase_increment);
+        b.put_vector(_lane_phase_cur);
+        b.put_vector(_lane_rate_cur);
+    }
+}
+
+void Sine :: read_state(StateBlob& b) {
+    Gen::read_state(b);
+    b.get(_angle_increment);
+    b.get(_phase_increment);
+    b.get(_phase_cur);
+    b.get(_rate_cur);
+    b.get(_rate_prev);
+    b.get(_sample_count);
+    if (_lane_count > 1) {
+        b.get_vector(_lane_angle_increment);
+        b.get_vector(_lane_phase_increment);
+        b.get_vector(_lane_phase_cur);
+        b.get_vector(_lane_rate_cur);
+    }
+}
+
+inline void Sine :: _render_phases(const SampleT* rate, const SampleT* phase,
+        SampleT* out, FrameSizeT fs, SampleT& angle_increment,
+        SampleT& phase_increment, SampleT& phase_cur, SampleT& rate_cur) {
+    for (_i=0; _i < fs; ++_i) {
+        // whne phase input changes, set cur value to that value; not sure this is the right way to do this but maybe, as an phasor driving 1 to 2IP would oscillate
+        if (phase[_i] != phase_increment) {
+            phase_increment = phase[_i];
+            phase_cur = phase_increment; 
+        }
+        phase_limiter(phase_cur); // inllined, in place
+    
+        // phase input is a phase offset; the sine is taken after the frame
+        out[_i] = phase_cur;
+        
+        if (rate[_i] != rate_cur) {
+            rate_cur = rate[_i];
+            // find scalar (proportion) of how much each processing sample is of a cycle; e.g., fq 441 in 44100 sr, each proc sample is .01 of a complete osc
+            //_angle_increment = PI2 * _rate_cur / _sampling_rate;
+            angle_increment = rate_context_to_angle_increment(
+                    rate_cur, 
+                    PTypeRateContext::resolve(
+                    _slots[_slot_index_rate_context]->outputs[0][0]), 
+                    _sampling_rate, 
+                    _nyquist);
+        }
+        phase_cur += angle_increment;
+        
+        phase_limiter(phase_cur); // inllined, in place
+    }
 }
 
 void Sine :: render(RenderCountT f) {
     while (_render_count < f) {
         _render_inputs(f);
-		_sum_inputs(_frame_size);
-        
-		for (_i=0; _i < _frame_size; ++_i) {
-
-            // whne phase input changes, set cur value to that value; not sure this is the right way to do this but maybe, as an phasor driving 1 to 2IP would oscillate
-            if (_summed_inputs[_input_index_phase][_i] != _phase_increment) {
-                _phase_increment = _summed_inputs[_input_index_phase][_i];
-                _phase_cur = _phase_increment; 
+        if (_lane_count == 1) {
+            _sum_inputs(_frame_size);
+            _render_phases(_summed_inputs[_input_index_rate].data(),
+                    _summed_inputs[_input_index_phase].data(),
+                    outputs[0].data(), _frame_size, _angle_increment,
+                    _phase_increment, _phase_cur, _rate_cur);
+            for (_i=0; _i < _frame_size; ++_i) {
+                outputs[0][_i] = sin(outputs[0][_i]);
             }
-            phase_limiter(_phase_cur); // inllined, in place
-        
-            // phase input is a phase offset                 
-            outputs[0][_i] = sin(_phase_cur);
-            
-            if (_summed_inputs[_input_index_rate][_i] != _rate_cur) {
-                _rate_cur = _summed_inputs[_input_index_rate][_i];
-                // find scalar (proportion) of how much each processing sample is of a cycle; e.g., fq 441 in 44100 sr, each proc sample is .01 of a complete osc
-                //_angle_increment = PI2 * _rate_cur / _sampling_rate;
-                _angle_increment = rate_context_to_angle_increment(
-                        _rate_cur, 
-                        PTypeRateContext::resolve(
-                        _slots[_slot_index_rate_context]->outputs[0][0]), 
-                        _sampling_rate, 
-                        _nyquist);
+        }
+        else {
+            _sum_input_lanes(_frame_size);
+            for (PIndexT l=0; l < _lane_count; ++l) {
+                _render_phases(
+                        _summed_lanes[_input_index_rate].data() +
+                        l * _frame_size,
+                        _summed_lanes[_input_index_phase].data() +
+                        l * _frame_size,
+                        outputs[l].data(), _frame_size,
+                        _lane_angle_increment[l], _lane_phase_increment[l],
+                        _lane_phase_cur[l], _lane_rate_cur[l]);
+                // lanes take the sine with a polynomial, two samples at once, rather than sin()
+                sin_samples(outputs[l].data(), outputs[l].data(),
+                        _frame_size);
             }
-            _phase_cur += _angle_increment;
-            
-            phase_limiter(_phase_cur); // inllined, in place
         }
-        
         _render_count += 1;
     }
 }
@@ -2217,48 +3618,38 @@ void Map :: reset() {
     Gen::reset();
 }
 
+void Map :: set_lane_count(PIndexT n) {
+    _set_lane_outputs(n);
+    reset();
+}
+
 void Map :: render(RenderCountT f) {
-    
     while (_render_count < f) {
         _render_inputs(f);
-		_sum_inputs(_frame_size);
-
-		for (_i=0; _i < _frame_size; ++_i) {
-            // must get true min max
-            true_min_max(
-                    _summed_inputs[_input_index_src_lower][_i],
-                    _summed_inputs[_input_index_src_upper][_i],
-                    &_min_src,
-                    &_max_src
-                    );
-            true_min_max(
-                    _summed_inputs[_input_index_dst_lower][_i],
-                    _summed_inputs[_input_index_dst_upper][_i],
-                    &_min_dst,
-                    &_max_dst
-                    );
-            // if input is beyond min/max defined as source, it is clipped
-			_limit_src = double_limiter(
-                    _summed_inputs[_input_index_src][_i], _min_src, _max_src
-                    );
-            _range_src = _max_src - _min_src; // no abs necessary
-            _range_dst = _max_dst - _min_dst; // no abs necessary
-            // _limit_src needs to be shifted to start from zero; if range is -3, 1 then need to add 3; if range is 3, 10, need to subtact 3; thus, -(min)
-            if (_range_src != 0 && _range_dst != 0) {
-                // get percentage of src, apply to range of dst + shift
-                outputs[0][_i] = (
-                        ((_limit_src - _min_src) / _range_src) *
-                        _range_dst) + _min_dst;
-            }
-            else {
-                // if we have no range on input, it means that our source boundaries are the same, which means that we have clipped to a constant; there is no sensible mapping (dst lower, upper, middle are all vialable / if we have no range on output, it menans dst boundaries are the same, so we should output that value; thus in either case, simply returning the dst min is acceptable.
-                outputs[0][_i] = _min_dst;
+        // boundaries are read for each sample, and may be given in either order; a source beyond its boundaries is clipped
+        if (_lane_count == 1) {
+            _sum_inputs(_frame_size);
+            map_samples(_summed_inputs[_input_index_src].data(),
+                    _summed_inputs[_input_index_src_lower].data(),
+                    _summed_inputs[_input_index_src_upper].data(),
+                    _summed_inputs[_input_index_dst_lower].data(),
+                    _summed_inputs[_input_index_dst_upper].data(),
+                    outputs[0].data(), _frame_size);
+        }
+        else {
+            _sum_input_lanes(_frame_size);
+            for (PIndexT l=0; l < _lane_count; ++l) {
+                OutputsSizeT start = l * _frame_size;
+                map_samples(_summed_lanes[_input_index_src].data() + start,
+                        _summed_lanes[_input_index_src_lower].data() + start,
+                        _summed_lanes[_input_index_src_upper].data() + start,
+                        _summed_lanes[_input_index_dst_lower].data() + start,
+                        _summed_lanes[_input_index_dst_upper].data() + start,
+                        outputs[l].data(), _frame_size);
             }
-		}
-        //std::cout << "_period_samples: " << _period_samples << std::endl;        
+        }
         _render_count += 1;
     }
-    
 }
 
 
@@ -2316,6 +3707,7 @@ void AttackDecay :: set_default() {
 
 void AttackDecay :: reset() {
     Gen::reset();
+    _events_trigger.reserve(_frame_size);
     _progress_samps = 0;
     _env_stage = 0;
     _last_amp = 0;
@@ -2323,18 +3715,61 @@ void AttackDecay :: reset() {
     _trigger_a = false;
 }
 
+void AttackDecay :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put(_a_samps);
+    b.put(_d_samps);
+    b.put(_last_amp);
+    b.put(_stage_amp_range);
+    b.put(_trigger_a);
+    b.put(_progress_samps);
+    b.put(_env_stage);
+    b.put(_amp);
+}
+
+void AttackDecay :: read_state(StateBlob& b) {
+    Gen::read_state(b);
+    b.get(_a_samps);
+    b.get(_d_samps);
+    b.get(_last_amp);
+    b.get(_stage_amp_range);
+    b.get(_trigger_a);
+    b.get(_progress_samps);
+    b.get(_env_stage);
+    b.get(_amp);
+}
+
 void AttackDecay :: render(RenderCountT f) {
     // TODO: have this support gates; sustain if fall is > creater than attack; never do less than attack if gate falls before end of attack
     
+    bool trigger_events;
+    bool trigger;
     while (_render_count < f) {
         _render_inputs(f);
 		_sum_inputs(_frame_size);
+        // if the trigger input provides events, we step through them with a cursor rather than testing every sample against the threshold
+        trigger_events = _collect_input_events(_input_index_trigger,
+                _events_trigger);
+        _events_trigger_pos = 0;
+        output_events[_output_index_eoa].clear();
+        output_events[_output_index_eod].clear();
+        
 		for (_i=0; _i < _frame_size; ++_i) {
 
             // alway set to zero unless we have a change
             outputs[_output_index_eoa][_i] = 0.0;
             outputs[_output_index_eod][_i] = 0.0;
 
+            if (trigger_events) {
+                trigger = (_events_trigger_pos < _events_trigger.size() &&
+                        _events_trigger[_events_trigger_pos] == _i);
+                if (trigger) ++_events_trigger_pos;
+            }
+            else {
+                trigger = (_summed_inputs[_input_index_trigger][_i] >
+                        TRIG_THRESH);
+            }
+
             // convert to samples; will truncate to int; might need to round
             _a_samps = fabs(_summed_inputs[_input_index_attack][_i] *
                     static_cast<SampleT>(_sampling_rate));
@@ -2346,7 +3781,7 @@ void AttackDecay :: render(RenderCountT f) {
                     _env_stage == 0) {
                 _trigger_a = true;
             }
-            else if (_summed_inputs[_input_index_trigger][_i] > TRIG_THRESH) {
+            else if (trigger) {
                 _trigger_a = true;
             }
             // determine stage: these are called once
@@ -2364,6 +3799,7 @@ void AttackDecay :: render(RenderCountT f) {
                 _stage_amp_range = 1 - _last_amp;                
                 // trig end of attack
                 outputs[_output_index_eoa][_i] = 1.0;
+                output_events[_output_index_eoa].push_back(_i);
             }            
             // if we are in stage 2 and our progress is > decay samples, move to silence
             if (_progress_samps > _d_samps && _env_stage == 2) {
@@ -2373,6 +3809,7 @@ void AttackDecay :: render(RenderCountT f) {
                 _stage_amp_range = 1; // decay is always from 1
                  // trig end of decay
                 outputs[_output_index_eod][_i] = 1.0;
+                output_events[_output_index_eod].push_back(_i);
             }
             
             // the following are called repeatedly within a selected stage
@@ -2488,6 +3925,24 @@ void Counter :: reset() {
     Gen::reset();
     _di->reset();
     _has_first_pos = false;
+    _events_trigger.reserve(_frame_size);
+    _events_reset.reserve(_frame_size);
+}
+
+void Counter :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put(_last_pos);
+    b.put(_last_direction);
+    b.put(_has_first_pos);
+    _di->write_state(b);
+}
+
+void Counter :: read_state(StateBlob& b) {
+    Gen::read_state(b);
+    b.get(_last_pos);
+    b.get(_last_direction);
+    b.get(_has_first_pos);
+    _di->read_state(b);
 }
 
 void Counter :: _update_for_new_slot() {
@@ -2498,10 +3953,84 @@ void Counter :: _update_for_new_slot() {
     _has_first_pos = false;
 }
 
+void Counter :: _update_direction(FrameSizeT i) {
+    if (_summed_inputs[_input_index_direction][i] != 
+                _last_direction || !_has_first_pos) {
+        _last_direction = _summed_inputs[_input_index_direction][i];
+        _di->set_direction(PTypeDirection::resolve(_last_direction));
+    }
+}
+
+void Counter :: _render_events() {
+    // outputs only change at a trigger; direction only matters when next() or reset() is called, so we only read direction at event positions and at the end of the frame. Between events we fill a constant segment.
+    std::size_t t_pos {0};
+    std::size_t r_pos {0};
+    std::size_t t_count {_events_trigger.size()};
+    std::size_t r_count {_events_reset.size()};
+    FrameSizeT seg_start {0};
+    FrameSizeT p;
+    bool trigger;
+    
+    while (true) {
+        // find the next event position; without a first position, we must start at zero
+        p = _has_first_pos ? _frame_size : 0;
+        if (t_pos < t_count && _events_trigger[t_pos] < p) {
+            p = _events_trigger[t_pos];
+        }
+        if (r_pos < r_count && _events_reset[r_pos] < p) {
+            p = _events_reset[r_pos];
+        }
+        std::fill(outputs[0].begin() + seg_start, 
+                outputs[0].begin() + p, _last_pos);
+        if (p >= _frame_size) break;
+        
+        // apply direction as it was just before this sample, as a reset depends on direction
+        if (p > 0) _update_direction(p - 1);
+        if (r_pos < r_count && _events_reset[r_pos] == p) {
+            _di->reset();
+            ++r_pos;
+        }
+        _update_direction(p);
+        trigger = (t_pos < t_count && _events_trigger[t_pos] == p);
+        if (trigger) ++t_pos;
+        if (trigger || !_has_first_pos) {
+            _last_pos = static_cast<SampleT>(_di->next());
+            _has_first_pos = true;
+        }
+        outputs[0][p] = _last_pos;
+        seg_start = p + 1;
+    }
+    _update_direction(_frame_size - 1);
+}
+
+GenPtr Counter :: _copy() const {
+    CounterPtr c(new Counter(*this));
+    // the index carries the count, and must not be shared
+    if (_di != nullptr) {
+        c->_di = std::make_shared<DirectedIndex>(*_di);
+    }
+    c->_events_trigger.reserve(_frame_size);
+    c->_events_reset.reserve(_frame_size);
+    return c;
+}
+
+GenPtr AttackDecay :: _copy() const {
+    AttackDecayPtr c(new AttackDecay(*this));
+    c->_events_trigger.reserve(_frame_size);
+    return c;
+}
+
 void Counter :: render(RenderCountT f) {
     while (_render_count < f) {
         _render_inputs(f);
         _sum_inputs(_frame_size);
+        // if triggers and resets are sparse, we can jump between them
+        if (_collect_input_events(_input_index_trigger, _events_trigger) &&
+                _collect_input_events(_input_index_reset, _events_reset)) {
+            _render_events();
+            _render_count += 1;
+            continue;
+        }
         for (_i=0; _i < _frame_size; ++_i) {
             // reset di; values will not be updated on output unitl next rigger
             if (_summed_inputs[_input_index_reset][_i] > TRIG_THRESH) {
@@ -2668,6 +4197,7 @@ void Sequencer :: _update_for_new_slot() {
     
     // this is number of steps in the sequencer range
     _buffer_frame_size = _slots[_slot_index_buffer]->get_frame_size();
+    _buffer = dynamic_cast<SamplesBuffer*>(_slots[_slot_index_buffer].get());
     // this is the number of outputs
     _buffer_output_count = _slots[_slot_index_buffer]->get_output_count();
     // std::cout << "buf outs: " << outs << std::endl;
@@ -2698,7 +4228,21 @@ void Sequencer :: reset() {
     Gen::reset();
 }
 
+void Sequencer :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put(_last_buffer_index);
+    b.put(_out_pos);
+}
+
+void Sequencer :: read_state(StateBlob& b) {
+    Gen::read_state(b);
+    b.get(_last_buffer_index);
+    b.get(_out_pos);
+}
+
 void Sequencer :: render(RenderCountT f) {
+    // a buffer loaded asynchronously is first needed here
+    _slots[_slot_index_buffer]->wait_loaded();
 
     // can only update once per render call; not assumed to be a problem
     _boundary_context = PTypeBoundaryContext::resolve(
@@ -2707,6 +4251,25 @@ void Sequencer :: render(RenderCountT f) {
     while (_render_count < f) {
         _render_inputs(f);
         _sum_inputs(_frame_size);
+        if (_buffer != nullptr && _buffer->is_compact()) {
+            // find all indices, then decode each output at once
+            _indices.resize(_frame_size);
+            for (_i=0; _i < _frame_size; ++_i) {
+                _indices[_i] = static_cast<FrameSizeT>(unbound_to_bound(
+                        _summed_inputs[_input_index_selection][_i],
+                        _boundary_context,
+                        0,
+                        _buffer_frame_size - 1
+                        ));
+            }
+            for (_out_pos=0; _out_pos<_buffer_output_count; ++_out_pos) {
+                _buffer->gather(_out_pos, _indices.data(), _frame_size,
+                        outputs[_out_pos].data());
+            }
+            _last_buffer_index = _indices[_frame_size - 1];
+            _render_count += 1;
+            continue;
+        }
         for (_i=0; _i < _frame_size; ++_i) {
             // can update on every frame, as at any sample the value might move to a new index
             // this value needs to be controlled; either limited or modulo
@@ -2731,9 +4294,872 @@ void Sequencer :: render(RenderCountT f) {
 
 
 
+//------------------------------------------------------------------------------
+FilePlayer :: FilePlayer(EnvPtr e) 
+    : Gen(e) {
+    _class_name = "FilePlayer";
+    _class_id = GenID::FilePlayer;
+}
+
+FilePlayer :: ~FilePlayer() {
+    _stop_reader();
+}
+
+void FilePlayer :: init() {
+    Gen::init();
+    _clear_output_parameter_types(); // must clear the default set by Gen init
+    // without a file, one silent output
+    _register_output_parameter_type(
+            PType::make_with_name(PTypeID::Value, "Output 1"));
+}
+
+void FilePlayer :: set_outputs_from_fp(const std::string& fp) {
+    std::unique_ptr<SndfileHandle> file(new SndfileHandle(fp));
+    if (!(*file) || file->channels() <= 0) {
+        std::stringstream msg;
+        msg << "cannot open sound file for playing: " << fp
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    _stop_reader();
+    _file = std::move(file);
+    _fp = fp;
+    _clear_output_parameter_types();
+    std::stringstream name;
+    for (int i=0; i < _file->channels(); ++i) {
+        name.str("");
+        name << "Output " << i+1;
+        _register_output_parameter_type(
+                PType::make_with_name(PTypeID::Value, name.str()));
+    }
+    reset();
+}
+
+void FilePlayer :: set_outputs(const std::string& fp) {
+    set_outputs_from_fp(fp);
+}
+
+void FilePlayer :: set_read_ahead(std::size_t blocks) {
+    if (blocks < 1) {
+        std::stringstream msg;
+        msg << "read ahead must be at least one block"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    _read_ahead = blocks;
+}
+
+SampleTimeT FilePlayer :: get_file_frames() const {
+    return _file ? static_cast<SampleTimeT>(_file->frames()) : 0;
+}
+
+bool FilePlayer :: _read_next() {
+    FrameSizeT fs = _frame_size;
+    sf_count_t n = _file->readf(_read_block.data(), fs);
+    if (n < 0) n = 0;
+    if (static_cast<FrameSizeT>(n) < fs) {
+        std::fill(_read_block.begin() + (n * get_output_count()),
+                _read_block.end(), 0);
+    }
+    if (n > 0) {
+        _ring->push(_read_block);
+    }
+    if (static_cast<FrameSizeT>(n) < fs) {
+        _end_of_file.store(true, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
 
+void FilePlayer :: _read() {
+    while (_reading.load()) {
+        // only this thread pushes, so the ring cannot fill after this check
+        if (_ring->size() >= _ring->capacity()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (!_read_next()) break;
+    }
+}
 
-} // end namespaces aw
+void FilePlayer :: _start_reader() {
+    if (!_file) return;
+    std::size_t size = _frame_size * get_output_count();
+    // storage is sized here, such that blocks circulate without allocation
+    if (!_ring || _ring->capacity() != _read_ahead || _block.size() != size) {
+        _ring.reset(new SPSCRing<VSampleT>(_read_ahead, VSampleT(size, 0)));
+        _block.assign(size, 0);
+        _read_block.assign(size, 0);
+    }
+    _end_of_file.store(_position >= get_file_frames());
+    if (_end_of_file.load()) return;
+    _file->seek(static_cast<sf_count_t>(_position), SEEK_SET);
+    // fill the ring here, such that rendering can start at once
+    while (_ring->size() < _ring->capacity()) {
+        if (!_read_next()) return;
+    }
+    _reading.store(true);
+    _reader = std::thread(&FilePlayer::_read, this);
+}
 
+void FilePlayer :: _stop_reader() {
+    _reading.store(false);
+    if (_reader.joinable()) {
+        _reader.join();
+    }
+    if (_ring) {
+        while (_ring->pop(_block)) {} // discard
+    }
+}
 
+void FilePlayer :: reset() {
+    Gen::reset();
+    _stop_reader();
+    _position = 0;
+    _underrun_count.store(0);
+    _start_reader();
+}
 
+void FilePlayer :: _advance(SampleTimeT samples) {
+    _stop_reader();
+    _position += samples;
+    _start_reader();
+}
+
+void FilePlayer :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put(_position);
+}
+
+void FilePlayer :: read_state(StateBlob& b) {
+    Gen::read_state(b);
+    SampleTimeT position;
+    b.get(position);
+    _stop_reader();
+    _position = position;
+    _start_reader();
+}
+
+void FilePlayer :: render(RenderCountT f) {
+    PIndexT ch = get_output_count();
+    PIndexT c;
+    FrameSizeT i;
+    bool done;
+    while (_render_count < f) {
+        // read before taking, such that a block pushed before the end is not missed
+        done = _end_of_file.load(std::memory_order_acquire);
+        if (_ring && _ring->pop(_block)) {
+            const SampleT* src = _block.data();
+            for (i=0; i < _frame_size; ++i) {
+                for (c=0; c < ch; ++c) {
+                    outputs[c][i] = *src++;
+                }
+            }
+            _position += _frame_size;
+        }
+        else {
+            for (c=0; c < ch; ++c) {
+                std::fill(outputs[c].begin(), outputs[c].end(), 0);
+            }
+            if (_file && !done) {
+                _underrun_count.fetch_add(1);
+            }
+        }
+        _render_count += 1;
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+Resampler :: Resampler(EnvPtr e) 
+    : Gen(e) {
+    _class_name = "Resampler";
+    _class_id = GenID::Resampler;
+}
+
+void Resampler :: init() {
+    Gen::init();
+    _clear_output_parameter_types(); // must clear the default set by Gen init
+
+    _input_index_signal = _register_input_parameter_type(
+            PType::make_with_name(PTypeID::Value, "Signal"));
+    _input_index_rate = _register_input_parameter_type(
+            PType::make_with_name(PTypeID::Value,
+            "Rate (input samples per output sample)"));
+
+    _register_output_parameter_type(
+            PType::make_with_name(PTypeID::Value, "Output"));
+
+    set_quality(ResampleQuality::Medium); // resets
+    set_default();
+}
+
+void Resampler :: set_default() {
+    set_input_by_index(_input_index_rate, 1);
+}
+
+void Resampler :: set_quality(ResampleQuality q) {
+    _resampler.reset(new PolyphaseResampler(q));
+    _max_reach = _resampler->get_reach(_resampler->get_cutoff(_max_rate));
+    reset();
+}
+
+void Resampler :: reset() {
+    Gen::reset();
+    if (!_resampler) return;
+    // zeros before the first input sample, such that reads never precede history
+    _history.assign(_max_reach, 0);
+    _pos = _max_reach;
+    _input_render_count = 0;
+}
+
+void Resampler :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put_vector(_history);
+    b.put(_pos);
+    b.put(_input_render_count);
+}
+
+void Resampler :: read_state(StateBlob& b) {
+    Gen::read_state(b);
+    b.get_vector(_history);
+    b.get(_pos);
+    b.get(_input_render_count);
+}
+
+void Resampler :: _read_frame() {
+    ++_input_render_count;
+    FrameSizeT cfs = get_common_frame_size();
+    std::size_t start = _history.size();
+    _history.resize(start + cfs, 0);
+    for (auto& g : _inputs[_input_index_signal]) {
+        g.first->render(_input_render_count);
+        const VSampleT& v = g.first->outputs[g.second];
+        for (FrameSizeT i=0; i < cfs; ++i) {
+            _history[start + i] += v[i];
+        }
+    }
+}
+
+void Resampler :: render(RenderCountT f) {
+    SampleT rate;
+    double cutoff;
+    std::int64_t reach;
+    while (_render_count < f) {
+        // only the rate is rendered at our render count
+        for (auto& g : _inputs[_input_index_rate]) {
+            g.first->render(_render_count + 1);
+        }
+        for (FrameSizeT i=0; i < _frame_size; ++i) {
+            rate = 0;
+            for (auto& g : _inputs[_input_index_rate]) {
+                rate += g.first->outputs[g.second][i];
+            }
+            rate = std::max(SampleT(0), std::min(rate, _max_rate));
+            cutoff = _resampler->get_cutoff(rate);
+            reach = _resampler->get_reach(cutoff);
+            while (static_cast<std::int64_t>(_history.size()) <=
+                    static_cast<std::int64_t>(_pos) + reach) {
+                _read_frame();
+            }
+            outputs[0][i] = _resampler->interpolate(_history.data(), _pos,
+                    cutoff);
+            _pos += rate;
+        }
+        // discard history no longer reachable
+        std::int64_t drop = static_cast<std::int64_t>(_pos) - _max_reach;
+        if (drop > 0) {
+            _history.erase(_history.begin(), _history.begin() + drop);
+            _pos -= drop;
+        }
+        _render_count += 1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+VoiceAllocator :: VoiceAllocator(EnvPtr e)
+    : Gen(e) {
+    _class_name = "VoiceAllocator";
+    _class_id = GenID::VoiceAllocator;
+}
+
+void VoiceAllocator :: init() {
+    Gen::init();
+    _clear_output_parameter_types(); // must clear the default set by Gen init
+
+    _input_index_trigger = _register_input_parameter_type(
+            PType::make_with_name(PTypeID::Trigger, "Trigger"));
+    _input_index_value = _register_input_parameter_type(
+            PType::make_with_name(PTypeID::Value, "Value"));
+
+    // without a voice, one silent output
+    _register_output_parameter_type(
+            PType::make_with_name(PTypeID::Value, "Output 1"));
+
+    set_default();
+    reset();
+}
+
+void VoiceAllocator :: set_default() {
+    set_input_by_index(_input_index_trigger, 0);
+    set_input_by_index(_input_index_value, 0);
+}
+
+void VoiceAllocator :: reset() {
+    Gen::reset();
+    _events_trigger.reserve(_frame_size);
+    _note_count = 0;
+    for (auto& v : _voices) {
+        // a woken voice must not resume an envelope, phase, or value from before
+        v.value->set_input_by_index(0, v.value_init);
+        v.gen->reset_network();
+        v.active = false;
+        v.started = 0;
+        v.silent_frames = 0;
+        v.peak = 0;
+    }
+}
+
+void VoiceAllocator :: write_state(StateBlob& b) const {
+    Gen::write_state(b);
+    b.put(_note_count);
+    b.put(static_cast<std::uint64_t>(_voices.size()));
+    for (auto& v : _voices) {
+        b.put(v.active);
+        b.put(v.started);
+        b.put(v.silent_frames);
+        b.put(v.peak);
+        b.put_blob(v.gen->snapshot_network());
+    }
+}
+
+void VoiceAllocator :: read_state(StateBlob& b) {
+    Gen::read_state(b);
+    b.get(_note_count);
+    std::uint64_t count;
+    b.get(count);
+    if (count != _voices.size()) {
+        std::stringstream msg;
+        msg << "snapshot has " << count << " voices, not "
+                << _voices.size() << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    StateBlob voice;
+    for (auto& v : _voices) {
+        b.get(v.active);
+        b.get(v.started);
+        b.get(v.silent_frames);
+        b.get(v.peak);
+        b.get_blob(voice);
+        v.gen->restore_network(voice);
+    }
+}
+
+GenPtr VoiceAllocator :: _copy() const {
+    VoiceAllocatorPtr c(new VoiceAllocator(*this));
+    // voices are not inputs, and would otherwise be shared
+    for (std::size_t i=0; i < _voices.size(); ++i) {
+        c->_voices[i] = _clone_voice(_voices[i]);
+    }
+    c->_events_trigger.reserve(_frame_size);
+    return c;
+}
+
+VoiceAllocator::Voice VoiceAllocator :: _clone_voice(const Voice& v) {
+    std::unordered_map<const Gen*, GenPtr> copied;
+    copied.reserve(64);
+    Voice c(v);
+    c.gen = v.gen->clone(copied);
+    c.trigger = std::dynamic_pointer_cast<Constant>(
+            copied[v.trigger.get()]);
+    c.value = std::dynamic_pointer_cast<Constant>(copied[v.value.get()]);
+    if (v.envelope) {
+        c.envelope = copied[v.envelope.get()];
+    }
+    return c;
+}
+
+void VoiceAllocator :: set_voice(GenPtr voice, GenPtr trigger,
+        GenPtr value, PIndexT count, GenPtr envelope) {
+    std::stringstream msg;
+    if (!voice || count < 1) {
+        msg << "a voice network and a count of at least one are required";
+    }
+    else if (voice->get_frame_size() != _frame_size) {
+        msg << "voice frame size " << voice->get_frame_size()
+                << " differs from " << _frame_size;
+    }
+    else if (!std::dynamic_pointer_cast<Constant>(trigger) ||
+            !std::dynamic_pointer_cast<Constant>(value)) {
+        msg << "voice trigger and value must be Constants";
+    }
+    else {
+        // the Gens must be within the network of voice to be copied with it
+        std::unordered_map<const Gen*, GenPtr> copied;
+        voice->clone(copied);
+        if (copied.count(trigger.get()) == 0 ||
+                copied.count(value.get()) == 0 ||
+                (envelope && copied.count(envelope.get()) == 0)) {
+            msg << "voice trigger, value, and envelope must be in the voice network";
+        }
+    }
+    if (msg.tellp() > 0) {
+        msg << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    Voice v;
+    v.gen = voice;
+    v.trigger = std::dynamic_pointer_cast<Constant>(trigger);
+    v.value = std::dynamic_pointer_cast<Constant>(value);
+    v.envelope = envelope;
+    v.value_init = v.value->get_value();
+    // all voices are made now, such that notes never allocate
+    _voices.clear();
+    _voices.reserve(count);
+    for (PIndexT i=0; i < count; ++i) {
+        _voices.push_back(_clone_voice(v));
+    }
+    _clear_output_parameter_types();
+    std::stringstream name;
+    for (PIndexT i=0; i < voice->get_output_count(); ++i) {
+        name.str("");
+        name << "Output " << i+1;
+        _register_output_parameter_type(
+                PType::make_with_name(PTypeID::Value, name.str()));
+    }
+    reset();
+}
+
+PIndexT VoiceAllocator :: get_active_voice_count() const {
+    PIndexT count = 0;
+    for (auto& v : _voices) {
+        count += v.active;
+    }
+    return count;
+}
+
+void VoiceAllocator :: set_sleep(SampleT threshold, RenderCountT frames) {
+    if (threshold < 0 || frames < 1) {
+        std::stringstream msg;
+        msg << "sleep threshold must not be negative, and sleep frames at least one"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    _sleep_threshold = threshold;
+    _sleep_frames = frames;
+}
+
+void VoiceAllocator :: _start_note(FrameSizeT offset, SampleT value) {
+    Voice* v = nullptr;
+    for (auto& candidate : _voices) {
+        if (!candidate.active) {
+            v = &candidate;
+            break;
+        }
+    }
+    if (v == nullptr) {
+        if (_steal == VoiceSteal::None || _voices.empty()) {
+            return;
+        }
+        v = &_voices[0];
+        for (auto& candidate : _voices) {
+            if (_steal == VoiceSteal::Oldest ?
+                    candidate.started < v->started :
+                    candidate.peak < v->peak) {
+                v = &candidate;
+            }
+        }
+    }
+    // the voice renders its inputs at its own next render count
+    RenderCountT f = v->gen->get_render_count() + 1;
+    v->value->set_value_at(f, offset, value);
+    v->trigger->set_trigger_at(f, offset);
+    v->active = true;
+    v->started = ++_note_count;
+    v->silent_frames = 0;
+}
+
+void VoiceAllocator :: render(RenderCountT f) {
+    PIndexT out_count = get_output_count();
+    PIndexT i;
+    FrameSizeT k;
+    SampleT peak;
+    while (_render_count < f) {
+        _render_inputs(f);
+        _sum_inputs(_frame_size);
+        // if the trigger input provides events, we need not test every sample against the threshold
+        if (!_collect_input_events(_input_index_trigger, _events_trigger)) {
+            _events_trigger.clear();
+            for (k=0; k < _frame_size; ++k) {
+                if (_summed_inputs[_input_index_trigger][k] > TRIG_THRESH) {
+                    _events_trigger.push_back(k);
+                }
+            }
+        }
+        for (FrameSizeT offset : _events_trigger) {
+            _start_note(offset, _summed_inputs[_input_index_value][offset]);
+        }
+        for (i=0; i < out_count; ++i) {
+            std::fill(outputs[i].begin(), outputs[i].end(), 0);
+        }
+        for (auto& v : _voices) {
+            if (!v.active) continue;
+            v.gen->render(v.gen->get_render_count() + 1);
+            peak = 0;
+            for (i=0; i < out_count; ++i) {
+                const SampleT* src = v.gen->outputs[i].data();
+                SampleT* dst = outputs[i].data();
+                for (k=0; k < _frame_size; ++k) {
+                    dst[k] += src[k];
+                }
+                if (!v.envelope) {
+                    for (k=0; k < _frame_size; ++k) {
+                        peak = std::max(peak, std::fabs(src[k]));
+                    }
+                }
+            }
+            if (v.envelope) {
+                const VSampleT& e = v.envelope->outputs[0];
+                for (k=0; k < _frame_size; ++k) {
+                    peak = std::max(peak, std::fabs(e[k]));
+                }
+            }
+            v.peak = peak;
+            if (peak > _sleep_threshold) {
+                v.silent_frames = 0;
+            }
+            else if (++v.silent_frames >= _sleep_frames) {
+                v.active = false;
+            }
+        }
+        _render_count += 1;
+    }
+}
+//-----------------------------------------------------------------------------
+//! Return the libsndfile format for a path and sample encoding.
+inline int sound_file_format(const std::string& fp, SampleFormat format) {
+    int container = SF_FORMAT_AIFF;
+    std::string ext = boost::filesystem::path(fp).extension().string();
+    if (ext == ".wav" || ext == ".WAV") {
+        container = SF_FORMAT_WAV;
+    }
+    if (format == SampleFormat::PCM24) {
+        return container | SF_FORMAT_PCM_24;
+    }
+    else if (format == SampleFormat::Float32) {
+        return container | SF_FORMAT_FLOAT;
+    }
+    else if (format == SampleFormat::Float64) {
+        return container | SF_FORMAT_DOUBLE;
+    }
+    return container | SF_FORMAT_PCM_16;
+}
+
+SoundFileWriter :: SoundFileWriter(const std::string& fp, PIndexT channels,
+        OutputsSizeT sampling_rate, SampleFormat format,
+        FrameSizeT chunk_frames, std::size_t queue_depth)
+    : _fp{fp},
+    _channels{channels},
+    _chunk_frames{chunk_frames} {
+    if (channels < 1 || chunk_frames < 1 || queue_depth < 1) {
+        std::stringstream msg;
+        msg << "channels, chunk frames, and queue depth must be at least 1"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    _file.reset(new SndfileHandle(fp, SFM_WRITE,
+            sound_file_format(fp, format), static_cast<int>(channels),
+            static_cast<int>(sampling_rate)));
+    if (not *_file) {
+        _file.reset();
+        std::stringstream msg;
+        msg << "cannot open file for writing: " << fp
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    // storage is sized here, such that chunks circulate without allocation
+    Chunk proto;
+    proto.samples.assign(chunk_frames * channels, 0);
+    _ring.reset(new SPSCRing<Chunk>(queue_depth, proto));
+    _chunk = proto;
+    _write_chunk = proto;
+    _writing.store(true);
+    _writer = std::thread(&SoundFileWriter::_write, this);
+}
+
+SoundFileWriter :: ~SoundFileWriter() {
+    try {
+        close();
+    }
+    catch (std::exception&) {}
+}
+
+void SoundFileWriter :: _push() {
+    // only this thread pushes, so waiting cannot deadlock
+    while (!_ring->push(_chunk)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // a chunk from the ring was swapped in; its storage is reused
+    _chunk.frames = 0;
+}
+
+void SoundFileWriter :: _write() {
+    while (true) {
+        if (_ring->pop(_write_chunk)) {
+            sf_count_t n = _file->writef(_write_chunk.samples.data(),
+                    _write_chunk.frames);
+            if (n != static_cast<sf_count_t>(_write_chunk.frames)) {
+                _failed.store(true);
+            }
+        }
+        // chunks pushed before _writing is cleared are visible after
+        else if (!_writing.load()) {
+            if (_ring->size() == 0) break;
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void SoundFileWriter :: _check() const {
+    if (_failed.load()) {
+        std::stringstream msg;
+        msg << "cannot write to file: " << _fp
+                << str_file_line(__FILE__, __LINE__);
+        throw std::domain_error(msg.str());
+    }
+}
+
+void SoundFileWriter :: write(const SampleT* interleaved,
+        FrameSizeT frames) {
+    if (!_file) {
+        std::stringstream msg;
+        msg << "file is closed: " << _fp
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    _check();
+    while (frames > 0) {
+        FrameSizeT n = std::min(frames, _chunk_frames - _chunk.frames);
+        std::copy(interleaved, interleaved + (n * _channels),
+                _chunk.samples.begin() + (_chunk.frames * _channels));
+        _chunk.frames += n;
+        _frames += n;
+        interleaved += n * _channels;
+        frames -= n;
+        if (_chunk.frames == _chunk_frames) {
+            _push();
+        }
+    }
+}
+
+void SoundFileWriter :: close() {
+    if (!_file) return;
+    if (_chunk.frames > 0) {
+        _push();
+    }
+    _writing.store(false);
+    if (_writer.joinable()) {
+        _writer.join();
+    }
+    // destroying the handle writes the header and closes the file
+    _file.reset();
+    _check();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+CommandQueue :: CommandQueue(std::size_t capacity, std::size_t add_reserve)
+    : _commands{capacity},
+    _retired{capacity},
+    _add_reserve{add_reserve} {
+    if (capacity < 1) {
+        std::stringstream msg;
+        msg << "capacity must be greater than 0"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+void CommandQueue :: _validate_input(GenPtr g, PIndexT i, GenPtr src,
+        PIndexT pos) const {
+    if (!g || !src) {
+        std::stringstream msg;
+        msg << "a target and a source Gen are required"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    if (g->get_input_count() <= 0 or i >= g->get_input_count()) {
+        std::stringstream msg;
+        msg << "Parameter index is not available: " << i
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    if (pos >= src->get_output_count()) {
+        std::stringstream msg;
+        msg << "position exceeds output count on passed input" << i
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+void CommandQueue :: _validate_slot(GenPtr g, PIndexT i,
+        GenPtr src) const {
+    if (!g || !src) {
+        std::stringstream msg;
+        msg << "a target and a source Gen are required"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    if (g->get_slot_count() <= 0 or i >= g->get_slot_count()) {
+        std::stringstream msg;
+        msg << "Slot index is not available: " << i
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    PTypePtr pt = g->get_parameter_type(i, ConnID::Slot);
+    // will raise an exception if not valid
+    pt->validate_gen(src->get_class_id());
+    // a value slot is read by _update_for_new_slot() when applied; only a Constant has its value before rendering
+    if (pt->get_class_id() != PTypeID::Buffer &&
+            pt->get_class_id() != PTypeID::BreakPoints &&
+            src->get_class_id() != GenID::Constant) {
+        std::stringstream msg;
+        msg << "a value slot can only be set with a Constant: " << i
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+bool CommandQueue :: _post() {
+    if (_in_flight >= _commands.capacity()) {
+        collect();
+    }
+    if (_in_flight >= _commands.capacity() || !_commands.push(_staging)) {
+        // release what was prepared here, on the control thread
+        _staging.target.reset();
+        _staging.inputs.clear();
+        _staging.slot.reset();
+        return false;
+    }
+    ++_in_flight;
+    return true;
+}
+
+bool CommandQueue :: set_input(GenPtr g, PIndexT i, GenPtr src,
+        PIndexT pos) {
+    _validate_input(g, i, src, pos);
+    _staging.kind = SetInput;
+    _staging.target = g;
+    _staging.index = i;
+    _staging.inputs.clear();
+    _staging.inputs.push_back(GenPtrOutPair(src->get_proxied(),
+            pos + src->get_output_count_shift()));
+    return _post();
+}
+
+bool CommandQueue :: set_input(GenPtr g, PIndexT i, SampleT v) {
+    GenPtr c = Gen::make_with_environment(GenID::Constant,
+            g->get_environment());
+    c->set_input_by_index(0, v); // this will call Constant::reset()
+    return set_input(g, i, c);
+}
+
+bool CommandQueue :: add_input(GenPtr g, PIndexT i, GenPtr src,
+        PIndexT pos) {
+    _validate_input(g, i, src, pos);
+    _staging.kind = AddInput;
+    _staging.target = g;
+    _staging.index = i;
+    _staging.inputs.clear();
+    // space for the existing pairs to be merged on the render thread
+    _staging.inputs.reserve(_add_reserve + 1);
+    _staging.inputs.push_back(GenPtrOutPair(src->get_proxied(),
+            pos + src->get_output_count_shift()));
+    return _post();
+}
+
+bool CommandQueue :: add_input(GenPtr g, PIndexT i, SampleT v) {
+    GenPtr c = Gen::make_with_environment(GenID::Constant,
+            g->get_environment());
+    c->set_input_by_index(0, v);
+    return add_input(g, i, c);
+}
+
+bool CommandQueue :: set_slot(GenPtr g, PIndexT i, GenPtr src) {
+    _validate_slot(g, i, src);
+    _staging.kind = SetSlot;
+    _staging.target = g;
+    _staging.index = i;
+    _staging.slot = src;
+    return _post();
+}
+
+bool CommandQueue :: set_slot(GenPtr g, PIndexT i, SampleT v) {
+    GenPtr c = Gen::make_with_environment(GenID::Constant,
+            g->get_environment());
+    c->set_input_by_index(0, v);
+    return set_slot(g, i, c);
+}
+
+std::size_t CommandQueue :: collect() {
+    std::size_t count {0};
+    while (_retired.pop(_collected)) {
+        if (!_collected.applied) {
+            ++_rejected;
+        }
+        // the last references to replaced Gens are released here
+        _collected.target.reset();
+        _collected.inputs.clear();
+        _collected.merged.clear();
+        _collected.slot.reset();
+        --_in_flight;
+        ++count;
+    }
+    return count;
+}
+
+void CommandQueue :: _apply() {
+    Gen* g = _current.target.get();
+    _current.applied = true;
+    if (_current.kind == SetInput) {
+        g->swap_inputs_by_index(_current.index, _current.inputs);
+    }
+    else if (_current.kind == AddInput) {
+        // take the existing pairs out, and merge them in front of the new
+        g->swap_inputs_by_index(_current.index, _current.merged);
+        if (_current.merged.size() + _current.inputs.size() >
+                _current.inputs.capacity()) {
+            // would allocate: restore and reject
+            g->swap_inputs_by_index(_current.index, _current.merged);
+            _current.applied = false;
+            return;
+        }
+        _current.inputs.insert(_current.inputs.begin(),
+                _current.merged.begin(), _current.merged.end());
+        g->swap_inputs_by_index(_current.index, _current.inputs);
+    }
+    else {
+        g->swap_slot_by_index(_current.index, _current.slot);
+    }
+}
+
+std::size_t CommandQueue :: drain() {
+    std::size_t count {0};
+    while (_commands.pop(_current)) {
+        _apply();
+        // _in_flight accounting guarantees space
+        _retired.push(_current);
+        ++count;
+    }
+    return count;
+}
+
+
+
+
+
+} // end namespaces aw
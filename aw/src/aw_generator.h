@@ -7,9 +7,15 @@
 #include <unordered_map>
 #include <memory>
 #include <set>
+#include <thread>
+#include <future>
+#include <atomic>
 
 #include "aw_common.h"
 
+// forward declared, such that libsndfile is only used in the implementation
+class SndfileHandle;
+
 namespace aw {
 
 //! Class of Gen names for static constructors. Enumeration of IDs for each type of generator avaialble; used in factory methods to return configure Generators.
@@ -29,6 +35,9 @@ enum class GenID {
     Counter,
     Panner,
     Sequencer,
+    FilePlayer,
+    Resampler,
+    VoiceAllocator,
 };
 
 //! A vector of GenIDs to permit discovery
@@ -48,6 +57,9 @@ static const std::vector<GenID> GenIDs {
     GenID::Counter,
     GenID::Panner,
     GenID::Sequencer,    
+    GenID::FilePlayer,
+    GenID::Resampler,
+    GenID::VoiceAllocator,
 };
 
 //! Connection IDs are defined as old-style enums for translation to integers. TODO: can add methods it these to permit incrementing 
@@ -442,6 +454,12 @@ class DirectedIndex {
 
     //! Must be able to set direction at process time; this does not reset or reallocate storage. Random permutation, if requested and not availabel, falls to random selection. 
     void set_direction(PTypeDirection::Opt d);
+
+    //! Append the position, direction, and permutation to b.
+    void write_state(StateBlob& b) const;
+
+    //! Restore state written by write_state() of an index of the same size; throws if the size does not match.
+    void read_state(StateBlob& b);
 };
 
 
@@ -616,6 +634,12 @@ class Gen: public std::enable_shared_from_this<Gen> {
     
 	//! For each render call, we sum all inputs up to the common frame size available in the input and store that in a Vector of samples. This is done to make render() methods cleaner and remove redundancy.
 	VVSampleT _summed_inputs;
+
+    //! The number of independent lanes this Gen processes; each lane has its own output and state. Only Gens that override set_lane_count() have more than one lane.
+    PIndexT _lane_count {1};
+
+    //! For Gens with more than one lane, each input summed as a frame for each lane, lane after lane.
+    VVSampleT _summed_lanes;
     
 	//! A std::vector of GeneratorsShared that are used internally for configuration of this Gen. Unlike inputs, only one Gen can occupy a slot position, and these are protected, not public (a suggestion that these are for internal use only). Example: a buffer has a slot for duration of that buffer. It is not yet decided if generators in slots shold be rendered, but at least only once per render step. Further, which output channels of the generator slot to use is decided internally or with another slot parameter.
 	VGenPtr _slots;
@@ -625,12 +649,18 @@ class Gen: public std::enable_shared_from_this<Gen> {
 	
     //! We store a PTypePtr for each defined output, telling us what it is.
     std::unordered_map<PIndexT, PTypePtr> _output_parameter_type;
+
+    //! For each output, true if this Gen maintains a sparse list of trigger events in output_events for that output. Set when an output is registered with a PTypeTrigger; Constant sets this based on its value.
+    std::vector<bool> _output_has_events;
 		
     public://------------------------------------------------------------------
         
     //! A vector of sample vectors (one for each of _output_count). This might be deemed best as private, but for performance this is public: no function call is required to read from it. 
     VVSampleT outputs;	
 
+    //! For each output, a sorted list of sample offsets in the current frame at which a trigger occurs. Only maintained for outputs where output_has_events() is true; the dense frame in outputs is always written as well, so consumers that do not read events are unaffected. Capacity is reserved to the frame size such that filling does not allocate.
+    VVFrameSizeType output_events;
+
     // ========================================================================
     // methods ================================================================
 	
@@ -667,9 +697,72 @@ class Gen: public std::enable_shared_from_this<Gen> {
 	
 	//! Flatten or sum multiple inputs that reside in the same input type. This is done to optimize dealing with multiple inputs in the same input type ahead of calculations for rendering. Results are stored in _summed_inputs VV. The fs argument is the number of frames to read.  
 	inline void _sum_inputs(FrameSizeT fs);
+
+    //! Set n lanes, replacing the outputs with one Value output for each lane, and preparing _summed_lanes. Throws if n is zero.
+    void _set_lane_outputs(PIndexT n);
+
+    //! As _sum_inputs(), but storing a frame for each lane in _summed_lanes. A Gen connected from its first output with the same number of lanes as this Gen provides one lane from each output; any other Gen is read by every lane.
+    void _sum_input_lanes(FrameSizeT fs);
+
+    //! Collect the sparse trigger events of all Gens at input i into dst, sorted and without duplicates. Returns false if any Gen at this input does not provide events for its connected output; in that case the caller must fall back to reading _summed_inputs. An input with no Gens has no events.
+    bool _collect_input_events(PIndexT i, VFrameSizeType& dst) const;
     
 	//! Call reset on all inputs. 
 	void _reset_inputs();
+
+    //! Reset this Gen and all Gens at its inputs, recursively, skipping Gens already in visited, leaving each with render count f.
+    void _reset_network(std::set<Gen*>& visited, RenderCountT f);
+
+    //! Return true if this Gen can be moved forward with _advance() rather than rendered. The base class returns false; Gens without state carried between frames return true, and others only when the inputs that state depends on are constant.
+    virtual bool _can_advance() const {return false;};
+
+    //! Move the state of this Gen alone forward by a number of samples, as if rendered, without writing outputs or changing the render count. Only called when _can_advance() is true.
+    virtual void _advance(SampleTimeT samples) {};
+
+    //! If all Gens at input i are Constants, set v to the sum of their values and return true.
+    bool _input_is_constant(PIndexT i, SampleT& v) const;
+
+    //! Collect this Gen and all Gens at its inputs, recursively, skipping Gens already in visited.
+    void _collect_network(std::set<Gen*>& visited,
+            std::vector<Gen*>& network);
+
+    //! Return true if no Gen, found by following inputs and slots from the Gens at each input, is reached from more than one input. Such inputs can be rendered concurrently.
+    bool _inputs_are_disjoint() const;
+
+    //! Return true if rendering this Gen with a larger frame size, and then continuing with the common frame size, writes the same samples as rendering with the common frame size throughout: state is carried from sample to sample, never read once per frame. The base class returns false.
+    virtual bool _is_frame_size_independent() const {return false;};
+
+    //! Called after _set_render_frame_size(), for Gens that must refill outputs or resize buffers of the frame size.
+    virtual void _update_for_render_frame_size() {};
+
+    //! Change the frame size used by render() without resetting: outputs are resized, and values and render count are kept. Unlike _set_frame_size(), this is not limited to resizable Gens.
+    void _set_render_frame_size(FrameSizeT f);
+
+    //! Collect all Gens at the inputs of this Gen, recursively, into network. Returns true if each can render with another frame size: each is frame size independent, has the common frame size, and has not yet rendered.
+    bool _collect_resizable_network(std::vector<Gen*>& network);
+
+    //! Call _set_render_frame_size() on each Gen in network, and set its render count.
+    static void _set_network_frame_size(const std::vector<Gen*>& network,
+            FrameSizeT f, RenderCountT render_count);
+
+    //! Return a copy of this Gen alone, with its state and still connected to the inputs and slots of this Gen. The base class throws, as Gens holding files or threads (FilePlayer) cannot be copied; other derived classes return a copy of themselves.
+    virtual GenPtr _copy() const;
+
+    //! Return the copy of this Gen in copied, or make one with _copy() and connect it to copies of the Gens at its inputs, recursively. Gens at slots are not copied.
+    GenPtr _clone_network(std::unordered_map<const Gen*, GenPtr>& copied);
+
+    //! Leading bytes of a network snapshot ("AWS2"); AWS1 stored 32 bit frame sizes.
+    static const std::uint32_t _state_magic {0x32535741};
+
+    //! The greatest frame size at which render_range() renders a network; larger frames save little per-frame work, and the outputs of large networks would no longer stay in cache.
+    static const FrameSizeT _range_frame_size {1024};
+
+    //! Write the state of this Gen and all Gens at its inputs, recursively, skipping Gens already in visited.
+    void _write_network_state(std::set<const Gen*>& visited,
+            StateBlob& b) const;
+
+    //! Read state in the order written by _write_network_state().
+    void _read_network_state(std::set<Gen*>& visited, StateBlob& b);
         	
     //! Public method for resizing based on frame size. Calls _resize_outputs only if necessary. 
     void _set_frame_size(FrameSizeT f);    
@@ -686,6 +779,9 @@ class Gen: public std::enable_shared_from_this<Gen> {
     //! Factory for creating constants given just a numeric type.     
     static GenPtr make(SampleT);
 
+    //! Factory for a source of one lane for each value: an Add with a channel for each value, each fed by a Constant.
+    static GenPtr make_lanes(const VSampleT& values);
+
 
     //! Produce documentation for all generators. 
     static void doc();
@@ -704,6 +800,37 @@ class Gen: public std::enable_shared_from_this<Gen> {
     
     //! Reset all inputs, and zero out the outputs array and the _render count. Derived classes should manually call the base class.
     virtual void reset();
+
+    //! Reset this Gen and, recursively, every Gen at its inputs (each once, even if shared), such that the network can render again from render count f + 1 (by default, from 1). reset() alone does not reset inputs, which would then not render until their render count was passed. Starting from a later render count starts from the reset state, not the state a network would have if rendered to that point.
+    void reset_network(RenderCountT f=0);
+
+    //! Move this Gen and, recursively, every Gen at its inputs to render count f, such that outputs hold frame f and rendering continues with f + 1. If every Gen in the network can be moved analytically (Gens without state carried between frames, and Sine, Phasor, and BPIntegrator with constant inputs), all jump directly to f - 1 and only frame f is rendered; otherwise frames are rendered up to f. Seeking to or before the current render count first resets the network. Returns true if the seek was analytic. Changes scheduled on Constants for frames before f are not applied by an analytic seek.
+    bool seek(RenderCountT f);
+
+    //! Return true if seek() would move this network analytically.
+    bool can_seek_analytically();
+
+    //! Render count frames starting with render count start, writing each output directly into planar buffers owned by the caller: dst holds channels pointers, one for each output, each to count * get_frame_size() samples. If start does not follow the current render count, the network is first moved with seek(start - 1). Throws if start is 0, if start + count overflows the render count, or if channels is not the output count. If every Gen in the network is frame size independent and at the same render count, frames are rendered together as larger frames of up to 1024 samples, as by SamplesBuffer, writing the same samples with one render() of the network for each; the last frame, or all frames of other networks, are rendered one at a time.
+    void render_range(RenderCountT start, RenderCountT count,
+            SampleT* const* dst, PIndexT channels);
+
+    //! Append the internal state of this Gen (not of its inputs) to b: the render count, the current outputs frame and its events, and, in derived classes, whatever is carried from one frame to the next (phases, envelope stages, counter positions). Configuration (inputs, slots, parameters) is not included. Derived classes that carry state override this and read_state(), calling the base class first.
+    virtual void write_state(StateBlob& b) const;
+
+    //! Restore state written by write_state() of a Gen of the same class and output shape; throws if the class, output count, or frame size does not match.
+    virtual void read_state(StateBlob& b);
+
+    //! Return a snapshot of the state of this Gen and, recursively, every Gen at its inputs (each once, even if shared), in a deterministic order. Restoring the snapshot into the same network, or an identically built one, continues rendering from render count get_render_count() + 1 with the same output as if never interrupted. Gens drawing from the shared Random engine (White) do not reproduce their values.
+    StateBlob snapshot_network() const;
+
+    //! Restore a snapshot made with snapshot_network() on a network of the same structure. Throws if the structure differs; the network may then be partially restored.
+    void restore_network(StateBlob& b);
+
+    //! Return a copy of this Gen and of every Gen reached through its inputs, connected in the same way and each with the state of its original, such that the copy renders what the original would. A Gen shared in the original is shared in the copy. Gens at slots, such as the SamplesBuffer of a Sequencer or the BreakPoints of a BPIntegrator, are only read, and are shared by original and copy rather than copied; setting a slot on either replaces the Gen only there. Asynchronous loads are completed first. Throws if the network has a Gen that cannot be copied (FilePlayer).
+    GenPtr clone();
+
+    //! As clone(), recording each copy in copied by its original, such that the copies of Gens within the network can be found.
+    GenPtr clone(std::unordered_map<const Gen*, GenPtr>& copied);
 	
 
     //! Set a default input and slot configuration. If other inputs or slots are configured, the will be removed. 
@@ -712,8 +839,11 @@ class Gen: public std::enable_shared_from_this<Gen> {
     //! Return the the number of output dimensions
     virtual PIndexT get_output_count() const {return _output_count;};
 
+    //! Return true if the output at index d maintains a sparse list of trigger events in output_events.
+    bool output_has_events(PIndexT d) const {return _output_has_events[d];};
+
     //! Return the the outputs size, or the total number of samples used for all frames at all outputs.
-    FrameSizeT get_outputs_size() const {return _outputs_size;};
+    OutputsSizeT get_outputs_size() const {return _outputs_size;};
     
     //! Get the average of a single output frame. If d is 0, all dimensions are averaged, otherwise 1 references the first output, 2 the second, etc. If d is greater than the number of dimensions, an error is raised. (Generally only used in test.)
     SampleT get_output_average(PIndexT d, bool absolute=false) const;
@@ -724,6 +854,15 @@ class Gen: public std::enable_shared_from_this<Gen> {
     //! Return the the frame size, the number of samples per output channel. The frame size is always at or greater than the common frame size.
     OutputsSizeT get_frame_size() const {return _frame_size;};	
 
+    //! Return the render count of the last frame rendered, or zero after a reset.
+    RenderCountT get_render_count() const {return _render_count;};
+
+    //! Return the number of lanes.
+    PIndexT get_lane_count() const {return _lane_count;};
+
+    //! Set the number of independent lanes, each with an output. Only Sine, Map, Add, and Multiply have lanes; the base class throws for any number but one. Lanes share one Gen and its input tables; each lane is rendered over its own contiguous frame. Map renders with map_samples(), and Sine lanes take the sine with sin_samples() rather than sin(), both two samples at once with SSE2.
+    virtual void set_lane_count(PIndexT n);
+
     //! Return a copy of the environment shared pointer.
     EnvPtr get_environment() const {return _environment;};
     
@@ -804,12 +943,13 @@ class Gen: public std::enable_shared_from_this<Gen> {
     //! Load the outputs into a passed-in vector. The vector is cleared before loading. 
     void write_outputs_to_vector(VSampleT& vst) const;
 
-    //! Write out all outpout to the provided file path. If this is a SecondsBuffer, this can be used to write an audio file.
-    virtual void write_output_to_fp(const std::string& fp, PIndexT d=0) const;
+    //! Write out all outpout to the provided file path. If this is a SecondsBuffer, this can be used to write an audio file, with samples encoded as format.
+    virtual void write_output_to_fp(const std::string& fp, PIndexT d=0,
+            SampleFormat format=SampleFormat::PCM16) const;
 	
         
-	//! Set the outputs from an array. This low level routine is the only way outputs are directly written from a collection. The reeturned bool is the result of _validate_outputs. 
-	Validity set_outputs_from_array(SampleT* v, OutputsSizeT s,
+	//! Set the outputs from an array. This low level routine is the only way outputs are directly written from a collection. If interleaved is false, v holds ch consecutive runs of s / ch samples, one for each channel. The reeturned bool is the result of _validate_outputs. 
+	Validity set_outputs_from_array(const SampleT* v, OutputsSizeT s,
 							PIndexT ch, bool interleaved=true);
 								
 	//! Set the outputs (resizing if possible) to values passsed in from a vector of SampleT. Note this presently copies values from a vector to an array, and thus requires 2x the memory alloc. Should by a const vector but cannot yet get usage right when deriving an array pointer; but: the passed in vector should not be changed. 
@@ -820,6 +960,9 @@ class Gen: public std::enable_shared_from_this<Gen> {
     //! If we are in a SecondsBuffer class, this method loads a complete file path to an audio file into the output of this Gen. This is not implemented in the base class Gen. 
     virtual void set_outputs_from_fp(const std::string& fp);
 
+    //! Block until outputs being set asynchronously (see SamplesBuffer::load_async()) are available. Gens that read the outputs of other Gens outside of rendering them call this first; does nothing in the base class.
+    virtual void wait_loaded() {};
+
     //! Overridden, overloaded function for setting outputs. Implemented by SecondsBuffer, but defined on base so all have access. Need a Injector because otherwise we would take more parameters for channels, etc.
     virtual void set_outputs(const Inj<SampleT>& bi);
 
@@ -862,6 +1005,9 @@ class Gen: public std::enable_shared_from_this<Gen> {
 
     //! Remove all GenPtr attached to all inputs.
     void clear_inputs();
+
+    //! Exchange the GenPtrOutPairs at input i with those in v. Neither allocates nor releases a Gen: the previous inputs are returned in v, such that they can be released elsewhere. The caller is responsible for validating v; this is used to apply changes prepared on another thread (see CommandQueue).
+    void swap_inputs_by_index(PIndexT i, VGenPtrOutPair& v);
   
 	// slot ..............................................................    	
     //! Directly set a parameter to a slot given an index. This will remove/erase any parameter on this slot. The update parameter permits disabling updating a slot, useful during initial configuration. 
@@ -874,6 +1020,9 @@ class Gen: public std::enable_shared_from_this<Gen> {
 
     //! Return the single gen at this slot position (not a vector of gens, as used for inputs).
     virtual GenPtr get_slot_gen_at_index(PIndexT i);
+
+    //! Exchange the Gen at slot i with gs, returning the previous Gen in gs. The caller is responsible for validating gs. If update is true _update_for_new_slot() is called, which for some Gens (e.g., buffers sized by a slot) allocates.
+    void swap_slot_by_index(PIndexT i, GenPtr& gs, bool update=true);
     
     // Remove all GenPtr attacked to all inputs: does not make sense to do this, because we always need one gen in each slot position
     //void clear_slots();
@@ -881,6 +1030,112 @@ class Gen: public std::enable_shared_from_this<Gen> {
 
 };
 
+//.............................................................................
+//! A wait-free queue of graph changes from a single control thread to a single render thread. Calling set_input_by_index() and related methods on a Gen that is being rendered on another thread is a data race; instead, the control thread prepares each change here (validating, and allocating any Constants and input vectors) and the render thread calls drain() at a block boundary to apply all pending changes. Applying a change only exchanges prepared storage with the Gen: the replaced inputs and slots are passed back and released on the control thread, when collect() is called (or the next change is posted), such that the render thread neither allocates nor frees. Note that a newly connected Gen renders from its own render count, and is thus best created and connected before rendering starts or reset() to the current frame. Every command is validated when posted, such that applying it cannot throw on the render thread; only an add beyond the reserve of an input is rejected there, rather than allocating (see get_rejected()).
+class CommandQueue;
+typedef std::shared_ptr<CommandQueue> CommandQueuePtr;
+class CommandQueue {
+
+    public://-------------------------------------------------------------------
+
+    //! The kind of a command.
+    enum CommandKind {
+        SetInput, // replace all Gens at an input
+        AddInput, // add Gens to an input
+        SetSlot // replace the Gen at a slot
+    };
+
+    typedef Gen::GenPtrOutPair GenPtrOutPair;
+    typedef Gen::VGenPtrOutPair VGenPtrOutPair;
+
+    private://-----------------------------------------------------------------
+
+    //! A command node. Nodes circulate between the two rings; fields are emptied on the control thread after use.
+    struct Command {
+        CommandKind kind {SetInput};
+        GenPtr target;
+        PIndexT index {0};
+        //! For inputs, the prepared GenPtrOutPairs; after application, the replaced pairs.
+        VGenPtrOutPair inputs;
+        //! For AddInput, holds the previous pairs while merging.
+        VGenPtrOutPair merged;
+        //! For SetSlot, the prepared Gen; after application, the replaced Gen.
+        GenPtr slot;
+        bool applied {false};
+    };
+
+    //! Commands passed from the control thread to the render thread.
+    SPSCRing<Command> _commands;
+
+    //! Applied commands passed back to the control thread for release.
+    SPSCRing<Command> _retired;
+
+    //! Control thread: the command being prepared, and the command being collected.
+    Command _staging;
+    Command _collected;
+
+    //! Render thread: the command being applied.
+    Command _current;
+
+    //! Control thread: commands posted and not yet collected. Never more than the capacity, such that _retired can never be full.
+    std::size_t _in_flight {0};
+
+    //! Control thread: number of collected commands that could not be applied.
+    std::size_t _rejected {0};
+
+    //! The number of GenPtrOutPairs reserved for merging an AddInput; an add to an input that already has more Gens than this is rejected.
+    std::size_t _add_reserve;
+
+    //! Validate a target Gen, an input or slot index, and the Gen to be connected, such that nothing can fail when applied on the render thread.
+    void _validate_input(GenPtr g, PIndexT i, GenPtr src, PIndexT pos) const;
+    void _validate_slot(GenPtr g, PIndexT i, GenPtr src) const;
+
+    //! Post _staging; returns false if the queue is full.
+    bool _post();
+
+    //! Render thread: apply the command in _current.
+    inline void _apply();
+
+    public://------------------------------------------------------------------
+
+    //! Create a queue that can hold capacity commands. Each AddInput reserves space for add_reserve GenPtrOutPairs.
+    explicit CommandQueue(std::size_t capacity=256,
+            std::size_t add_reserve=32);
+
+    // control thread .........................................................
+    //! Post replacing all Gens at input i of g with output pos of src. Throws if the indices are not available; returns false if the queue is full.
+    bool set_input(GenPtr g, PIndexT i, GenPtr src, PIndexT pos=0);
+
+    //! Post replacing all Gens at input i of g with a new Constant of v.
+    bool set_input(GenPtr g, PIndexT i, SampleT v);
+
+    //! Post adding output pos of src to input i of g.
+    bool add_input(GenPtr g, PIndexT i, GenPtr src, PIndexT pos=0);
+
+    //! Post adding a new Constant of v to input i of g.
+    bool add_input(GenPtr g, PIndexT i, SampleT v);
+
+    //! Post replacing the Gen at slot i of g with src. Buffer and BreakPoints slots take a Gen of a compatible type; all other slots take only a Constant, as a slot value is read when applied, and another Gen might not have rendered it. Throws if src cannot be used at this slot. Applying a slot calls _update_for_new_slot(), which for some Gens (e.g., buffers sized by a slot) allocates.
+    bool set_slot(GenPtr g, PIndexT i, GenPtr src);
+
+    //! Post replacing the Gen at slot i of g with a new Constant of v.
+    bool set_slot(GenPtr g, PIndexT i, SampleT v);
+
+    //! Release everything replaced by applied commands. Returns the number of commands collected.
+    std::size_t collect();
+
+    //! Return the number of commands posted and not yet collected.
+    std::size_t get_in_flight() const {return _in_flight;};
+
+    //! Return the number of collected commands that could not be applied.
+    std::size_t get_rejected() const {return _rejected;};
+
+    // render thread ..........................................................
+    //! Apply all pending commands; call at a block boundary, before rendering. Does not allocate or release. Returns the number of commands applied.
+    std::size_t drain();
+
+};
+
 // TODO: do not dd inputs, but replace!
 // TODO: accept nullptr as a non-assignment
 
@@ -1071,20 +1326,30 @@ inline GenPtr connect_parallel(
         GenPtr rhs, 
         GenID gid) {
     
-    // get lesser of outputs between the two, then create an add with that many slots
-    PIndexT j = std::min(lhs->get_output_count(), 
+    // with one side having lanes and the other a single output, that output is read by every lane; otherwise, get lesser of outputs between the two, then create an add with that many slots
+    PIndexT lanes = std::max(lhs->get_lane_count(), rhs->get_lane_count());
+    bool lhs_single = lhs->get_output_count() == 1;
+    bool rhs_single = rhs->get_output_count() == 1;
+    bool broadcast = lanes > 1 && (lhs_single || rhs_single);
+    PIndexT j = broadcast ? lanes : std::min(lhs->get_output_count(),
             rhs->get_output_count());
     // use the passed in gen id, this is usually GenID::Add, GenID::Multiply
     GenPtr g = Gen::make_with_environment(gid, 
             lhs->get_environment());
     // the returned Gen needs to support multiple channels; these are set as slot 0: TODO: need to validate this somehow
-    g->set_slot_by_index(0, j);
+    if (broadcast || (lhs->get_lane_count() == j &&
+            rhs->get_lane_count() == j && j > 1)) {
+        g->set_lane_count(j); // sets slot 0
+    }
+    else {
+        g->set_slot_by_index(0, j);
+    }
     // try to conect as many in to out as possible for each gen
     // note: does not need to be set_input, as this is a fresh gen
     PIndexT i;
     for (i = 0; i != j; ++i) {
-        g->add_input_by_index(i, lhs, i);
-        g->add_input_by_index(i, rhs, i);        
+        g->add_input_by_index(i, lhs, broadcast && lhs_single ? 0 : i);
+        g->add_input_by_index(i, rhs, broadcast && rhs_single ? 0 : i);
     }
     return g;
 }
@@ -1196,6 +1461,25 @@ class Constant: public Gen {
 	//! Storage for the internal constant values. This is an array because we want to support a similar interface of applying multiple values to a single input parameter. 
     VSampleT _values;
 
+    //! True if the outputs frame was changed at sub-frame offsets (by set_value_at() or set_trigger_at()) and must be restored from _values on the next frame.
+    bool _frame_modified {false};
+
+    //! The render count for which the frame was modified. 
+    RenderCountT _frame_modified_render {0};
+
+    //! Refill the outputs frame (and events) from the sum of _values.
+    void _fill_frame(FrameSizeT start, SampleT v);
+
+    //! If the frame was modified for a render count before f, restore it. 
+    void _restore_frame(RenderCountT f);
+
+
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new Constant(*this));};
+    virtual bool _is_frame_size_independent() const {return !_frame_modified;};
+
+    virtual void _update_for_render_frame_size();
+    virtual bool _can_advance() const {return true;};
 
     public://------------------------------------------------------------------
 
@@ -1208,6 +1492,10 @@ class Constant: public Gen {
 	//! This overridden method needs only increment the _render_count, as the outputs array is set when reset() is called. 
     virtual void render(RenderCountT f); 	
 	
+    virtual void write_state(StateBlob& b) const;
+
+    virtual void read_state(StateBlob& b);
+
 	//! This derived function is necessary to handle displaying internal input components.
 	virtual void print_inputs(bool recursive=false, 
             UINT8 recurse_level=0, std::string prefix="");
@@ -1230,6 +1518,15 @@ class Constant: public Gen {
     //! Add value as a SampleT value.                                        
 	virtual void add_input_by_index(PIndexT i, SampleT v, 
             PIndexT pos=0);
+
+    //! Change the value starting at a sample offset within the frame of render count f; samples before the offset keep the previous value. The new value persists for following frames. This does not allocate, and is used for sample-accurate control changes.
+    void set_value_at(RenderCountT f, FrameSizeT offset, SampleT v);
+
+    //! Return the value of this Constant, the sum of its values, as persisting beyond the current frame.
+    SampleT get_value() const;
+
+    //! Write a single-sample trigger at a sample offset within the frame of render count f. The frame is restored to the constant value on the next frame. This does not allocate.
+    void set_trigger_at(RenderCountT f, FrameSizeT offset);
     
 };
 
@@ -1241,6 +1538,7 @@ class _BinaryCombined;
 class _BinaryCombined: public Gen {
 
     protected://---------------------------------------------------------------
+    virtual bool _is_frame_size_independent() const {return true;};
     SampleT _n_opperands;
     //! Iniitial value in iterative operations.
     SampleT _n_opperands_init;
@@ -1251,10 +1549,15 @@ class _BinaryCombined: public Gen {
 	//! Overridden to apply slot settings and reset as necessary. 
 	virtual void _update_for_new_slot();
 
+    virtual bool _can_advance() const {return true;};
+
     public://------------------------------------------------------------------
     explicit _BinaryCombined(EnvPtr);
 
     virtual void init();    
+
+    //! Set the Channels slot to n, clearing inputs, and take each channel as a lane. Channels set otherwise are not lanes.
+    virtual void set_lane_count(PIndexT n);
 		
 	//! Render addition. 
     virtual void render(RenderCountT f); 	
@@ -1267,6 +1570,9 @@ class Add;
 typedef std::shared_ptr<Add> AddPtr;
 class Add: public _BinaryCombined {
 
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new Add(*this));};
+
     public://------------------------------------------------------------------
     explicit Add(EnvPtr);
     virtual void init();
@@ -1279,6 +1585,9 @@ class Multiply;
 typedef std::shared_ptr<Multiply> MultiplyPtr;
 class Multiply: public _BinaryCombined {
 
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new Multiply(*this));};
+
     public://------------------------------------------------------------------
     explicit Multiply(EnvPtr);
     virtual void init();
@@ -1291,30 +1600,180 @@ class SamplesBuffer;
 typedef std::shared_ptr<SamplesBuffer> SamplesBufferPtr;
 class SamplesBuffer: public Gen {
 
+    private://-----------------------------------------------------------------
+    //! If true, files decoded by set_outputs_from_fp() are cached.
+    static std::atomic<bool> _cache_enabled;
+
+    //! If true, set_outputs() with a file path loads with load_async().
+    static std::atomic<bool> _load_async;
+
+    //! The quality of conversion of files at other sampling rates.
+    static std::atomic<ResampleQuality> _resample_quality;
+
+    //! If true, render() fills outputs concurrently when the networks at each input are disjoint.
+    static std::atomic<bool> _parallel_fill;
+
+    //! True on a thread filling an output; nested buffers fill jointly, such that the pool is never waited on from its own threads.
+    static thread_local bool _in_parallel_fill;
+
+    //! The frame size at which inputs are rendered when filling offline, if all Gens at the inputs permit.
+    static std::atomic<FrameSizeT> _block_size;
+
+    //! Render the Gens at all inputs for render counts after rc_start up to rc_end, each a block of bs samples, writing sums into outputs at rc * bs while less than fs.
+    void _fill_outputs(FrameSizeT bs, RenderCountT rc_start,
+            RenderCountT rc_end, FrameSizeT fs);
+
+    //! As _fill_outputs(), for the Gens at input j alone, writing only output j.
+    void _fill_output(PIndexT j, FrameSizeT bs, RenderCountT rc_start,
+            RenderCountT rc_end, FrameSizeT fs);
+
+    //! Fill all outputs with _fill_output(), each but the first on a thread of the Env render pool.
+    void _fill_outputs_parallel(FrameSizeT bs, RenderCountT rc_start,
+            RenderCountT rc_end, FrameSizeT fs);
+
+    //! The encoding in which samples are stored; if not Float64, outputs are released once encoded into _compact.
+    SampleFormat _storage {SampleFormat::Float64};
+
+    //! True while samples are held in _compact, one vector of bytes for each output, and outputs are empty.
+    bool _compacted {false};
+    std::vector<std::vector<UINT8>> _compact;
+
+    //! Decode compact samples back into outputs, if compacted.
+    void _expand();
+
+    //! Encode outputs into compact storage and release them, if the storage format is not Float64.
+    void _apply_storage();
+
+    //! A buffer loading a file on the Env IOPool; taken by wait_loaded(). Shared such that buffers can be copied.
+    std::shared_future<GenPtr> _loading;
+
+    //! Wall-clock seconds taken by the last load from a file.
+    double _load_seconds {0};
+
     protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new SamplesBuffer(*this));};
+    //! Return the name of the cache file for a sound file, derived from its absolute path, modification time, and size, and the sample type; empty if the file does not exist.
+    static std::string _cache_name(const std::string& fp);
+
+    //! Set outputs from the cache file for fp, if it is valid for fp, and set sampling_rate to that of the file; otherwise return false.
+    bool _set_outputs_from_cache(const std::string& fp,
+            const std::string& cache_fp, OutputsSizeT& sampling_rate);
+
+    //! Convert outputs loaded at sampling_rate to the rate of the Env, if different and conversion is enabled.
+    void _resample_outputs(OutputsSizeT sampling_rate);
+
+    //! Write decoded, interleaved samples of fp to its cache file as planar samples. Failing to write is not an error.
+    static void _write_cache(const std::string& fp,
+            const std::string& cache_fp, const SampleT* v,
+            std::uint64_t frames, PIndexT ch, OutputsSizeT sampling_rate,
+            int format);
+
     //! Overridden to apply slot settings and reset as necessary. 
     virtual void _update_for_new_slot();
 
     void _buffer_update_for_new_slot(PTypeTimeContext::Opt tc);
 
+    //! Overridden to store samples written by set_outputs_from_array() in the storage format.
+    virtual Validity _validate_outputs();
+
     public://------------------------------------------------------------------
     explicit SamplesBuffer(EnvPtr);
     
     virtual void init();
+
+    //! Zero samples, in whichever storage.
+    virtual void reset();
+
+    virtual void write_state(StateBlob& b) const;
+
+    virtual void read_state(StateBlob& b);
+
+    //! Store samples encoded as format: PCM16, PCM24, and Float32 use a quarter, three eighths, and half the memory of Float64, the default. Samples are encoded now, and whenever outputs are later set, loaded, or rendered. While compact, outputs are empty: Gens reading buffers (Sequencer) decode samples as they read them, as do decode() and get_sample(); Gen methods that read outputs directly (get_output_average(), write_outputs_to_vector()) see no samples. Setting Float64 decodes samples back into outputs. BreakPoints are always Float64.
+    void set_storage(SampleFormat format);
+
+    //! Return the storage format.
+    SampleFormat get_storage() const {return _storage;};
+
+    //! Return true if samples are held compact, and outputs are empty.
+    bool is_compact() const {return _compacted;};
+
+    //! Return the bytes used to store samples.
+    std::size_t get_storage_bytes() const;
+
+    //! Decode n samples of output d from frame start into dst, using SSE2 where available. The range must be within the frame size.
+    void decode(PIndexT d, FrameSizeT start, FrameSizeT n, SampleT* dst) const;
+
+    //! Decode the samples of output d at n indices into dst, decoding runs of consecutive indices as blocks.
+    void gather(PIndexT d, const FrameSizeT* indices, FrameSizeT n,
+            SampleT* dst) const;
+
+    //! Return a single sample of output d at frame i.
+    SampleT get_sample(PIndexT d, FrameSizeT i) const {
+        return _compacted ? decode_sample(_compact[d].data(), i, _storage) :
+                outputs[d][i];
+    };
     
     //! Render the buffer: each render cycle must completely fille the buffer, meaning that inputs will be called more often, have a higher render number. Is this a problem? 
     virtual void render(RenderCountT f);    
             
-    //! Write to an audio file to given the ouput file path. The optional PIndexT argument can be used to specify a single _output_count of many to write. If PIndexT is 0, all outputs are written.
-    virtual void write_output_to_fp(const std::string& fp, PIndexT d=0) const;
+    //! Write to an audio file to given the ouput file path. The optional PIndexT argument can be used to specify a single _output_count of many to write. If PIndexT is 0, all outputs are written. Samples are encoded as format, and written in chunks with a SoundFileWriter, such that no interleaved copy of all outputs is made.
+    virtual void write_output_to_fp(const std::string& fp, PIndexT d=0,
+            SampleFormat format=SampleFormat::PCM16) const;
         
-    //! Set the outputs of this Gen to the content of an audio file provided as an audio path. This overridden method makes the usage of libsndfile to read in a file.
+    //! Set the outputs of this Gen to the content of an audio file provided as an audio path. This overridden method makes the usage of libsndfile to read in a file. Files at another sampling rate are converted to that of the Env (see set_resample_quality()). Decoded samples, before conversion, are cached in the Env cache directory; later loads of the same, unmodified file, in this or another process, map the cache file and copy from it rather than decoding.
     virtual void set_outputs_from_fp(const std::string& fp);
 
+    //! Enable or disable the decoded sample cache for all buffers; enabled by default.
+    static void set_cache_enabled(bool v) {_cache_enabled.store(v);};
+
+    //! Return true if the decoded sample cache is enabled.
+    static bool get_cache_enabled() {return _cache_enabled.load();};
+
+    //! Load a sound file on a thread of the Env IOPool, returning at once. Only the file's header is read here: outputs are sized to the file, and silent, until the decoded samples are taken by wait_loaded(), which rendering this buffer, or a Gen using it as a slot, calls first. Throws if the file cannot be opened; decoding errors are thrown by wait_loaded().
+    void load_async(const std::string& fp);
+
+    //! Take the samples of a load_async() once decoded, blocking until then; rethrows any error of the load.
+    virtual void wait_loaded();
+
+    //! Return true if no load_async() is waiting to be taken, or its samples are ready.
+    bool is_loaded() const;
+
+    //! Return the wall-clock seconds taken to load (decode, or copy from the cache) the last file, on whichever thread loaded it; available after wait_loaded().
+    double get_load_seconds() const {return _load_seconds;};
+
+    //! If true, set_outputs() (and the && operator) with a file path loads with load_async(), such that a patch loading many files decodes them in parallel; disabled by default.
+    static void set_load_async(bool v) {_load_async.store(v);};
+
+    //! Return true if set_outputs() with a file path loads asynchronously.
+    static bool get_load_async() {return _load_async.load();};
+
+    //! Set if render() fills outputs concurrently when the networks at each input share no Gens. Enabled by default.
+    static void set_parallel_fill(bool v) {_parallel_fill.store(v);};
+
+    //! Return true if outputs with disjoint inputs are filled concurrently.
+    static bool get_parallel_fill() {return _parallel_fill.load();};
+
+    //! Set the frame size at which render() renders inputs, rounded down to a multiple of the common frame size. Inputs are rendered at this size only if all Gens at the inputs are frame size independent; the filled samples are the same in either case. 4096 by default; the common frame size or less disables.
+    static void set_block_size(FrameSizeT v) {_block_size.store(v);};
+
+    //! Return the frame size at which render() renders inputs when permitted.
+    static FrameSizeT get_block_size() {return _block_size.load();};
+
+    //! Set the quality with which files at a sampling rate other than that of the Env are converted when loaded; Medium by default. With ResampleQuality::None, samples are loaded unchanged, and play at the wrong speed.
+    static void set_resample_quality(ResampleQuality q) {
+            _resample_quality.store(q);};
+
+    //! Return the quality of conversion when loading.
+    static ResampleQuality get_resample_quality() {
+            return _resample_quality.load();};
+
     //! Overridden set outputs from Inj reference.
     virtual void set_outputs(const Inj<SampleT>& bi);
 
-    //! Overridden set outputs a std::string, treated a file path.
+    //! Take the samples of each vector in vvst, one for each channel and all of the same size, as outputs without copying; the channel count and frame size are set to match. vvst is left with the previous outputs. Throws if the vectors are empty or differ in size, or if the samples are not valid for this buffer (BreakPoints).
+    void set_outputs_from_vectors(VVSampleT&& vvst);
+
+    //! Overridden set outputs a std::string, treated a file path; loads with load_async() if enabled by set_load_async().
     virtual void set_outputs(const std::string& fp);
     
 };
@@ -1327,6 +1786,7 @@ typedef std::shared_ptr<SecondsBuffer> SecondsBufferPtr;
 class SecondsBuffer: public SamplesBuffer {
 
     protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new SecondsBuffer(*this));};
 	//! Overridden to apply slot settings and reset as necessary. 
 	virtual void _update_for_new_slot();
 
@@ -1344,6 +1804,9 @@ class BreakPoints;
 typedef std::shared_ptr<BreakPoints> BreakPointsPtr;
 class BreakPoints: public SamplesBuffer {
 
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new BreakPoints(*this));};
+
     public://------------------------------------------------------------------
 
     explicit BreakPoints(EnvPtr);
@@ -1394,9 +1857,19 @@ class BPIntegrator: public Gen {
 	SampleT _amp;    
     
     protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new BPIntegrator(*this));};
 
     virtual void _update_for_new_slot();
 
+    //! Return the width in samples of the segment starting at point k.
+    OutputsSizeT _segment_width(FrameSizeT k,
+            PTypeTimeContext::Opt tc) const;
+
+    //! Constant cycle and trigger inputs, where the trigger never fires, can be advanced analytically, looping or running to the end.
+    virtual bool _can_advance() const;
+
+    virtual void _advance(SampleTimeT samples);
+
     public://------------------------------------------------------------------
 
     explicit BPIntegrator(EnvPtr);
@@ -1405,6 +1878,10 @@ class BPIntegrator: public Gen {
 
     virtual void reset();
 
+    virtual void write_state(StateBlob& b) const;
+
+    virtual void read_state(StateBlob& b);
+
     virtual void render(RenderCountT f);
 
     
@@ -1435,6 +1912,14 @@ class Phasor: public Gen {
 	
 	RenderCountT _period_samples;
 
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new Phasor(*this));};
+    virtual bool _is_frame_size_independent() const {return true;};
+    //! Constant rate and phase inputs can be advanced analytically.
+    virtual bool _can_advance() const;
+
+    virtual void _advance(SampleTimeT samples);
+
     public://------------------------------------------------------------------
     explicit Phasor(EnvPtr);
 	
@@ -1442,6 +1927,10 @@ class Phasor: public Gen {
 
     virtual void reset();
 		
+    virtual void write_state(StateBlob& b) const;
+
+    virtual void read_state(StateBlob& b);
+
 	//! Render the phasor. 
     virtual void render(RenderCountT f);
 };
@@ -1471,6 +1960,25 @@ class Sine: public Gen {
 	RenderCountT _sample_count;		
     OutputsSizeT _i;
 
+    //! With more than one lane, the state of each lane.
+    VSampleT _lane_angle_increment;
+    VSampleT _lane_phase_increment;
+    VSampleT _lane_phase_cur;
+    VSampleT _lane_rate_cur;
+
+    //! Render a frame of fs phases from rate and phase into out, with the state of one lane; the sine of each is then taken in place.
+    inline void _render_phases(const SampleT* rate, const SampleT* phase,
+            SampleT* out, FrameSizeT fs, SampleT& angle_increment,
+            SampleT& phase_increment, SampleT& phase_cur, SampleT& rate_cur);
+
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new Sine(*this));};
+    virtual bool _is_frame_size_independent() const {return true;};
+    //! Constant rate and phase inputs can be advanced analytically.
+    virtual bool _can_advance() const;
+
+    virtual void _advance(SampleTimeT samples);
+
     public://------------------------------------------------------------------
 
     explicit Sine(EnvPtr);
@@ -1483,6 +1991,13 @@ class Sine: public Gen {
     
     virtual void reset();
     
+    virtual void write_state(StateBlob& b) const;
+
+    virtual void read_state(StateBlob& b);
+
+    //! Set the number of sines rendered together, each with an output and reading a lane of its inputs. Resets.
+    virtual void set_lane_count(PIndexT n);
+
 	//! Render the pure sine..
     virtual void render(RenderCountT f);
 };
@@ -1501,19 +2016,11 @@ class Map: public Gen {
     PIndexT _input_index_dst_lower; 	
     PIndexT _input_index_dst_upper; 	
 
-    OutputsSizeT _i;
-    
-    SampleT _limit_src;
-    SampleT _range_src;
-    SampleT _range_dst;
-
-    SampleT _min_src;
-    SampleT _max_src;
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new Map(*this));};
+    virtual bool _is_frame_size_independent() const {return true;};
+    virtual bool _can_advance() const {return true;};
 
-    SampleT _min_dst;
-    SampleT _max_dst;
-    
-    
     public://------------------------------------------------------------------
     explicit Map(EnvPtr);
 	
@@ -1522,6 +2029,9 @@ class Map: public Gen {
     virtual void set_default();
 		
     virtual void reset();
+
+    //! Set the number of lanes mapped together, each with an output and reading a lane of its inputs.
+    virtual void set_lane_count(PIndexT n);
     
 	//! Perform the mapping.
     virtual void render(RenderCountT f);
@@ -1560,7 +2070,15 @@ class AttackDecay: public Gen {
     //! Store envelope stage as 0 (off); 1 (A); 2 (D)
     UINT8 _env_stage;
     SampleT _amp;
+
+    //! Sparse trigger events collected from the trigger input for the current frame, and a cursor into them. 
+    VFrameSizeType _events_trigger;
+    std::size_t _events_trigger_pos;
     
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const;
+    virtual bool _is_frame_size_independent() const {return true;};
+
     public://------------------------------------------------------------------
     explicit AttackDecay(EnvPtr);
 	
@@ -1570,6 +2088,10 @@ class AttackDecay: public Gen {
 		
     virtual void reset();
     
+    virtual void write_state(StateBlob& b) const;
+
+    virtual void read_state(StateBlob& b);
+
 	//! Perform the envelope
     virtual void render(RenderCountT f);
 };
@@ -1585,6 +2107,11 @@ class White: public Gen {
     private://-----------------------------------------------------------------
     OutputsSizeT _i;
         
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new White(*this));};
+    virtual bool _is_frame_size_independent() const {return true;};
+    virtual bool _can_advance() const {return true;};
+
     public://------------------------------------------------------------------
     explicit White(EnvPtr);
     
@@ -1620,8 +2147,20 @@ class Counter: public Gen {
     PIndexT _last_direction;    
     bool _has_first_pos; 
 
+    //! Sparse trigger and reset events collected from inputs for the current frame.
+    VFrameSizeType _events_trigger;
+    VFrameSizeType _events_reset;
+
+    //! Update direction from the summed direction input at frame position i.
+    inline void _update_direction(FrameSizeT i);
+
+    //! Render one frame by jumping between trigger and reset events; used when all trigger and reset inputs provide events.
+    void _render_events();
+
     
     protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const;
+    virtual bool _is_frame_size_independent() const {return true;};
     virtual void _update_for_new_slot();
 
     
@@ -1634,6 +2173,10 @@ class Counter: public Gen {
             
     virtual void reset();
     
+    virtual void write_state(StateBlob& b) const;
+
+    virtual void read_state(StateBlob& b);
+
     //! Perform the noise
     virtual void render(RenderCountT f);
 };
@@ -1657,6 +2200,11 @@ class Panner: public Gen {
     SampleT _angle;
 
 
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new Panner(*this));};
+    virtual bool _is_frame_size_independent() const {return true;};
+    virtual bool _can_advance() const {return true;};
+
     public://------------------------------------------------------------------
     explicit Panner(EnvPtr);
     
@@ -1690,12 +2238,20 @@ class Sequencer: public Gen {
     SampleT _last_buffer_index; // last value input; check for changes
     PIndexT _out_pos;
     PTypeBoundaryContext::Opt _boundary_context;
+
+    //! The buffer slot, if a SamplesBuffer, and the indices read in a frame, for decoding a compact buffer.
+    SamplesBuffer* _buffer {nullptr};
+    std::vector<FrameSizeT> _indices;
     
     protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new Sequencer(*this));};
+    virtual bool _is_frame_size_independent() const {return true;};
     //! Overridden to apply slot settings and reset as necessary.
 	void _update_for_new_slot();
 
 
+    virtual bool _can_advance() const {return true;};
+
     public://------------------------------------------------------------------
     explicit Sequencer(EnvPtr);
     
@@ -1705,12 +2261,335 @@ class Sequencer: public Gen {
     
     virtual void set_default();
 
+    virtual void write_state(StateBlob& b) const;
+
+    virtual void read_state(StateBlob& b);
+
     //! Perform the sequence.
     virtual void render(RenderCountT f);
 };
 
 
+//=============================================================================
+//! A player of sound files too large to load into a buffer. A reader thread reads frames from the file into a ring of blocks ahead of rendering; render() only takes blocks already read, and neither reads the file, allocates, nor waits. If no block is ready, the frame is silent and counted as an underrun; the file then continues from where it was, later than scheduled. After the end of the file, frames are silent. Resetting and seeking fill the ring before returning, such that rendering can start at once. A file is set with set_outputs() (or the && operator) and has an output for each channel.
+class FilePlayer;
+typedef std::shared_ptr<FilePlayer> FilePlayerPtr;
+class FilePlayer: public Gen {
+
+    private://-----------------------------------------------------------------
+    std::string _fp;
+
+    std::unique_ptr<SndfileHandle> _file;
+
+    //! The number of blocks of one frame read ahead.
+    std::size_t _read_ahead {16};
+
+    //! Blocks of interleaved samples read from the file.
+    std::unique_ptr<SPSCRing<VSampleT>> _ring;
+
+    //! Render thread: the block being played.
+    VSampleT _block;
+
+    //! Reader thread: the block being read.
+    VSampleT _read_block;
+
+    std::thread _reader;
+    std::atomic<bool> _reading {false};
+
+    //! Set by the reader after its last block is in the ring.
+    std::atomic<bool> _end_of_file {false};
+
+    //! Frames of the file taken by render() since the last reset.
+    SampleTimeT _position {0};
+
+    std::atomic<std::uint64_t> _underrun_count {0};
+
+    //! Read the next block into the ring; returns false at the end of the file.
+    bool _read_next();
+
+    //! The reader thread loop.
+    void _read();
+
+    //! Fill an empty ring reading from _position, then start the reader thread; stopping joins the reader, and discards the blocks not yet played.
+    void _start_reader();
+    void _stop_reader();
+
+    protected://---------------------------------------------------------------
+    //! A file player is moved by seeking in the file.
+    virtual bool _can_advance() const {return true;};
+
+    virtual void _advance(SampleTimeT samples);
+
+    public://------------------------------------------------------------------
+    explicit FilePlayer(EnvPtr);
+
+    //! Defined in the implementation, where SndfileHandle is complete.
+    ~FilePlayer();
+
+    virtual void init();
+
+    //! Return to the start of the file, discarding blocks read ahead.
+    virtual void reset();
+
+    //! Play the next block read.
+    virtual void render(RenderCountT f);
+
+    //! Store the frame position in the file.
+    virtual void write_state(StateBlob& b) const;
+
+    //! Restore the frame position, seeking in the file and filling blocks read ahead from there.
+    virtual void read_state(StateBlob& b);
+
+    //! Open a sound file for playing, replacing outputs with one for each channel; throws if it cannot be opened. Inputs reading from this Gen must be connected after this is called.
+    virtual void set_outputs_from_fp(const std::string& fp);
+
+    //! Overridden set outputs a std::string, treated a file path.
+    virtual void set_outputs(const std::string& fp);
+
+    //! Set the number of blocks of one frame read ahead of rendering; a greater depth tolerates longer stalls in reading. Takes effect on the next reset().
+    void set_read_ahead(std::size_t blocks);
+
+    //! Return the number of blocks read ahead.
+    std::size_t get_read_ahead() const {return _read_ahead;};
+
+    //! Return the number of blocks read and not yet played.
+    std::size_t get_buffered() const {return _ring ? _ring->size() : 0;};
+
+    //! Return the number of frames rendered silent since the last reset because no block was ready.
+    std::uint64_t get_underrun_count() const {
+            return _underrun_count.load();};
+
+    //! Return the length of the file in frames, or zero if no file is set.
+    SampleTimeT get_file_frames() const;
+};
+
+
+//=============================================================================
+//! A streaming resampler, reading its signal input at a rate set by an audio-rate input: a rate of 2 reads two input samples for each output sample, transposing up an octave; 0.5 transposes down an octave. Each output sample is interpolated with the band-limited kernel of a PolyphaseResampler, with the cutoff lowered as the rate rises above 1; rates are limited to between 0 and get_max_rate(). The signal input is rendered at its own pace, ahead of or behind the render count, as by SamplesBuffer; Gens connected to it must not be read by other Gens.
+class Resampler;
+typedef std::shared_ptr<Resampler> ResamplerPtr;
+class Resampler: public Gen {
+
+    private://-----------------------------------------------------------------
+    PIndexT _input_index_signal;
+    PIndexT _input_index_rate;
+
+    //! Never changed once made, and thus shared by copies.
+    std::shared_ptr<const PolyphaseResampler> _resampler;
+
+    //! The greatest rate, and the input reach needed at that rate.
+    SampleT _max_rate {8};
+    std::int64_t _max_reach {0};
+
+    //! Input samples read, starting _max_reach zeros before the first.
+    VSampleT _history;
+
+    //! The position in _history of the next output sample.
+    double _pos {0};
+
+    //! The render count of the last frame read from the signal input.
+    RenderCountT _input_render_count {0};
+
+    //! Render the next frame of the signal input and append it to _history.
+    void _read_frame();
+
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const {return GenPtr(new Resampler(*this));};
+
+    public://------------------------------------------------------------------
+    explicit Resampler(EnvPtr);
+
+    virtual void init();
+
+    virtual void reset();
+
+    virtual void set_default();
+
+    virtual void write_state(StateBlob& b) const;
+
+    virtual void read_state(StateBlob& b);
+
+    virtual void render(RenderCountT f);
+
+    //! Set the quality of interpolation; defaults to Medium. None is taken as Medium.
+    void set_quality(ResampleQuality q);
+
+    ResampleQuality get_quality() const {return _resampler->get_quality();};
+
+    //! Return the greatest rate.
+    SampleT get_max_rate() const {return _max_rate;};
+};
+
+
+//=============================================================================
+//! Policies of a VoiceAllocator for a note arriving when every voice is active.
+enum class VoiceSteal {
+    None, // the note is dropped
+    Oldest,
+    Quietest,
+};
+
+//! A polyphonic voice manager. set_voice() clones a voice network a fixed number of times; each trigger at the Trigger input is routed to a free voice by scheduling, at the same sample offset, the value of the Value input and a trigger on the Constants of that voice. Only active voices are rendered and mixed into the outputs; a voice sleeps once its envelope (or, without an envelope, its outputs) stays within the sleep threshold of zero for the sleep frames. With every voice active, a voice is stolen by the VoiceSteal policy. Each voice keeps its own render count, such that a sleeping voice need not catch up when woken. Voices are not inputs, but are reset with this Gen, and stored in its snapshots.
+class VoiceAllocator;
+typedef std::shared_ptr<VoiceAllocator> VoiceAllocatorPtr;
+class VoiceAllocator: public Gen {
+
+    private://-----------------------------------------------------------------
+    //! A voice network, with the Gens within it controlled or read.
+    struct Voice {
+        GenPtr gen;
+        ConstantPtr trigger;
+        ConstantPtr value;
+        //! The value of value when the voice was set, restored on reset.
+        SampleT value_init {0};
+        //! If not set, the outputs of gen are read for sleeping.
+        GenPtr envelope;
+        bool active {false};
+        //! The note count when last allocated, for stealing the oldest.
+        RenderCountT started {0};
+        RenderCountT silent_frames {0};
+        //! The greatest magnitude read in the last frame.
+        SampleT peak {0};
+    };
+
+    PIndexT _input_index_trigger;
+    PIndexT _input_index_value;
+
+    std::vector<Voice> _voices;
+
+    VoiceSteal _steal {VoiceSteal::Oldest};
+    SampleT _sleep_threshold {0.0001};
+    RenderCountT _sleep_frames {4};
+    RenderCountT _note_count {0};
+
+    //! Trigger offsets collected for the current frame.
+    VFrameSizeType _events_trigger;
+
+    //! Return a copy of the network of v, with the copies of the Gens within it.
+    static Voice _clone_voice(const Voice& v);
+
+    //! Allocate a voice, stealing if needed, and schedule a note at offset of its next frame.
+    void _start_note(FrameSizeT offset, SampleT value);
+
+    protected://---------------------------------------------------------------
+    virtual GenPtr _copy() const;
+
+    public://------------------------------------------------------------------
+    explicit VoiceAllocator(EnvPtr);
+
+    virtual void init();
+
+    virtual void reset();
+
+    virtual void set_default();
+
+    virtual void write_state(StateBlob& b) const;
 
+    //! Restore the allocation and the network of each voice; throws if the number of voices differs.
+    virtual void read_state(StateBlob& b);
+
+    virtual void render(RenderCountT f);
+
+    //! Make count voices as clones of voice, which must be at the frame size of this Gen. trigger and value must be Constants, and envelope, if given, a Gen, within the network of voice; their copies in each voice receive notes and are read for sleeping. The outputs of this Gen are set to those of voice. The given network is only copied, and is not rendered.
+    void set_voice(GenPtr voice, GenPtr trigger, GenPtr value,
+            PIndexT count, GenPtr envelope=nullptr);
+
+    //! Return the number of voices.
+    PIndexT get_voice_count() const {return _voices.size();};
+
+    //! Return the number of voices not sleeping.
+    PIndexT get_active_voice_count() const;
+
+    //! Set the policy for notes arriving with every voice active; defaults to Oldest.
+    void set_steal(VoiceSteal s) {_steal = s;};
+
+    VoiceSteal get_steal() const {return _steal;};
+
+    //! Set the magnitude at or below which a voice is taken as silent, and the number of consecutive silent frames after which it sleeps.
+    void set_sleep(SampleT threshold, RenderCountT frames);
+
+    SampleT get_sleep_threshold() const {return _sleep_threshold;};
+
+    RenderCountT get_sleep_frames() const {return _sleep_frames;};
+};
+
+
+//=============================================================================
+//! A streaming sound file writer. Interleaved samples are copied into chunks of a fixed number of frames, which a writer thread encodes to the file; memory use is bounded by the chunk size times the queue depth, however long the file. write() waits only if the writer thread falls a full queue behind. The file is AIFF, or WAV if the path ends in ".wav".
+class SoundFileWriter {
+
+    private://-----------------------------------------------------------------
+    //! Interleaved samples and the number of frames used.
+    struct Chunk {
+        VSampleT samples;
+        FrameSizeT frames {0};
+    };
+
+    std::string _fp;
+
+    std::unique_ptr<SndfileHandle> _file;
+
+    PIndexT _channels;
+
+    FrameSizeT _chunk_frames;
+
+    //! Chunks filled and not yet written.
+    std::unique_ptr<SPSCRing<Chunk>> _ring;
+
+    //! Caller thread: the chunk being filled.
+    Chunk _chunk;
+
+    //! Writer thread: the chunk being written.
+    Chunk _write_chunk;
+
+    std::thread _writer;
+    std::atomic<bool> _writing {false};
+
+    //! Set by the writer thread if the file does not take all frames.
+    std::atomic<bool> _failed {false};
+
+    //! Frames given to write() since opening.
+    std::uint64_t _frames {0};
+
+    //! Queue the chunk being filled, waiting if the queue is full.
+    void _push();
+
+    //! The writer thread loop.
+    void _write();
+
+    //! Throw if the writer thread failed.
+    void _check() const;
+
+    public://------------------------------------------------------------------
+    SoundFileWriter() = delete;
+
+    SoundFileWriter(const SoundFileWriter&) = delete;
+    SoundFileWriter& operator=(const SoundFileWriter&) = delete;
+
+    //! Open a file for writing and start the writer thread; throws if the file cannot be opened.
+    SoundFileWriter(const std::string& fp, PIndexT channels,
+            OutputsSizeT sampling_rate,
+            SampleFormat format=SampleFormat::PCM16,
+            FrameSizeT chunk_frames=4096, std::size_t queue_depth=4);
+
+    //! Closes the file if not already closed; errors are not reported.
+    ~SoundFileWriter();
+
+    //! Write frames of interleaved samples, or frames * channels values. Throws if the file could not be written.
+    void write(const SampleT* interleaved, FrameSizeT frames);
+
+    //! Write the remaining samples, stop the writer thread, and close the file, completing its header. Throws if the file could not be written.
+    void close();
+
+    //! Return true until closed.
+    bool is_open() const {return _file != nullptr;};
+
+    //! Return the number of frames given to write().
+    std::uint64_t get_frames() const {return _frames;};
+
+    //! Return the number of frames in each chunk.
+    FrameSizeT get_chunk_frames() const {return _chunk_frames;};
+};
 
 
 
@@ -0,0 +1,397 @@
+#include <stdexcept>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include "aw_performer_nrt.h"
+
+
+namespace aw {
+
+//-----------------------------------------------------------------------------
+FileSink :: FileSink(const std::string& fp, SampleFormat format)
+    : _fp{fp},
+    _format{format} {
+}
+
+FileSink :: ~FileSink() {
+    // the writer closes itself, without reporting errors
+    _file.reset();
+}
+
+void FileSink :: open(PIndexT channels, OutputsSizeT sampling_rate) {
+    _file.reset(new SoundFileWriter(_fp, channels, sampling_rate, _format));
+}
+
+void FileSink :: write(const SampleT* interleaved, FrameSizeT frames) {
+    _file->write(interleaved, frames);
+}
+
+void FileSink :: close() {
+    if (!_file) return;
+    _file->close();
+    _file.reset();
+}
+
+//-----------------------------------------------------------------------------
+void VectorSink :: open(PIndexT c, OutputsSizeT sampling_rate) {
+    channels = c;
+    samples.clear();
+}
+
+void VectorSink :: write(const SampleT* interleaved, FrameSizeT frames) {
+    samples.insert(samples.end(), interleaved,
+            interleaved + (frames * channels));
+}
+
+//-----------------------------------------------------------------------------
+NRTPerformer :: NRTPerformer(GenPtr g, SinkPtr s)
+    : _root{g},
+    _sink{s},
+    _environment{g->get_environment()} {
+    _interleaved.resize(g->get_frame_size() * g->get_output_count(), 0);
+}
+
+SampleTimeT NRTPerformer :: render_samples(SampleTimeT start,
+        SampleTimeT duration) {
+    _stop_requested.store(false);
+    _frames_rendered = 0;
+    _frames_written = 0;
+
+    PIndexT channels = _root->get_output_count();
+    FrameSizeT fs = _root->get_frame_size();
+    SampleTimeT end = start + duration;
+    // the first sample of render count f is (f-1) * fs
+    RenderCountT rc_start = (start / fs) + 1;
+    RenderCountT rc_end = duration == 0 ? rc_start : ((end - 1) / fs) + 2;
+    SampleTimeT t;
+    FrameSizeT i_start;
+    FrameSizeT i_end;
+    FrameSizeT i;
+    PIndexT c;
+    SampleT* dst;
+
+    std::chrono::steady_clock::time_point begin =
+            std::chrono::steady_clock::now();
+    _root->reset_network();
+    _sink->open(channels, _environment->get_sampling_rate());
+    // frames before the start are not written; seek analytically where possible, otherwise render them
+    if (rc_start > 1) {
+        // an analytic seek renders only the last frame
+        _frames_rendered += (_root->seek(rc_start - 1) ?
+                1 : rc_start - 1) * fs;
+    }
+    for (RenderCountT rc=rc_start; rc < rc_end; ++rc) {
+        if (_stop_requested.load()) break;
+        _root->render(rc);
+        _frames_rendered += fs;
+        // the range of this frame that falls within start and end
+        t = (rc - 1) * fs;
+        i_start = t < start ? start - t : 0;
+        i_end = t + fs > end ? end - t : fs;
+        dst = _interleaved.data();
+        for (i=i_start; i < i_end; ++i) {
+            for (c=0; c < channels; ++c) {
+                *dst++ = _root->outputs[c][i];
+            }
+        }
+        _sink->write(_interleaved.data(), i_end - i_start);
+        _frames_written += i_end - i_start;
+    }
+    _sink->close();
+    _elapsed_seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - begin).count();
+    return _frames_written;
+}
+
+SampleTimeT NRTPerformer :: render_seconds(double start,
+        double duration) {
+    if (start < 0 || duration < 0) {
+        std::stringstream msg;
+        msg << "start and duration must not be negative"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    OutputsSizeT sr = _environment->get_sampling_rate();
+    return render_samples(static_cast<SampleTimeT>(start * sr + .5),
+            static_cast<SampleTimeT>(duration * sr + .5));
+}
+
+SampleTimeT NRTPerformer :: operator()(double duration) {
+    return render_seconds(0, duration);
+}
+
+double NRTPerformer :: get_realtime_factor() const {
+    if (_elapsed_seconds <= 0) return 0;
+    return (static_cast<double>(_frames_rendered) /
+            _environment->get_sampling_rate()) / _elapsed_seconds;
+}
+
+double NRTPerformer :: get_throughput() const {
+    if (_elapsed_seconds <= 0) return 0;
+    return static_cast<double>(_frames_rendered) / _elapsed_seconds;
+}
+
+
+//-----------------------------------------------------------------------------
+NRTParallelPerformer :: NRTParallelPerformer(GenFactoryT f, SinkPtr s,
+        std::size_t threads)
+    : _factory{f},
+    _sink{s},
+    _threads{threads} {
+    // build one instance to learn the configuration of the graph
+    GenPtr g = _factory();
+    _environment = g->get_environment();
+    _channels = g->get_output_count();
+    _frame_size = g->get_frame_size();
+    if (_threads == 0) {
+        _threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    set_segment_size(_environment->get_sampling_rate() * 10);
+}
+
+void NRTParallelPerformer :: set_segment_size(SampleTimeT samples) {
+    if (samples == 0) {
+        std::stringstream msg;
+        msg << "segment size must be greater than 0"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    _segment_size = ((samples + _frame_size - 1) / _frame_size) *
+            _frame_size;
+}
+
+void NRTParallelPerformer :: set_pre_roll(SampleTimeT samples) {
+    _pre_roll_frames = (samples + _frame_size - 1) / _frame_size;
+}
+
+void NRTParallelPerformer :: _render_segment(GenPtr g, SampleTimeT start,
+        SampleTimeT end, StateBlob* checkpoint, bool pre_roll,
+        Segment& seg) {
+    FrameSizeT fs = _frame_size;
+    RenderCountT rc_start = (start / fs) + 1;
+    RenderCountT rc_end = ((end - 1) / fs) + 2;
+    SampleTimeT t;
+    FrameSizeT i_start;
+    FrameSizeT i_end;
+    FrameSizeT i;
+    PIndexT c;
+    SampleT* dst = seg.samples.data();
+
+    if (checkpoint != nullptr) {
+        g->restore_network(*checkpoint);
+    }
+    else if (pre_roll) {
+        RenderCountT rc_begin = rc_start > _pre_roll_frames ?
+                rc_start - _pre_roll_frames : 1;
+        g->reset_network(rc_begin - 1);
+        for (RenderCountT rc=rc_begin; rc < rc_start; ++rc) {
+            g->render(rc);
+        }
+    }
+    else {
+        g->seek(rc_start - 1);
+    }
+    for (RenderCountT rc=rc_start; rc < rc_end; ++rc) {
+        g->render(rc);
+        t = (rc - 1) * fs;
+        i_start = t < start ? start - t : 0;
+        i_end = t + fs > end ? end - t : fs;
+        for (i=i_start; i < i_end; ++i) {
+            for (c=0; c < _channels; ++c) {
+                *dst++ = g->outputs[c][i];
+            }
+        }
+    }
+    seg.frames = end - start;
+}
+
+SampleTimeT NRTParallelPerformer :: render_samples(SampleTimeT start,
+        SampleTimeT duration) {
+    _frames_written = 0;
+    _max_difference = 0;
+    _first_difference = 0;
+    FrameSizeT fs = _frame_size;
+    SampleTimeT end = start + duration;
+    std::size_t count = (duration + _segment_size - 1) / _segment_size;
+    // segments may be rendered up to this many ahead of writing
+    std::size_t window = _threads * 2;
+
+    std::vector<Segment> segments(window);
+    for (auto& seg : segments) {
+        seg.samples.resize(_segment_size * _channels, 0);
+    }
+    // all instances are clones of one graph, made here as cloning waits for loads
+    GenPtr base = _factory();
+    bool analytic = base->can_seek_analytically();
+    // without analytic seeking, either pre-roll each segment, or restore checkpoints
+    bool pre_roll = !analytic && _pre_roll_frames > 0;
+    bool checkpointed = !analytic && !pre_roll;
+    std::size_t thread_count = std::min(_threads, count);
+    std::vector<GenPtr> instances;
+    for (std::size_t i=0; i < thread_count + 2; ++i) {
+        try {
+            instances.push_back(base->clone());
+        }
+        catch (const std::domain_error&) {
+            // graphs that cannot be copied (with a FilePlayer) are built again
+            instances.push_back(_factory());
+        }
+    }
+    // with checkpoints, the state at each segment boundary, and the index of the segment it starts
+    std::vector<StateBlob> checkpoints(window);
+    std::vector<std::size_t> checkpoint_for(window, count);
+    std::mutex m;
+    std::condition_variable cv;
+    std::size_t next {0}; // next segment to render
+    std::size_t written {0}; // segments written
+
+    std::chrono::steady_clock::time_point begin =
+            std::chrono::steady_clock::now();
+    _sink->open(_channels, _environment->get_sampling_rate());
+
+    auto checkpointer = [&](GenPtr g) {
+        g->reset_network();
+        for (std::size_t k=0; k < count; ++k) {
+            RenderCountT rc = (start + k * _segment_size) / fs;
+            // renders frames up to the one before this segment, one at a time, as a render skipping frames reads only the last frame of inputs
+            for (RenderCountT r=g->get_render_count() + 1; r <= rc; ++r) {
+                g->render(r);
+            }
+            StateBlob b = g->snapshot_network();
+            {
+                std::unique_lock<std::mutex> lock(m);
+                // a slot is free once the segment that used it is written
+                cv.wait(lock, [&](){return k < written + window;});
+                checkpoints[k % window] = std::move(b);
+                checkpoint_for[k % window] = k;
+            }
+            cv.notify_all();
+        }
+    };
+    auto worker = [&](GenPtr g) {
+        std::size_t k;
+        StateBlob checkpoint;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&](){
+                        return next >= count || next < written + window;});
+                if (next >= count) return;
+                k = next++;
+                if (checkpointed) {
+                    cv.wait(lock, [&](){
+                            return checkpoint_for[k % window] == k;});
+                    checkpoint = std::move(checkpoints[k % window]);
+                }
+            }
+            Segment& seg = segments[k % window];
+            SampleTimeT a = start + k * _segment_size;
+            _render_segment(g, a, std::min(end, a + _segment_size),
+                    checkpointed ? &checkpoint : nullptr, pre_roll, seg);
+            {
+                std::lock_guard<std::mutex> lock(m);
+                seg.ready = true;
+            }
+            cv.notify_all();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (std::size_t i=0; i < thread_count; ++i) {
+        workers.push_back(std::thread(worker, instances[i]));
+    }
+    if (checkpointed && count > 0) {
+        workers.push_back(std::thread(checkpointer,
+                instances[thread_count]));
+    }
+
+    // a serial instance for verification
+    GenPtr serial = instances[thread_count + 1];
+    RenderCountT serial_rc {1}; // next render count to compare
+    RenderCountT serial_rendered {0};
+    if (_verify) {
+        serial->reset_network();
+    }
+    SampleTimeT t;
+    SampleTimeT a;
+    SampleTimeT b;
+    SampleTimeT i;
+    SampleT d;
+    PIndexT c;
+
+    // write in order on this thread
+    for (std::size_t k=0; k < count; ++k) {
+        Segment& seg = segments[k % window];
+        {
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [&](){return seg.ready;});
+        }
+        _sink->write(seg.samples.data(), seg.frames);
+        _frames_written += seg.frames;
+
+        if (_verify) {
+            a = start + k * _segment_size;
+            b = a + seg.frames;
+            // frames may straddle segments if start is not frame aligned
+            while ((serial_rc - 1) * fs < b) {
+                if (serial_rendered < serial_rc) {
+                    serial->render(serial_rc);
+                    serial_rendered = serial_rc;
+                }
+                t = (serial_rc - 1) * fs;
+                for (i = std::max(t, a); i < std::min(t + fs, b); ++i) {
+                    for (c=0; c < _channels; ++c) {
+                        d = std::fabs(serial->outputs[c][i - t] -
+                                seg.samples[(i - a) * _channels + c]);
+                        if (d > _max_difference) {
+                            if (_max_difference == 0) {
+                                _first_difference = i - start;
+                            }
+                            _max_difference = d;
+                        }
+                    }
+                }
+                if (t + fs > b) break;
+                ++serial_rc;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(m);
+            seg.ready = false;
+            ++written;
+        }
+        cv.notify_all();
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    _sink->close();
+    _elapsed_seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - begin).count();
+    return _frames_written;
+}
+
+SampleTimeT NRTParallelPerformer :: render_seconds(double start,
+        double duration) {
+    if (start < 0 || duration < 0) {
+        std::stringstream msg;
+        msg << "start and duration must not be negative"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    OutputsSizeT sr = _environment->get_sampling_rate();
+    return render_samples(static_cast<SampleTimeT>(start * sr + .5),
+            static_cast<SampleTimeT>(duration * sr + .5));
+}
+
+double NRTParallelPerformer :: get_realtime_factor() const {
+    if (_elapsed_seconds <= 0) return 0;
+    return (static_cast<double>(_frames_written) /
+            _environment->get_sampling_rate()) / _elapsed_seconds;
+}
+
+
+} // end namespace aw
@@ -0,0 +1,234 @@
+#ifndef _AW_PERFORMER_NRT_H_
+#define _AW_PERFORMER_NRT_H_
+
+#include <string>
+#include <atomic>
+#include <memory>
+#include <functional>
+
+#include "aw_common.h"
+#include "aw_generator.h"
+
+namespace aw {
+
+//=============================================================================
+//! A destination for blocks rendered by an NRTPerformer. Blocks are passed as interleaved samples, and are only valid for the duration of the call.
+class Sink;
+typedef std::shared_ptr<Sink> SinkPtr;
+class Sink {
+
+    public://------------------------------------------------------------------
+
+    virtual ~Sink() {};
+
+    //! Called before the first block with the number of channels and the sampling rate.
+    virtual void open(PIndexT channels, OutputsSizeT sampling_rate) {};
+
+    //! Receive frames of interleaved samples, or frames * channels values.
+    virtual void write(const SampleT* interleaved, FrameSizeT frames) = 0;
+
+    //! Called after the last block.
+    virtual void close() {};
+
+};
+
+//=============================================================================
+//! A Sink that writes to a sound file with a SoundFileWriter: blocks are encoded on a writer thread, and memory use is bounded by the writer's chunks, however long the render. The file is AIFF (or WAV if the path ends in ".wav"), with samples encoded as 16 bit by default, as with SamplesBuffer::write_output_to_fp().
+class FileSink: public Sink {
+
+    private://-----------------------------------------------------------------
+
+    std::string _fp;
+
+    SampleFormat _format;
+
+    std::unique_ptr<SoundFileWriter> _file;
+
+    public://------------------------------------------------------------------
+
+    FileSink() = delete;
+
+    explicit FileSink(const std::string& fp,
+            SampleFormat format=SampleFormat::PCM16);
+
+    ~FileSink();
+
+    //! Open the file for writing; throws if it cannot be opened.
+    virtual void open(PIndexT channels, OutputsSizeT sampling_rate);
+
+    virtual void write(const SampleT* interleaved, FrameSizeT frames);
+
+    //! Write remaining samples and close the file, completing its header.
+    virtual void close();
+
+};
+
+//=============================================================================
+//! A Sink that appends all samples to a vector of interleaved samples; memory is not bounded, and this is mostly useful for testing and short renders.
+class VectorSink: public Sink {
+
+    public://------------------------------------------------------------------
+
+    //! The interleaved samples received.
+    VSampleT samples;
+
+    //! The number of channels given at open().
+    PIndexT channels {0};
+
+    virtual void open(PIndexT channels, OutputsSizeT sampling_rate);
+
+    virtual void write(const SampleT* interleaved, FrameSizeT frames);
+
+};
+
+
+//=============================================================================
+//! A non-realtime performer: drives a root Gen frame by frame as fast as possible, passing all outputs of each frame, interleaved, to a Sink. Only one frame is held at a time. Rendering can start after the beginning (frames before the start are rendered, but not written), be bounded by a duration in samples or seconds, and be stopped from another thread. After each performance, the realtime factor and throughput are available.
+class NRTPerformer {
+
+    private://-----------------------------------------------------------------
+
+    GenPtr _root;
+
+    SinkPtr _sink;
+
+    EnvPtr _environment;
+
+    //! One frame of interleaved outputs.
+    VSampleT _interleaved;
+
+    //! Set by stop() from any thread; checked before each frame.
+    std::atomic<bool> _stop_requested {false};
+
+    //! Statistics of the last performance.
+    SampleTimeT _frames_rendered {0};
+    SampleTimeT _frames_written {0};
+    double _elapsed_seconds {0};
+
+    public://------------------------------------------------------------------
+
+    NRTPerformer() = delete;
+
+    //! Create a performer for a root Gen and a Sink.
+    NRTPerformer(GenPtr g, SinkPtr s);
+
+    //! Render from sample start for duration samples, writing each frame to the Sink. The root is reset first, and moved to the frame containing start with Gen::seek(). Returns the number of frames (samples per channel) written, which is less than duration if stopped.
+    SampleTimeT render_samples(SampleTimeT start, SampleTimeT duration);
+
+    //! Render from start seconds for duration seconds.
+    SampleTimeT render_seconds(double start, double duration);
+
+    //! Render from the beginning for duration seconds.
+    SampleTimeT operator()(double duration);
+
+    //! Request that rendering stop before the next frame; safe to call from any thread.
+    void stop() {_stop_requested.store(true);};
+
+    //! Return the number of frames rendered in the last performance, including those rendered before the start when seeking.
+    SampleTimeT get_frames_rendered() const {return _frames_rendered;};
+
+    //! Return the number of frames written to the Sink in the last performance.
+    SampleTimeT get_frames_written() const {return _frames_written;};
+
+    //! Return the wall-clock duration of the last performance in seconds.
+    double get_elapsed_seconds() const {return _elapsed_seconds;};
+
+    //! Return the seconds of audio rendered per second of wall-clock time in the last performance; greater than 1 is faster than realtime.
+    double get_realtime_factor() const;
+
+    //! Return the number of samples per channel rendered per second of wall-clock time in the last performance.
+    double get_throughput() const;
+
+};
+
+
+//=============================================================================
+//! A function that builds a new, independent instance of the same graph, returning its root. It must produce identical graphs on each call. It is called once for each performance, and the graph cloned for each thread; graphs that cannot be cloned are built again with further calls.
+typedef std::function<GenPtr()> GenFactoryT;
+
+//=============================================================================
+//! A non-realtime performer that renders segments of the timeline concurrently, each on its own clone of a graph built by a GenFactoryT, and writes them to a Sink in order, stitched sample-exactly. Each segment starts from the state a serial render has at its first frame. If the graph can be moved analytically (see Gen::seek()), each clone seeks to its segment, and segments render fully in parallel; oscillators moved analytically match a serial render to within rounding. Otherwise, by default, a checkpoint thread renders the graph serially, taking a snapshot (see Gen::snapshot_network()) at each segment boundary, which a clone restores before rendering its segment; the output is then identical to a serial render, but the render is no faster than serial, as the checkpoint thread renders every frame. With a pre-roll (see set_pre_roll()), such graphs instead render fully in parallel: each clone starts from the reset state (see Gen::reset_network()) the pre-roll before its segment and renders through the pre-roll without writing, which is exact only for graphs whose state converges within the pre-roll. The verify mode renders a serial instance alongside and reports the greatest difference. Memory is bounded to a window of two segments and snapshots per thread. White draws from a random engine for each thread, and does not repeat the values of a serial render.
+class NRTParallelPerformer {
+
+    private://-----------------------------------------------------------------
+
+    //! A rendered segment of interleaved samples, held until written in order.
+    struct Segment {
+        VSampleT samples;
+        FrameSizeT frames {0};
+        bool ready {false};
+    };
+
+    GenFactoryT _factory;
+
+    SinkPtr _sink;
+
+    EnvPtr _environment;
+
+    PIndexT _channels;
+
+    FrameSizeT _frame_size;
+
+    std::size_t _threads;
+
+    //! The size of each segment in samples per channel; a multiple of the frame size.
+    SampleTimeT _segment_size;
+
+    //! The number of frames rendered and discarded before each segment of a graph that cannot be moved analytically; if zero, checkpoints are used.
+    RenderCountT _pre_roll_frames {0};
+
+    bool _verify {false};
+
+    //! Statistics of the last performance.
+    SampleTimeT _frames_written {0};
+    double _elapsed_seconds {0};
+    SampleT _max_difference {0};
+    SampleTimeT _first_difference {0};
+
+    //! Render one segment of the timeline into seg, restoring checkpoint, the state at the frame before start; if checkpoint is null, rendering through the pre-roll if pre_roll is true, or otherwise seeking.
+    void _render_segment(GenPtr g, SampleTimeT start, SampleTimeT end,
+            StateBlob* checkpoint, bool pre_roll, Segment& seg);
+
+    public://------------------------------------------------------------------
+
+    NRTParallelPerformer() = delete;
+
+    //! Create a performer from a graph factory and a Sink. If threads is zero, the number of hardware threads is used.
+    NRTParallelPerformer(GenFactoryT f, SinkPtr s, std::size_t threads=0);
+
+    //! Set the segment size in samples; rounded up to whole frames. Defaults to ten seconds.
+    void set_segment_size(SampleTimeT samples);
+
+    //! Set the pre-roll before each segment in samples; rounded up to whole frames. If greater than zero, graphs that cannot be moved analytically render each segment in parallel after the pre-roll, rather than from exact checkpoints; use verify to measure the deviation from a serial render. Defaults to zero.
+    void set_pre_roll(SampleTimeT samples);
+
+    //! If true, also render a serial instance and compare it with each segment as it is written.
+    void set_verify(bool v) {_verify = v;};
+
+    //! Render from sample start for duration samples. Returns the number of frames written.
+    SampleTimeT render_samples(SampleTimeT start, SampleTimeT duration);
+
+    //! Render from start seconds for duration seconds.
+    SampleTimeT render_seconds(double start, double duration);
+
+    //! Return the number of frames written in the last performance.
+    SampleTimeT get_frames_written() const {return _frames_written;};
+
+    //! Return the wall-clock duration of the last performance in seconds.
+    double get_elapsed_seconds() const {return _elapsed_seconds;};
+
+    //! Return the seconds of audio written per second of wall-clock time in the last performance.
+    double get_realtime_factor() const;
+
+    //! With verify, return the greatest absolute difference from the serial render in the last performance; zero if sample-exact.
+    SampleT get_max_difference() const {return _max_difference;};
+
+    //! With verify, return the sample time (from start) of the first difference from the serial render; only meaningful if get_max_difference() is not zero.
+    SampleTimeT get_first_difference() const {return _first_difference;};
+
+};
+
+
+} // end namespace aw
+
+#endif // ends _AW_PERFORMER_NRT_H_
@@ -1,4 +1,5 @@
 
+
 #include "aw_performer_pa.h"
 
 namespace aw {
@@ -10,9 +11,162 @@ namespace aw {
         //PACBData* data = (PACBData*)userData;
         //std::cout << "stream_finished" << std::endl;
     }
+
+
+    const VVSampleT& pacb_render_gens(PACBData* data) {
+
+        if (data->command_queue) {
+            data->command_queue->drain();
+        }
+        // take a newly published root only at a block boundary
+        if (data->incoming_gen == nullptr) {
+            Gen* p = data->pending_gen.exchange(nullptr,
+                    std::memory_order_acquire);
+            if (p != nullptr) {
+                data->incoming_gen = p;
+                data->incoming_render_count = data->pending_render_count;
+                data->fade_size = data->pending_fade_size;
+                data->fade_pos = 0;
+            }
+        }
+        // without a crossfade, switch before rendering
+        if (data->incoming_gen != nullptr && data->fade_size == 0) {
+            data->retired_gen.store(data->root_gen,
+                    std::memory_order_release);
+            data->root_gen = data->incoming_gen;
+            data->render_count = data->incoming_render_count;
+            data->incoming_gen = nullptr;
+        }
+
+        Gen* root = data->root_gen;
+        root->render(data->render_count);
+        ++(data->render_count);
+        if (data->incoming_gen == nullptr) {
+            return root->outputs;
+        }
+
+        // crossfade linearly from the root to the incoming root
+        Gen* incoming = data->incoming_gen;
+        incoming->render(data->incoming_render_count);
+        ++(data->incoming_render_count);
+        FrameSizeT fs = root->get_frame_size();
+        SampleT w;
+        for (PIndexT c=0; c < data->channels; ++c) {
+            const SampleT* a = root->outputs[c].data();
+            const SampleT* b = incoming->outputs[c].data();
+            SampleT* dst = data->mix[c].data();
+            for (FrameSizeT i=0; i < fs; ++i) {
+                w = static_cast<SampleT>(data->fade_pos + i + 1) /
+                        data->fade_size;
+                if (w > 1) w = 1;
+                dst[i] = a[i] * (1 - w) + b[i] * w;
+            }
+        }
+        data->fade_pos += fs;
+        if (data->fade_pos >= data->fade_size) {
+            // the previous root is not touched after this
+            data->retired_gen.store(root, std::memory_order_release);
+            data->root_gen = incoming;
+            data->render_count = data->incoming_render_count;
+            data->incoming_gen = nullptr;
+        }
+        return data->mix;
+    }
+
+
+    void pacb_render_block(PACBData* data, float* const* out,
+            unsigned long framesPerBuffer) {
+        const VVSampleT& src = pacb_render_gens(data);
+        for (PIndexT c=0; c < data->device_channels; ++c) {
+            data->sources[c] = src[data->channel_map[c]].data();
+        }
+        if (data->interleaved) {
+            interleave_to_float(data->sources.data(),
+                    data->device_channels, out[0], framesPerBuffer);
+        }
+        else {
+            for (PIndexT c=0; c < data->device_channels; ++c) {
+                to_float(data->sources[c], out[c], framesPerBuffer);
+            }
+        }
+    }
+
+
+    void pacb_silence(PACBData* data, float* const* out,
+            unsigned long framesPerBuffer) {
+        if (data->interleaved) {
+            std::fill(out[0],
+                    out[0] + framesPerBuffer * data->device_channels, 0);
+        }
+        else {
+            for (PIndexT c=0; c < data->device_channels; ++c) {
+                std::fill(out[c], out[c] + framesPerBuffer, 0);
+            }
+        }
+    }
+
+
+    bool pacb_take_ahead(PACBData* data) {
+        if (!data->ahead_ring->pop(data->block)) {
+            std::fill(data->block.begin(), data->block.end(), 0);
+            return false;
+        }
+        return true;
+    }
+
+
+    void pacb_serve(PACBData* data, float* const* out,
+            unsigned long framesPerBuffer) {
+        FrameSizeT fs = data->frame_size;
+        PIndexT dc = data->device_channels;
+        if (framesPerBuffer == fs && data->block_pos == fs &&
+                data->ahead_ring == nullptr) {
+            pacb_render_block(data, out, framesPerBuffer);
+            return;
+        }
+        unsigned long offset {0};
+        unsigned long count;
+        // one device buffer can span several blocks; an underrun is counted once for the callback
+        bool underrun {false};
+        while (offset < framesPerBuffer) {
+            if (data->block_pos == fs) {
+                if (data->ahead_ring != nullptr) {
+                    if (!pacb_take_ahead(data)) underrun = true;
+                }
+                else {
+                    for (PIndexT c=0; c < dc; ++c) {
+                        data->block_out[c] = data->block.data() +
+                                (data->interleaved ? 0 : c * fs);
+                    }
+                    pacb_render_block(data, data->block_out.data(), fs);
+                }
+                data->block_pos = 0;
+            }
+            count = std::min<unsigned long>(framesPerBuffer - offset,
+                    fs - data->block_pos);
+            const float* src = data->block.data();
+            if (data->interleaved) {
+                src += data->block_pos * dc;
+                std::copy(src, src + count * dc, out[0] + offset * dc);
+            }
+            else {
+                // stored one channel after another
+                src += data->block_pos;
+                for (PIndexT c=0; c < dc; ++c) {
+                    std::copy(src, src + count, out[c] + offset);
+                    src += fs;
+                }
+            }
+            data->block_pos += count;
+            offset += count;
+        }
+        if (underrun) {
+            data->underrun_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
         
         
-    int pacb_render_mono(
+    int pacb_render_interleaved(
            const void *inputBuffer,
            void* outputBuffer,
            unsigned long framesPerBuffer,
@@ -26,25 +180,15 @@ namespace aw {
         
         if (data->pre_roll_render_count < data->pre_roll_render_max) {
             data->pre_roll_render_count += framesPerBuffer;
-            for (unsigned int i=0; i < framesPerBuffer; ++i) {
-                *out++ = 0;
-                *out++ = 0;
-            }
+            pacb_silence(data, &out, framesPerBuffer);
             return paContinue;
         }
-        
-        (data->root_gen)->render(data->render_count);
-        ++(data->render_count);
-        for (unsigned int i=0; i < framesPerBuffer; ++i) {
-            *out++ = (data->root_gen)->outputs[0][i];
-            *out++ = (data->root_gen)->outputs[0][i];
-
-        }
+        pacb_serve(data, &out, framesPerBuffer);
         return paContinue;
     }
 
 
-    int pacb_render_stereo(
+    int pacb_render_non_interleaved(
             const void *inputBuffer,
             void* outputBuffer,
             unsigned long framesPerBuffer,
@@ -54,24 +198,15 @@ namespace aw {
             ) {
 
         PACBData* data = static_cast<PACBData*>(userData);
-        float* out = static_cast<float *>(outputBuffer);
+        // with paNonInterleaved, an array of one buffer per channel
+        float* const* out = static_cast<float* const*>(outputBuffer);
         
         if (data->pre_roll_render_count < data->pre_roll_render_max) {
             data->pre_roll_render_count += framesPerBuffer;
-            for (unsigned int i=0; i < framesPerBuffer; ++i) {
-                *out++ = 0;
-                *out++ = 0;
-            }
+            pacb_silence(data, out, framesPerBuffer);
             return paContinue;
         }
-        
-        (data->root_gen)->render(data->render_count);
-        ++(data->render_count);
-        for (unsigned int i=0; i < framesPerBuffer; ++i) {
-            *out++ = (data->root_gen)->outputs[0][i];
-            *out++ = (data->root_gen)->outputs[1][i];
-            
-        }
+        pacb_serve(data, out, framesPerBuffer);
         return paContinue;
     }
 
@@ -82,80 +217,281 @@ namespace aw {
     
 PAPerformer :: PAPerformer(GenPtr g) {
     // pass in a generator at creation
-    _cb_data.root_gen = g;
+    _root = g;
+    _cb_data.root_gen = g.get();
     _cb_data.channels = g->get_output_count();
     _environment = g->get_environment();
+    _device_frames = _environment->get_common_frame_size();
 }
 
-int PAPerformer :: operator()(int dur) {
-    // reset for each performance
-    _cb_data.render_count = 0;
+PAPerformer :: ~PAPerformer() {
+    stop();
+}
+
+void PAPerformer :: _produce() {
+    FrameSizeT fs = _environment->get_common_frame_size();
+    PIndexT dc = _cb_data.device_channels;
+    std::vector<float> block(fs * dc, 0);
+    // destinations in the block, in the device layout
+    std::vector<float*> out(dc, nullptr);
+    // when full, wait about a quarter of a block before checking again
+    std::chrono::microseconds wait(
+            (250000 * fs) / _environment->get_sampling_rate());
+    while (_producing.load(std::memory_order_acquire)) {
+        if (_ahead_ring->size() >= _ahead_ring->capacity()) {
+            std::this_thread::sleep_for(wait);
+            continue;
+        }
+        // the block storage changes with each push
+        for (PIndexT c=0; c < dc; ++c) {
+            out[c] = block.data() + (_cb_data.interleaved ? 0 : c * fs);
+        }
+        c_pa::pacb_render_block(&_cb_data, out.data(), fs);
+        _ahead_ring->push(block);
+    }
+}
+
+FrameSizeT PAPerformer :: get_adapter_latency() const {
+    FrameSizeT fs = _environment->get_common_frame_size();
+    if (_device_frames == 0) {
+        return fs - 1;
+    }
+    // frames left in the FIFO after a callback are a multiple of the gcd
+    unsigned long a = fs;
+    unsigned long b = _device_frames;
+    unsigned long t;
+    while (b != 0) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return _device_frames % fs == 0 ? 0 : fs - a;
+}
+
+void PAPerformer :: set_channel_map(const std::vector<PIndexT>& map) {
+    for (auto x : map) {
+        if (x >= _cb_data.channels) {
+            std::stringstream msg;
+            msg << "root output is not available: " << x
+                    << str_file_line(__FILE__, __LINE__);
+            throw std::invalid_argument(msg.str());
+        }
+    }
+    _channel_map = map;
+}
+
+PaError PAPerformer :: _error(PaError err) {
+    if (_producer.joinable()) {
+        _producing.store(false);
+        _producer.join();
+    }
+    Pa_Terminate();
+    _stream = nullptr;
+    std::cerr << "An error occured while using the portaudio stream." << std::endl;
+    std::cerr << "Error number: " << err << std::endl;
+    std::cerr << "Error message: " << Pa_GetErrorText(err) << std::endl;
+    return err;
+}
+
+PaError PAPerformer :: start() {
+    std::lock_guard<std::mutex> lock(_control_mutex);
+    if (_stream != nullptr) {
+        return paNoError;
+    }
+    // reset for each performance; render count 1 is the first frame
+    _root->reset_network();
+    RenderCountT rc_start = (_start /
+            _environment->get_common_frame_size()) + 1;
+    if (rc_start > 1) {
+        _root->seek(rc_start - 1);
+    }
+    _cb_data.root_gen = _root.get();
+    _cb_data.render_count = rc_start;
     _cb_data.pre_roll_render_count = 0;
     _cb_data.pre_roll_render_max = (_pre_roll_seconds *
             _environment->get_sampling_rate());
     
-    // create outside of scope
-    auto f_callback = &c_pa::pacb_render_mono;
-    // pass function call back // pass function by reference
-    if (_cb_data.channels == 2) {
-        f_callback = &c_pa::pacb_render_stereo;
+    // map device channels to root outputs
+    if (_channel_map.size() > 0) {
+        _cb_data.channel_map = _channel_map;
+    }
+    else if (_cb_data.channels == 1) {
+        _cb_data.channel_map = {0, 0};
     }
     else {
-        std::cerr << "channel count not handled" << std::endl;
+        _cb_data.channel_map.clear();
+        for (PIndexT c=0; c < _cb_data.channels; ++c) {
+            _cb_data.channel_map.push_back(c);
+        }
+    }
+    _cb_data.device_channels = _cb_data.channel_map.size();
+    _cb_data.sources.assign(_cb_data.device_channels, nullptr);
+    FrameSizeT fs = _environment->get_common_frame_size();
+    _cb_data.mix.assign(_cb_data.channels, VSampleT(fs, 0));
+
+    // the FIFO starts empty
+    _cb_data.frame_size = fs;
+    _cb_data.block.assign(fs * _cb_data.device_channels, 0);
+    _cb_data.block_pos = fs;
+    _cb_data.block_out.assign(_cb_data.device_channels, nullptr);
+
+    _cb_data.underrun_count.store(0);
+    if (_render_ahead > 0) {
+        // blocks circulate between the producer and the callback without allocation
+        _ahead_ring.reset(new SPSCRing<std::vector<float>>(
+                _render_ahead, _cb_data.block));
+        _cb_data.ahead_ring = _ahead_ring.get();
+        _producing.store(true);
+        _producer = std::thread(&PAPerformer::_produce, this);
+    }
+    else {
+        _cb_data.ahead_ring = nullptr;
+    }
+    
+    auto f_callback = &c_pa::pacb_render_interleaved;
+    if (!_cb_data.interleaved) {
+        f_callback = &c_pa::pacb_render_non_interleaved;
     }
     
     PaStreamParameters outputParameters;
-    PaStream* stream;
     PaError err;
     err = Pa_Initialize();
-    if( err != paNoError ) goto error;
+    if( err != paNoError ) return _error(err);
     outputParameters.device = Pa_GetDefaultOutputDevice(); /* default output device */
     if (outputParameters.device == paNoDevice) {
         //fprintf(stderr,"Error: No default output device.\n");
         std::cerr << "Error: No default output device." << std::endl;
-        goto error;
+        return _error(paInvalidDevice);
+    }
+    if (Pa_GetDeviceInfo(outputParameters.device)->maxOutputChannels <
+            static_cast<int>(_cb_data.device_channels)) {
+        std::cerr << "Error: the device does not have " <<
+                _cb_data.device_channels << " output channels." << std::endl;
+        return _error(paInvalidChannelCount);
     }
-    outputParameters.channelCount = 2;       /* stereo output */
+    outputParameters.channelCount = _cb_data.device_channels;
     outputParameters.sampleFormat = paFloat32; /* 32 bit floating point output */
+    if (!_cb_data.interleaved) {
+        outputParameters.sampleFormat |= paNonInterleaved;
+    }
     outputParameters.suggestedLatency = Pa_GetDeviceInfo(
             outputParameters.device )->defaultLowOutputLatency;
     outputParameters.hostApiSpecificStreamInfo = NULL;
     
     err = Pa_OpenStream(
-            &stream,
+            &_stream,
             NULL, // no input
             &outputParameters,
             _environment->get_sampling_rate(),
-            _environment->get_common_frame_size(), // FRAMES_PER_BUFFER
+            _device_frames == 0 ? paFramesPerBufferUnspecified :
+                    _device_frames, // FRAMES_PER_BUFFER
             paClipOff, // don't bother clipping them
             f_callback,
             &_cb_data);
     
-    if( err != paNoError ) goto error;
-    
-    err = Pa_SetStreamFinishedCallback(stream, &c_pa::pacb_stream_finished);
-    if( err != paNoError ) goto error;
-    
-    err = Pa_StartStream(stream);
-    if( err != paNoError ) goto error;
+    if( err != paNoError ) return _error(err);
     
-    Pa_Sleep(dur * 1000); // sleep sustains playback:
+    err = Pa_SetStreamFinishedCallback(_stream, &c_pa::pacb_stream_finished);
+    if( err != paNoError ) return _error(err);
     
-    err = Pa_StopStream(stream);
-    if( err != paNoError ) goto error;
-    err = Pa_CloseStream(stream);
-    if( err != paNoError ) goto error;
-    
-    Pa_Terminate();
+    err = Pa_StartStream(_stream);
+    if( err != paNoError ) return _error(err);
     return err;
-    
-error:
+}
+
+PaError PAPerformer :: stop() {
+    std::lock_guard<std::mutex> lock(_control_mutex);
+    if (_stream == nullptr) {
+        return paNoError;
+    }
+    PaError err;
+    err = Pa_StopStream(_stream);
+    if( err != paNoError ) return _error(err);
+    err = Pa_CloseStream(_stream);
+    if( err != paNoError ) return _error(err);
+    _stream = nullptr;
     Pa_Terminate();
-    std::cerr << "An error occured while using the portaudio stream." << std::endl;
-    std::cerr << "Error number: " << err << std::endl;
-    std::cerr << "Error message: " << Pa_GetErrorText(err) << std::endl;
+    if (_producer.joinable()) {
+        _producing.store(false);
+        _producer.join();
+    }
+
+    // the callback and the producer are no longer running: complete any swap in progress
+    if (_incoming) {
+        _root = _incoming;
+        _incoming.reset();
+    }
+    _cb_data.pending_gen.store(nullptr);
+    _cb_data.retired_gen.store(nullptr);
+    _cb_data.incoming_gen = nullptr;
+    _cb_data.root_gen = _root.get();
     return err;
 }
+
+void PAPerformer :: _reclaim() {
+    if (_cb_data.retired_gen.load(std::memory_order_acquire) == nullptr) {
+        return;
+    }
+    // the callback has switched to _incoming; the previous root may be destroyed here
+    _root = _incoming;
+    _incoming.reset();
+    _cb_data.retired_gen.store(nullptr, std::memory_order_release);
+}
+
+bool PAPerformer :: reclaim() {
+    std::lock_guard<std::mutex> lock(_control_mutex);
+    _reclaim();
+    return _incoming != nullptr;
+}
+
+bool PAPerformer :: swap_root(GenPtr g, FrameSizeT fade_size,
+        RenderCountT warm_frames) {
+    if (g->get_output_count() != _cb_data.channels) {
+        std::stringstream msg;
+        msg << "the new root must have the same number of outputs: "
+                << _cb_data.channels
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    std::lock_guard<std::mutex> lock(_control_mutex);
+    _reclaim();
+    if (_incoming) {
+        return false;
+    }
+    if (_stream == nullptr) {
+        // not playing: the new root is reset on start()
+        _root = g;
+        _cb_data.root_gen = g.get();
+        return true;
+    }
+    // warm here, off the render thread: first renders may allocate or load
+    g->reset_network();
+    for (RenderCountT rc=1; rc <= warm_frames; ++rc) {
+        g->render(rc);
+    }
+    _incoming = g;
+    FrameSizeT fs = _environment->get_common_frame_size();
+    _cb_data.pending_render_count = warm_frames + 1;
+    _cb_data.pending_fade_size = ((fade_size + fs - 1) / fs) * fs;
+    _cb_data.pending_gen.store(g.get(), std::memory_order_release);
+    return true;
+}
+
+GenPtr PAPerformer :: get_root() {
+    std::lock_guard<std::mutex> lock(_control_mutex);
+    return _incoming ? _incoming : _root;
+}
+
+int PAPerformer :: operator()(int dur) {
+    PaError err = start();
+    if( err != paNoError ) return err;
+    // sleep sustains playback; wake to release swapped roots
+    for (long ms = dur * 1000; ms > 0; ms -= 100) {
+        Pa_Sleep(ms < 100 ? ms : 100);
+        reclaim();
+    }
+    return stop();
+}
     
     
 
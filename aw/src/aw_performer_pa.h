@@ -2,6 +2,10 @@
 #define _AW_PAC_PERFORMER_H_
 
 #include <iostream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
 #include "portaudio.h"
 
 #include "aw_generator.h"
@@ -12,18 +16,76 @@ namespace aw {
 
     namespace c_pa { // c tools for c port audio
         
-    //! Storage for callback
+    //! Storage for callback. The callback only reads Gens through raw pointers; the GenPtrs that own them are held by the PAPerformer, and released on the control thread.
     struct PACBData {
-        GenPtr root_gen;
+        Gen* root_gen {nullptr};
         // times the buffer size
         RenderCountT pre_roll_render_max;
         RenderCountT pre_roll_render_count;
         RenderCountT render_count;
         RenderCountT channels;
+        //! Optional queue of graph changes, drained before each render.
+        CommandQueuePtr command_queue;
+
+        //! A new root published by the control thread; taken by the callback at the next block boundary. The fields below are written before publishing.
+        std::atomic<Gen*> pending_gen {nullptr};
+        RenderCountT pending_render_count {0};
+        FrameSizeT pending_fade_size {0};
+
+        //! The incoming root, while crossfading; render thread only.
+        Gen* incoming_gen {nullptr};
+        RenderCountT incoming_render_count {0};
+        FrameSizeT fade_size {0};
+        FrameSizeT fade_pos {0};
+
+        //! The previous root, once no longer rendered; set by the callback, cleared by the control thread when released.
+        std::atomic<Gen*> retired_gen {nullptr};
+
+        //! The number of channels opened on the device, the root output read for each, and a pointer to the samples of each for the current block; sized at start.
+        PIndexT device_channels {2};
+        std::vector<PIndexT> channel_map;
+        std::vector<const SampleT*> sources;
+
+        //! If false, the device is opened with paNonInterleaved and each channel is written to its own buffer.
+        bool interleaved {true};
+
+        //! Storage for the crossfade of two roots; sized at start.
+        VVSampleT mix;
+
+        //! When rendering ahead, blocks rendered by the producer thread, in the device layout (interleaved, or one channel after another); otherwise nullptr, and the callback renders.
+        SPSCRing<std::vector<float>>* ahead_ring {nullptr};
+
+        //! The graph frame size; device buffers may be of any other size.
+        FrameSizeT frame_size {0};
+        //! A FIFO of one graph block, in the device layout, rendered or taken from ahead_ring when exhausted; block_pos is the next frame to be read. Callback only.
+        std::vector<float> block;
+        FrameSizeT block_pos {0};
+        //! Destinations in block for each channel; reset whenever the block storage changes.
+        std::vector<float*> block_out;
+        //! Number of callbacks that found no rendered block for some or all of their frames, and output silence for those frames; a callback is counted once, however many FIFO blocks it lacked.
+        std::atomic<std::uint64_t> underrun_count {0};
     };
+
+    //! Render a block of the root (and, while crossfading, of the incoming root), returning the outputs to read from: those of the root, or the crossfade mix.
+    inline const VVSampleT& pacb_render_gens(PACBData* data);
+
+    //! Render a block and write it, converted to float, in the device layout: interleaved into out[0], or each channel into out[channel].
+    void pacb_render_block(PACBData* data, float* const* out,
+            unsigned long framesPerBuffer);
+        
+    //! Fill the FIFO block with the next block rendered ahead, or silence if none is available; returns false for silence.
+    bool pacb_take_ahead(PACBData* data);
+
+    //! Serve framesPerBuffer frames to out in the device layout from the FIFO block, rendering or taking whole graph blocks as needed. When the device buffer matches the graph frame size and the FIFO is empty, the callback renders straight into out.
+    void pacb_serve(PACBData* data, float* const* out,
+            unsigned long framesPerBuffer);
+
+    //! Write silence in the device layout.
+    void pacb_silence(PACBData* data, float* const* out,
+            unsigned long framesPerBuffer);
         
-    //! Callback routines
-    int pacb_render_mono(
+    //! Callback routines: for a device opened with interleaved channels, and with paNonInterleaved.
+    int pacb_render_interleaved(
                        const void *inputBuffer,
                        void *outputBuffer,
                        unsigned long framesPerBuffer,
@@ -32,7 +94,7 @@ namespace aw {
                        void* userData
                        );
 
-    int pacb_render_stereo(
+    int pacb_render_non_interleaved(
                          const void *inputBuffer,
                          void *outputBuffer,
                          unsigned long framesPerBuffer,
@@ -62,6 +124,42 @@ class PAPerformer {
 
     //! This is the number of seconds of pre-roll silence before the root generator is called.
     unsigned int _pre_roll_seconds {2};
+
+    //! Owners of the Gens used by the callback: the current root, and a root published but not yet fully taken by the callback.
+    GenPtr _root;
+    GenPtr _incoming;
+
+    //! Guards _root and _incoming between control threads; never taken by the callback.
+    std::mutex _control_mutex;
+
+    //! The open stream, or nullptr.
+    PaStream* _stream {nullptr};
+
+    //! The number of blocks rendered ahead by a producer thread; if zero, the callback renders.
+    std::size_t _render_ahead {0};
+
+    //! Ring of rendered blocks, and the producer thread filling it.
+    std::unique_ptr<SPSCRing<std::vector<float>>> _ahead_ring;
+    std::thread _producer;
+    std::atomic<bool> _producing {false};
+
+    //! Frames per device buffer requested of PortAudio; zero lets the host choose, possibly varying.
+    unsigned long _device_frames;
+
+    //! The sample at which performances start.
+    SampleTimeT _start {0};
+
+    //! Device channel to root output mapping requested with set_channel_map(); if empty, a default is used.
+    std::vector<PIndexT> _channel_map;
+
+    //! The producer thread loop.
+    void _produce();
+
+    //! Report a PortAudio error, terminate, and return the error.
+    PaError _error(PaError err);
+
+    //! Release the previous root if the callback has retired it. Must hold _control_mutex.
+    void _reclaim();
     
     public://------------------------------------------------------------------
 
@@ -69,8 +167,57 @@ class PAPerformer {
 
     //! Pass in a GenPtr on creation
     PAPerformer(GenPtr g);
+
+    ~PAPerformer();
+
+    //! Open and start the stream; returns immediately. The first render of the root is render count 1, after the pre-roll.
+    PaError start();
+
+    //! Stop and close the stream, if started.
+    PaError stop();
+
+    //! Return true if the stream is started.
+    bool is_active() const {return _stream != nullptr;};
+
+    //! Replace the root Gen while playing, without stopping the stream. The new Gen is first warmed here, on the calling thread, by rendering warm_frames frames; it is then published, and the callback switches to it at the next block boundary, crossfading over fade_size samples (rounded up to whole frames) if greater than zero. The previous root is released on a control thread (in this or a later call, or while operator() waits). Returns false if a previous swap has not yet completed. The Gen must have the same number of outputs as the current root.
+    bool swap_root(GenPtr g, FrameSizeT fade_size=0,
+            RenderCountT warm_frames=1);
+
+    //! Release the previous root if the callback has finished with it; returns true if a swap is still in progress. Call periodically from a control thread when using start() and stop().
+    bool reclaim();
+
+    //! Return the current root (or the root being crossfaded to).
+    GenPtr get_root();
+
+    //! Start performances at sample t, rounded down to a whole frame. The root is moved there with Gen::seek() when the stream is started, analytically if possible, which otherwise renders all earlier frames before the stream opens. Takes effect on the next start().
+    void set_start(SampleTimeT t) {_start = t;};
+
+    //! Set the number of blocks to render ahead of the callback on a dedicated thread. If zero (the default), the graph renders in the callback. A greater depth tolerates longer render spikes at the cost of depth times the frame size of latency. Takes effect on the next start().
+    void set_render_ahead(std::size_t blocks) {_render_ahead = blocks;};
+
+    //! Return the number of blocks rendered ahead.
+    std::size_t get_render_ahead() const {return _render_ahead;};
+
+    //! Return the number of callbacks since start() that had no rendered block available and output silence for some or all of their frames. A callback is counted once, even when its device buffer spans several graph blocks. Only counted when rendering ahead.
+    std::uint64_t get_underrun_count() const {
+            return _cb_data.underrun_count.load();};
+    
+    //! Map root outputs to device channels: the device is opened with map.size() channels, and device channel n plays root output map[n]. By default each root output is played on the device channel of the same index, and a single output is played on two channels. Takes effect on the next start().
+    void set_channel_map(const std::vector<PIndexT>& map);
+
+    //! Set the number of frames per device buffer, independent of the graph frame size; a FIFO between the two renders whole graph blocks as needed. Zero lets the host API choose (paFramesPerBufferUnspecified), and the buffer size may then vary. Defaults to the common frame size. Takes effect on the next start().
+    void set_device_frames(unsigned long frames) {_device_frames = frames;};
+
+    //! Return the most frames by which the FIFO between device buffers and graph blocks can delay output: zero when device buffers are a multiple of the frame size, otherwise the frame size less the greatest common divisor of the two (or less one, if the device buffer size is not fixed).
+    FrameSizeT get_adapter_latency() const;
+
+    //! If false, open the device with paNonInterleaved, writing each channel directly to its own device buffer without interleaving. Takes effect on the next start().
+    void set_interleaved(bool v) {_cb_data.interleaved = v;};
     
-    //! Call with the duration of the performance in seconds.
+    //! Set a CommandQueue through which another thread can change the graph while performing; it is drained at each block boundary in the callback.
+    void set_command_queue(CommandQueuePtr q) {_cb_data.command_queue = q;};
+
+    //! Call with the duration of the performance in seconds. This starts the stream, waits (periodically releasing swapped roots), and stops the stream.
     int operator()(int dur);
 
 };
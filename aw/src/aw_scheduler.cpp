@@ -0,0 +1,298 @@
+#include <stdexcept>
+#include <sstream>
+
+#include "aw_scheduler.h"
+
+
+namespace aw {
+
+//-----------------------------------------------------------------------------
+// static members passed by reference need a definition
+const UINT8 Scheduler :: _level_bits;
+const std::size_t Scheduler :: _slot_count;
+const SampleTimeT Scheduler :: _slot_mask;
+const UINT8 Scheduler :: _level_count;
+const std::int32_t Scheduler :: _none;
+
+Scheduler :: Scheduler(EnvPtr e, std::size_t capacity,
+        std::size_t post_capacity)
+    : _environment{e},
+    _frame_size{e->get_common_frame_size()},
+    _inbox{post_capacity} {
+    if (capacity < 1 || post_capacity < 1) {
+        std::stringstream msg;
+        msg << "capacity and post capacity must be greater than 0"
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    // all storage is allocated here, never while scheduling or delivering
+    _pool.resize(capacity);
+    _heads.resize(_level_count * _slot_count, _none);
+    _tails.resize(_level_count * _slot_count, _none);
+    _level_pending.resize(_level_count + 1, 0);
+    reset();
+}
+
+SchedulerPtr Scheduler :: get_env_scheduler(EnvPtr e) {
+    // held weakly, such that neither the Env nor the scheduler is kept alive here; while a scheduler lives it holds its Env, so the address cannot be reused
+    static std::map<const Env*, std::weak_ptr<Scheduler>> schedulers;
+    static std::mutex schedulers_mutex;
+    std::lock_guard<std::mutex> lock(schedulers_mutex);
+    SchedulerPtr s = schedulers[e.get()].lock();
+    if (s == nullptr) {
+        s = SchedulerPtr(new Scheduler(e));
+        schedulers[e.get()] = s;
+    }
+    return s;
+}
+
+void Scheduler :: reset() {
+    std::fill(_heads.begin(), _heads.end(), _none);
+    std::fill(_tails.begin(), _tails.end(), _none);
+    std::fill(_level_pending.begin(), _level_pending.end(), 0);
+    _overflow_head = _none;
+    _overflow_tail = _none;
+    // link all events into the free list
+    std::int32_t count = static_cast<std::int32_t>(_pool.size());
+    for (std::int32_t i=0; i < count; ++i) {
+        _pool[i].next = i + 1 < count ? i + 1 : _none;
+    }
+    _free = 0;
+    _pending = 0;
+    _now = 0;
+    _dropped = 0;
+    while (_inbox.pop(_received)) {}
+}
+
+PIndexT Scheduler :: add_target(GenPtr g, PIndexT i, SampleT v) {
+    GenPtr c = Gen::make_with_environment(GenID::Constant, _environment);
+    c->set_input_by_index(0, v);
+    g->set_input_by_index(i, c); // will throw if i is not available
+    _target_gens.push_back(c);
+    // we know this is a Constant, as we just created it
+    _targets.push_back(static_cast<Constant*>(c.get()));
+    return _targets.size() - 1;
+}
+
+GenPtr Scheduler :: get_target_gen(PIndexT target) const {
+    if (target >= _target_gens.size()) {
+        std::stringstream msg;
+        msg << "target index is not available: " << target
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    return _target_gens[target];
+}
+
+void Scheduler :: _append(std::int32_t& head, std::int32_t& tail,
+        std::int32_t e) {
+    _pool[e].next = _none;
+    if (tail == _none) {
+        head = e;
+    }
+    else {
+        _pool[tail].next = e;
+    }
+    tail = e;
+}
+
+void Scheduler :: _insert(std::int32_t e) {
+    // events in the past are due now
+    SampleTimeT t = _pool[e].time < _now ? _now : _pool[e].time;
+    SampleTimeT delta = t - _now;
+    // the level is the number of whole bytes of distance; each level spans 256 times the previous
+    UINT8 level {0};
+    while (level < _level_count &&
+            (delta >> (_level_bits * (level + 1))) != 0) {
+        ++level;
+    }
+    ++_level_pending[level];
+    if (level >= _level_count) {
+        _append(_overflow_head, _overflow_tail, e);
+        return;
+    }
+    std::size_t slot = (level * _slot_count) +
+            ((t >> (_level_bits * level)) & _slot_mask);
+    _append(_heads[slot], _tails[slot], e);
+}
+
+void Scheduler :: _cascade(UINT8 level) {
+    std::int32_t e;
+    std::int32_t next;
+    if (level >= _level_count) {
+        e = _overflow_head;
+        _overflow_head = _none;
+        _overflow_tail = _none;
+    }
+    else {
+        std::size_t slot = (level * _slot_count) +
+                ((_now >> (_level_bits * level)) & _slot_mask);
+        e = _heads[slot];
+        _heads[slot] = _none;
+        _tails[slot] = _none;
+    }
+    // relative to _now, all of these are now closer, and go to lower levels
+    while (e != _none) {
+        next = _pool[e].next;
+        --_level_pending[level];
+        _insert(e);
+        e = next;
+    }
+}
+
+SampleTimeT Scheduler :: _next_time(SampleTimeT limit) const {
+    SampleTimeT next = limit;
+    SampleTimeT t;
+    UINT8 shift;
+    for (UINT8 level=0; level < _level_count; ++level) {
+        if (_level_pending[level] == 0) continue;
+        shift = _level_bits * level;
+        // the first boundary of this level after _now; at level 0, every sample is a boundary
+        t = ((_now >> shift) + 1) << shift;
+        // the slots of the boundaries in one rotation are each reached once
+        for (std::size_t i=0; i < _slot_count && t < next; ++i) {
+            if (_heads[(level * _slot_count) +
+                    ((t >> shift) & _slot_mask)] != _none) {
+                next = t;
+                break;
+            }
+            t += SampleTimeT(1) << shift;
+        }
+    }
+    if (_overflow_head != _none) {
+        shift = _level_bits * _level_count;
+        t = ((_now >> shift) + 1) << shift;
+        if (t < next) next = t;
+    }
+    return next;
+}
+
+bool Scheduler :: _schedule(SampleTimeT t, PIndexT target,
+        EventKind kind, SampleT v) {
+    if (_free == _none || target >= _targets.size()) {
+        return false;
+    }
+    std::int32_t e = _free;
+    _free = _pool[e].next;
+    _pool[e].time = t;
+    _pool[e].value = v;
+    _pool[e].target = target;
+    _pool[e].kind = kind;
+    _insert(e);
+    ++_pending;
+    return true;
+}
+
+void Scheduler :: _receive() {
+    while (_inbox.pop(_received)) {
+        if (!_schedule(_received.time, _received.target,
+                _received.kind, _received.value)) {
+            ++_dropped;
+        }
+    }
+}
+
+bool Scheduler :: _post(SampleTimeT t, PIndexT target, EventKind kind,
+        SampleT v) {
+    // targets are only added on the control thread, before rendering
+    if (target >= _targets.size()) {
+        std::stringstream msg;
+        msg << "target index is not available: " << target
+                << str_file_line(__FILE__, __LINE__);
+        throw std::invalid_argument(msg.str());
+    }
+    Event ev;
+    ev.time = t;
+    ev.value = v;
+    ev.target = target;
+    ev.kind = kind;
+    ev.next = _none;
+    return _inbox.push(ev);
+}
+
+bool Scheduler :: post_value(SampleTimeT t, PIndexT target, SampleT v) {
+    return _post(t, target, Value, v);
+}
+
+bool Scheduler :: post_trigger(SampleTimeT t, PIndexT target) {
+    return _post(t, target, Trigger, 1);
+}
+
+bool Scheduler :: schedule_value(SampleTimeT t, PIndexT target,
+        SampleT v) {
+    return _schedule(t, target, Value, v);
+}
+
+bool Scheduler :: schedule_trigger(SampleTimeT t, PIndexT target) {
+    return _schedule(t, target, Trigger, 1);
+}
+
+void Scheduler :: _deliver(const Event& ev, RenderCountT f,
+        FrameSizeT offset) {
+    if (ev.kind == Value) {
+        _targets[ev.target]->set_value_at(f, offset, ev.value);
+    }
+    else {
+        _targets[ev.target]->set_trigger_at(f, offset);
+    }
+}
+
+void Scheduler :: deliver(RenderCountT f) {
+    if (f == 0) return; // render count 0 is never rendered
+    _receive();
+    SampleTimeT block_start = (f - 1) * _frame_size;
+    SampleTimeT block_end = f * _frame_size;
+    if (_pending == 0 || block_end <= _now) {
+        // nothing to move; without pending events the wheel is empty
+        if (block_end > _now) _now = block_end;
+        return;
+    }
+    std::size_t slot;
+    std::int32_t e;
+    std::int32_t next;
+    UINT8 level;
+
+    // _now is before block_end; each step visits a sample that delivers or cascades
+    while (true) {
+        // at each boundary of a level, bring down its next slot; higher levels first
+        if ((_now & _slot_mask) == 0) {
+            for (level=_level_count; level > 0; --level) {
+                if ((_now & ((SampleTimeT(1) <<
+                        (_level_bits * level)) - 1)) == 0) {
+                    _cascade(level);
+                }
+            }
+        }
+        slot = _now & _slot_mask; // level 0
+        e = _heads[slot];
+        _heads[slot] = _none;
+        _tails[slot] = _none;
+        while (e != _none) {
+            next = _pool[e].next;
+            // events from skipped frames are delivered at the start
+            _deliver(_pool[e], f,
+                    _now < block_start ? 0 : _now - block_start);
+            // return to free list
+            _pool[e].next = _free;
+            _free = e;
+            --_pending;
+            --_level_pending[0];
+            e = next;
+        }
+        if (_pending == 0) {
+            _now = block_end;
+            break;
+        }
+        // skip empty slots, and the cascades of empty slots
+        _now = _next_time(block_end);
+        if (_now >= block_end) break;
+    }
+}
+
+void Scheduler :: render(GenPtr root, RenderCountT f) {
+    deliver(f);
+    root->render(f);
+}
+
+
+} // end namespace aw
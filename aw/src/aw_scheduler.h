@@ -0,0 +1,173 @@
+#ifndef _AW_SCHEDULER_H_
+#define _AW_SCHEDULER_H_
+
+#include <vector>
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include "aw_common.h"
+#include "aw_generator.h"
+
+
+namespace aw {
+
+//=============================================================================
+//! A sample-accurate event scheduler for control changes. Events are keyed by absolute sample time (SampleTimeT) and stored in a hierarchical timing wheel, giving O(1) insertion. Each block, deliver() moves the events that fall in that block into target Constants at their exact sample offsets; a Gen reading that Constant sees the change at the sample requested, as if the render loop were split at the event. Events are drawn from a pool preallocated at creation; neither scheduling nor delivery allocates. The wheel is not protected by a lock: schedule_value(), schedule_trigger(), deliver(), and reset() must all be called from the render thread. Another (control) thread schedules with post_value() and post_trigger(), which pass events through a wait-free SPSCRing (as CommandQueue passes graph changes) that deliver() moves into the wheel at each block boundary. The scheduler is scoped to an Env, from which it takes the frame size; get_env_scheduler() returns a scheduler shared by everything that renders with an Env.
+class Scheduler;
+typedef std::shared_ptr<Scheduler> SchedulerPtr;
+class Scheduler {
+
+    public://-------------------------------------------------------------------
+
+    //! The kind of an event.
+    enum EventKind {
+        Value, // change the value from this sample on
+        Trigger // a single sample trigger
+    };
+
+    private://-----------------------------------------------------------------
+
+    //! An event node, linked by index into a slot list or the free list.
+    struct Event {
+        SampleTimeT time;
+        SampleT value;
+        PIndexT target;
+        EventKind kind;
+        std::int32_t next;
+    };
+
+    //! The number of bits per wheel level; each level has 2^bits slots.
+    static const UINT8 _level_bits {8};
+    static const std::size_t _slot_count {1 << _level_bits};
+    static const SampleTimeT _slot_mask {_slot_count - 1};
+    //! Four levels cover 2^32 samples (about 27 hours at 44.1k) ahead of now; anything further is held in an overflow list.
+    static const UINT8 _level_count {4};
+
+    //! Marker for an empty list.
+    static const std::int32_t _none {-1};
+
+    EnvPtr _environment;
+
+    FrameSizeT _frame_size;
+
+    //! Preallocated pool of events.
+    std::vector<Event> _pool;
+
+    //! Head of the list of unused events in the pool.
+    std::int32_t _free;
+
+    //! Number of events scheduled and not yet delivered.
+    std::size_t _pending;
+
+    //! For each level and slot, the head and tail of a list of events; the tail permits appending such that events at the same time are delivered in the order scheduled.
+    std::vector<std::int32_t> _heads;
+    std::vector<std::int32_t> _tails;
+
+    //! For each level, and then the overflow list, the number of events held; levels without events are not searched.
+    std::vector<std::size_t> _level_pending;
+
+    //! Events posted by the control thread, not yet placed in the wheel.
+    SPSCRing<Event> _inbox;
+
+    //! Render thread: an event taken from _inbox.
+    Event _received;
+
+    //! Render thread: number of posted events discarded because the pool was exhausted.
+    std::size_t _dropped;
+
+    //! Events more than 2^32 samples ahead.
+    std::int32_t _overflow_head;
+    std::int32_t _overflow_tail;
+
+    //! The next sample time to be processed.
+    SampleTimeT _now;
+
+    //! Registered targets: Constants, with raw pointers for delivery. The GenPtrs in _target_gens keep them alive.
+    Gen::VGenPtr _target_gens;
+    std::vector<Constant*> _targets;
+
+    //! Append an event to a list.
+    inline void _append(std::int32_t& head, std::int32_t& tail,
+            std::int32_t e);
+
+    //! Place an event in the wheel relative to _now.
+    void _insert(std::int32_t e);
+
+    //! Move the events of a slot at a level into lower levels, relative to _now.
+    void _cascade(UINT8 level);
+
+    //! Return the next sample time after _now at which a level 0 slot holds events or a slot with events is cascaded, or limit if there is none before it. Each level searches at most one rotation of its slots.
+    SampleTimeT _next_time(SampleTimeT limit) const;
+
+    //! Deliver an event to its target at the offset within the frame of render count f.
+    inline void _deliver(const Event& ev, RenderCountT f, FrameSizeT offset);
+
+    //! Render thread: move posted events into the wheel.
+    void _receive();
+
+    //! Shared implementation of post_value() and post_trigger().
+    bool _post(SampleTimeT t, PIndexT target, EventKind kind, SampleT v);
+
+    //! Shared implementation of schedule_value() and schedule_trigger().
+    bool _schedule(SampleTimeT t, PIndexT target, EventKind kind,
+            SampleT v);
+
+    public://------------------------------------------------------------------
+
+    Scheduler() = delete;
+
+    //! Create a scheduler for an Env, with a pool of capacity events; up to post_capacity events can be posted from the control thread between blocks.
+    explicit Scheduler(EnvPtr e, std::size_t capacity=4096,
+            std::size_t post_capacity=256);
+
+    //! Return the scheduler of an Env, created with default capacities on first use and shared by all callers until none holds it. This allocates and must be called from the control thread.
+    static SchedulerPtr get_env_scheduler(EnvPtr e);
+
+    //! Register an input of a Gen as a target for events. The input is replaced by a single Constant with the value v; the returned index is used when scheduling. This allocates and must be called from the control thread before rendering.
+    PIndexT add_target(GenPtr g, PIndexT i, SampleT v=0);
+
+    //! Return the Constant used for a target.
+    GenPtr get_target_gen(PIndexT target) const;
+
+    // render thread ..........................................................
+    //! Schedule a value change on a target at absolute sample time t. Events in the past are delivered at the start of the next block. Returns false if the pool is exhausted. Does not allocate.
+    bool schedule_value(SampleTimeT t, PIndexT target, SampleT v);
+
+    //! Schedule a trigger on a target at absolute sample time t. Returns false if the pool is exhausted. Does not allocate.
+    bool schedule_trigger(SampleTimeT t, PIndexT target);
+
+    //! Deliver all events falling within the frame of render count f (samples (f-1) * frame size up to f * frame size); this must be called before rendering f. Empty slots are skipped, such that a gap of skipped frames (as after seeking) costs at most a rotation of each level rather than a step for each sample. Does not allocate.
+    void deliver(RenderCountT f);
+
+    //! Deliver events for f and then render the root Gen for f.
+    void render(GenPtr root, RenderCountT f);
+
+    //! Discard all pending and posted events and return to sample time zero.
+    void reset();
+
+    //! Return the number of posted events discarded because the pool was exhausted when they were received.
+    std::size_t get_dropped() const {return _dropped;};
+
+    // control thread .........................................................
+    //! Post a value change on a target at absolute sample time t, to be scheduled at the next call to deliver(). Throws if the target is not available; returns false if post_capacity events are already waiting. Does not allocate.
+    bool post_value(SampleTimeT t, PIndexT target, SampleT v);
+
+    //! Post a trigger on a target at absolute sample time t.
+    bool post_trigger(SampleTimeT t, PIndexT target);
+
+    //! Return the number of events not yet delivered.
+    std::size_t get_pending() const {return _pending;};
+
+    //! Return the number of events that can still be scheduled.
+    std::size_t get_available() const {return _pool.size() - _pending;};
+
+    //! Return the next sample time to be processed.
+    SampleTimeT get_now() const {return _now;};
+
+};
+
+
+} // end namespace aw
+
+#endif // ends _AW_SCHEDULER_H_
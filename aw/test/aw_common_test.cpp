@@ -1,4 +1,4 @@
-// g++-4.7 -std=c++11 -I ../src aw_common_test.cpp ../src/aw_common.cpp -DSTAND_ALONE -l boost_filesystem -l boost_system -l boost_unit_test_framework -Wall -o aw_common_test
+// g++-4.7 -std=c++11 -I ../src aw_common_test.cpp ../src/aw_common.cpp -DSTAND_ALONE -l boost_filesystem -l boost_system -l boost_unit_test_framework -pthread -Wall -o aw_common_test
 
 // clang++ -I ../src aw_common_test.cpp ../src/aw_common.cpp -DSTAND_ALONE -l boost_filesystem -l boost_system -l boost_unit_test_framework -Wall -o aw_common_test
 
@@ -22,6 +22,8 @@
 #include <iostream>
 #include <string>
 #include <list>
+#include <thread>
+#include <chrono>
 
 #include "aw_common.h"
 
@@ -280,3 +282,291 @@ BOOST_AUTO_TEST_CASE(aw_random_b) {
 
 
 
+
+
+BOOST_AUTO_TEST_CASE(aw_spsc_ring_a) {
+
+    SPSCRing<VSampleT> r(3);
+    BOOST_CHECK_EQUAL(r.capacity(), 3);
+    BOOST_CHECK_EQUAL(r.size(), 0);
+
+    VSampleT v;
+    BOOST_CHECK_EQUAL(r.pop(v), false);
+
+    for (int i=0; i<3; ++i) {
+        v = {SampleT(i), SampleT(i)};
+        BOOST_CHECK_EQUAL(r.push(v), true);
+        // exchanged with empty storage
+        BOOST_CHECK_EQUAL(v.size(), 0);
+    }
+    v = {9};
+    BOOST_CHECK_EQUAL(r.push(v), false);
+    BOOST_CHECK_EQUAL(v.size(), 1);
+    BOOST_CHECK_EQUAL(r.size(), 3);
+
+    // first in first out, wrapping around the storage
+    for (int i=0; i<3; ++i) {
+        BOOST_CHECK_EQUAL(r.pop(v), true);
+        BOOST_CHECK_EQUAL(v[0], i);
+        v = {SampleT(i + 3)};
+        BOOST_CHECK_EQUAL(r.push(v), true);
+    }
+    BOOST_CHECK_EQUAL(r.pop(v), true);
+    BOOST_CHECK_EQUAL(v[0], 3);
+    BOOST_CHECK_EQUAL(r.size(), 2);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_spsc_ring_b) {
+    // sized storage circulates between two threads without changing size
+
+    std::vector<float> block(8, 0);
+    SPSCRing<std::vector<float>> r(4, block);
+    const int count {5000};
+    std::thread producer([&](){
+        std::vector<float> b(8, 0);
+        int i {0};
+        while (i < count) {
+            b[0] = i;
+            if (r.push(b)) {
+                ++i;
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    int received {0};
+    bool ordered {true};
+    bool sized {true};
+    while (received < count) {
+        if (r.pop(block)) {
+            if (block[0] != received) ordered = false;
+            if (block.size() != 8) sized = false;
+            ++received;
+        }
+    }
+    producer.join();
+    BOOST_CHECK(ordered);
+    BOOST_CHECK(sized);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_polyphase_resampler_a) {
+    // tones convert accurately at each quality, through the filter bank and the interpolated path
+    std::vector<ResampleQuality> qs {ResampleQuality::Low,
+            ResampleQuality::Medium, ResampleQuality::High};
+    std::vector<SampleT> tols {2e-3, 1e-4, 1e-5};
+    // the last ratio has too many phases for a bank
+    std::vector<std::pair<OutputsSizeT, OutputsSizeT>> rates {
+            {48000, 44100}, {22050, 44100}, {44100, 44101}};
+    for (std::size_t k=0; k < qs.size(); ++k) {
+        PolyphaseResampler r(qs[k]);
+        for (auto rate : rates) {
+            OutputsSizeT n = rate.first / 2;
+            VSampleT src(n, 0);
+            for (OutputsSizeT i=0; i < n; ++i) {
+                src[i] = std::sin(PI2 * 1000 * i / rate.first);
+            }
+            VSampleT dst;
+            r.convert(src.data(), n, rate.first, rate.second, dst);
+            BOOST_CHECK_EQUAL(dst.size(), PolyphaseResampler::get_output_size(
+                    n, rate.first, rate.second));
+            SampleT diff {0};
+            // away from the edges
+            for (std::size_t m=1000; m < dst.size() - 1000; ++m) {
+                diff = std::max(diff, std::abs(dst[m] -
+                        std::sin(PI2 * 1000 * m / rate.second)));
+            }
+            BOOST_CHECK_SMALL(diff, tols[k]);
+        }
+        // lowering the rate removes frequencies above the new Nyquist
+        VSampleT src(22050, 0);
+        for (std::size_t i=0; i < src.size(); ++i) {
+            src[i] = std::sin(PI2 * 15000 * i / 44100);
+        }
+        VSampleT dst;
+        r.convert(src.data(), src.size(), 44100, 22050, dst);
+        SampleT peak {0};
+        for (std::size_t m=1000; m < dst.size() - 1000; ++m) {
+            peak = std::max(peak, std::abs(dst[m]));
+        }
+        BOOST_CHECK_SMALL(peak, tols[k]);
+    }
+    BOOST_CHECK_EQUAL(PolyphaseResampler::get_output_size(48000, 48000,
+            44100), 44100);
+    PolyphaseResampler r;
+    VSampleT dst;
+    BOOST_REQUIRE_THROW(r.convert(nullptr, 0, 0, 44100, dst),
+            std::invalid_argument);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_io_pool_a) {
+    // tasks run concurrently, returning values or exceptions through futures
+    IOPool p(4);
+    BOOST_CHECK_EQUAL(p.get_thread_count(), 4);
+    std::atomic<int> running {0};
+    std::atomic<int> most {0};
+    std::vector<std::future<int>> results;
+    for (int i=0; i < 8; ++i) {
+        results.push_back(p.submit([i, &running, &most](){
+            int n = running.fetch_add(1) + 1;
+            int m = most.load();
+            while (n > m && !most.compare_exchange_weak(m, n)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            running.fetch_sub(1);
+            return i * i;
+        }));
+    }
+    for (int i=0; i < 8; ++i) {
+        BOOST_CHECK_EQUAL(results[i].get(), i * i);
+    }
+    BOOST_CHECK(most.load() > 1);
+    BOOST_CHECK(most.load() <= 4);
+
+    std::future<void> f = p.submit([](){
+        throw std::invalid_argument("bad");
+    });
+    BOOST_REQUIRE_THROW(f.get(), std::invalid_argument);
+
+    // the Env pool is shared
+    EnvPtr e = Env::get_default_env();
+    BOOST_CHECK_EQUAL(&e->get_io_pool(), &e->get_io_pool());
+    BOOST_CHECK(e->get_io_pool().get_thread_count() >= 2);
+}
+
+BOOST_AUTO_TEST_CASE(aw_to_float_a) {
+    // odd sizes and channel counts cover both paired and remaining paths
+    VSampleT a {.5, -.25, 1, -1, .125, .75, 0};
+    std::vector<float> f(a.size(), 9);
+    to_float(a.data(), f.data(), a.size());
+    for (std::size_t i=0; i<a.size(); ++i) {
+        BOOST_CHECK_EQUAL(f[i], static_cast<float>(a[i]));
+    }
+
+    for (PIndexT channels=1; channels<6; ++channels) {
+        VVSampleT src(channels, VSampleT(7, 0));
+        std::vector<const SampleT*> ptrs;
+        for (PIndexT c=0; c<channels; ++c) {
+            for (FrameSizeT i=0; i<7; ++i) {
+                src[c][i] = c * 10 + i;
+            }
+            ptrs.push_back(src[c].data());
+        }
+        std::vector<float> dst(7 * channels, -1);
+        interleave_to_float(ptrs.data(), channels, dst.data(), 7);
+        bool match {true};
+        for (FrameSizeT i=0; i<7; ++i) {
+            for (PIndexT c=0; c<channels; ++c) {
+                if (dst[i * channels + c] != c * 10 + i) match = false;
+            }
+        }
+        BOOST_CHECK(match);
+    }
+
+    // the same source on two channels
+    std::vector<const SampleT*> mono {a.data(), a.data()};
+    std::vector<float> dst(a.size() * 2, 0);
+    interleave_to_float(mono.data(), 2, dst.data(), a.size());
+    BOOST_CHECK_EQUAL(dst[4], static_cast<float>(a[2]));
+    BOOST_CHECK_EQUAL(dst[5], static_cast<float>(a[2]));
+}
+
+BOOST_AUTO_TEST_CASE(aw_sin_samples_a) {
+    // an odd count covers both paired and remaining paths, which agree exactly
+    VSampleT a;
+    for (std::size_t i=0; i<1001; ++i) {
+        a.push_back(PI2 * i / 1001);
+    }
+    a.push_back(PI * .5);
+    a.push_back(PI);
+    a.push_back(PI * 1.5);
+    VSampleT b(a.size(), 9);
+    sin_samples(a.data(), b.data(), a.size());
+    SampleT diff {0};
+    for (std::size_t i=0; i<a.size(); ++i) {
+        diff = std::max(diff, std::fabs(b[i] - std::sin(a[i])));
+    }
+    BOOST_CHECK(diff < 1e-15);
+    // PI is folded to zero exactly
+    BOOST_CHECK_EQUAL(b[1002], 0);
+    BOOST_CHECK_CLOSE(b[1001], 1, 1e-12);
+    BOOST_CHECK_CLOSE(b[1003], -1, 1e-12);
+    // in place, and one at a time
+    VSampleT c(a);
+    sin_samples(c.data(), c.data(), c.size());
+    BOOST_CHECK(b == c);
+    for (std::size_t i=0; i<a.size(); ++i) {
+        sin_samples(a.data() + i, c.data() + i, 1);
+    }
+    BOOST_CHECK(b == c);
+}
+
+BOOST_AUTO_TEST_CASE(aw_map_samples_a) {
+    // boundaries in either order, clipping, and zero ranges
+    VSampleT src {.5, 2, -1, .25, .5, .75, .5};
+    VSampleT src_lower {0, 0, 0, 1, 0, .5, 0};
+    VSampleT src_upper {1, 1, 1, 0, 0, .5, 1};
+    VSampleT dst_lower {10, 10, 10, 10, 10, 10, 20};
+    VSampleT dst_upper {20, 20, 20, 20, 20, 20, 10};
+    VSampleT dst(src.size(), 0);
+    map_samples(src.data(), src_lower.data(), src_upper.data(),
+            dst_lower.data(), dst_upper.data(), dst.data(), src.size());
+    VSampleT expected {15, 20, 10, 12.5, 10, 10, 15};
+    BOOST_CHECK(dst == expected);
+    // one at a time, without pairs
+    for (std::size_t i=0; i<src.size(); ++i) {
+        map_samples(src.data() + i, src_lower.data() + i,
+                src_upper.data() + i, dst_lower.data() + i,
+                dst_upper.data() + i, dst.data() + i, 1);
+    }
+    BOOST_CHECK(dst == expected);
+}
+
+BOOST_AUTO_TEST_CASE(aw_checked_outputs_size_a) {
+    // sizes beyond 32 bits are kept; products that overflow raise
+    BOOST_CHECK_EQUAL(checked_outputs_size(2, 64), 128);
+    BOOST_CHECK_EQUAL(checked_outputs_size(0, 64), 0);
+    BOOST_CHECK(sizeof(FrameSizeT) >= 8);
+    FrameSizeT days = static_cast<FrameSizeT>(44100) * 60 * 60 * 24 * 3;
+    BOOST_CHECK_EQUAL(checked_outputs_size(8, days),
+            static_cast<OutputsSizeT>(91445760000));
+    FrameSizeT big = std::numeric_limits<FrameSizeT>::max() / 2;
+    BOOST_REQUIRE_THROW(checked_outputs_size(3, big), std::domain_error);
+    BOOST_REQUIRE_THROW(checked_outputs_size(1,
+            std::numeric_limits<FrameSizeT>::max()), std::domain_error);
+}
+
+BOOST_AUTO_TEST_CASE(aw_encode_samples_a) {
+    // odd sizes cover both vector and remaining paths
+    VSampleT a {.5, -.25, 1, -1, .125, .75, 0, -.999, .3333};
+    BOOST_CHECK_EQUAL(get_sample_format_bytes(SampleFormat::PCM16), 2);
+    BOOST_CHECK_EQUAL(get_sample_format_bytes(SampleFormat::PCM24), 3);
+    BOOST_CHECK_EQUAL(get_sample_format_bytes(SampleFormat::Float32), 4);
+    BOOST_CHECK_EQUAL(get_sample_format_bytes(SampleFormat::Float64), 8);
+
+    std::vector<SampleFormat> formats {SampleFormat::PCM16,
+            SampleFormat::PCM24, SampleFormat::Float32, SampleFormat::Float64};
+    std::vector<SampleT> tolerance {1.0 / 32768, 1.0 / 8388608, 1e-7, 0};
+    for (std::size_t k=0; k<formats.size(); ++k) {
+        std::vector<UINT8> bytes(
+                a.size() * get_sample_format_bytes(formats[k]));
+        encode_samples(a.data(), bytes.data(), a.size(), formats[k]);
+        VSampleT b(a.size(), 9);
+        decode_samples(bytes.data(), b.data(), a.size(), formats[k]);
+        for (std::size_t i=0; i<a.size(); ++i) {
+            BOOST_CHECK(std::abs(a[i] - b[i]) <= tolerance[k]);
+            BOOST_CHECK_EQUAL(b[i], decode_sample(bytes.data(), i,
+                    formats[k]));
+        }
+    }
+    // integer formats clip
+    VSampleT c {2, -2};
+    std::vector<UINT8> bytes(4);
+    encode_samples(c.data(), bytes.data(), 2, SampleFormat::PCM16);
+    VSampleT d(2);
+    decode_samples(bytes.data(), d.data(), 2, SampleFormat::PCM16);
+    BOOST_CHECK_CLOSE(d[0], 32767.0 / 32768, .0001);
+    BOOST_CHECK_EQUAL(d[1], -1);
+}
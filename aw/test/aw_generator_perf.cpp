@@ -193,6 +193,329 @@ bool e() {
 }
 
 
+bool f() {
+    // throughput of conversion of a buffer, and of the streaming Gen, for each quality
+    std::vector<aw::ResampleQuality> qs {aw::ResampleQuality::Low,
+            aw::ResampleQuality::Medium, aw::ResampleQuality::High};
+    std::vector<std::string> names {"low", "medium", "high"};
+    aw::VSampleT src(48000 * 60, 0);
+    for (std::size_t i=0; i < src.size(); ++i) {
+        src[i] = std::sin(aw::PI2 * 1000 * i / 48000);
+    }
+    aw::VSampleT dst;
+    for (std::size_t k=0; k < qs.size(); ++k) {
+        aw::PolyphaseResampler r(qs[k]);
+        aw::Timer t1("convert 48000 to 44100, " + names[k]);
+        t1.start();
+        r.convert(src.data(), src.size(), 48000, 44100, dst);
+        std::cout << "total time for 60 seconds of audio: " << t1 << std::endl;
+
+        aw::GenPtr gbuf = aw::Gen::make(aw::GenID::SecondsBuffer);
+        gbuf->set_slot_by_index(1, 60);
+        aw::GenPtr g1 = aw::Gen::make(aw::GenID::Sine);
+        g1->set_input_by_index(0, 1000);
+        aw::GenPtr g2 = aw::Gen::make(aw::GenID::Resampler);
+        std::dynamic_pointer_cast<aw::Resampler>(g2)->set_quality(qs[k]);
+        g2->set_input_by_index(0, g1);
+        g2->set_input_by_index(1, 1.5);
+        gbuf->set_input_by_index(0, g2);
+        aw::Timer t2("streaming Resampler at a rate of 1.5, " + names[k]);
+        t2.start();
+        gbuf->render(1);
+        std::cout << "total time for 60 seconds of audio: " << t2 << std::endl;
+    }
+    return true;
+}
+
+
+bool g() {
+    // block loops that index with FrameSizeT and OutputsSizeT: recording into a buffer, and reading a buffer with a Sequencer
+    aw::GenPtr gbuf = aw::Gen::make(aw::GenID::SecondsBuffer);
+    gbuf->set_slot_by_index(0, 2);
+    gbuf->set_slot_by_index(1, 60);
+    aw::GenPtr g1 = aw::Gen::make(aw::GenID::Sine);
+    g1->set_input_by_index(0, 220);
+    gbuf->set_input_by_index(0, g1);
+    gbuf->set_input_by_index(1, g1);
+    aw::Timer t1("recording a stereo sine");
+    t1.start();
+    gbuf->render(1);
+    std::cout << "total time for 60 seconds of audio: " << t1 << std::endl;
+
+    aw::GenPtr gbuf2 = aw::Gen::make(aw::GenID::SecondsBuffer);
+    gbuf2->set_slot_by_index(0, 2);
+    gbuf2->set_slot_by_index(1, 60);
+    aw::GenPtr s1 = aw::Gen::make(aw::GenID::Sequencer);
+    s1->set_slot_by_index(0, gbuf);
+    aw::GenPtr c1 = aw::Gen::make(aw::GenID::Counter);
+    c1->set_input_by_index(0, 1);
+    s1->set_input_by_index(0, c1);
+    gbuf2->set_input_by_index(0, s1);
+    aw::Timer t2("sequencing a stereo buffer");
+    t2.start();
+    gbuf2->render(1);
+    std::cout << "total time for 60 seconds of audio: " << t2 << std::endl;
+    return true;
+}
+
+
+bool h() {
+    // an eight channel buffer of independent voices, filled jointly and at once
+    for (int k=0; k < 2; ++k) {
+        aw::SamplesBuffer::set_parallel_fill(k == 1);
+        aw::GenPtr gbuf = aw::Gen::make(aw::GenID::SecondsBuffer);
+        gbuf->set_slot_by_index(0, 8);
+        gbuf->set_slot_by_index(1, 60);
+        for (aw::PIndexT j=0; j < 8; ++j) {
+            aw::GenPtr g1 = aw::Gen::make(aw::GenID::Sine);
+            g1->set_input_by_index(0, 2);
+            aw::GenPtr g2 = aw::Gen::make(aw::GenID::Sine);
+            g2->set_input_by_index(0, g1 * 100 + 200 * (j + 1));
+            gbuf->set_input_by_index(j, g2);
+        }
+        aw::Timer t1(k == 1 ? "eight voices, parallel" : "eight voices, joint");
+        t1.start();
+        gbuf->render(1);
+        std::cout << "total time for 60 seconds of audio: " << t1 << std::endl;
+    }
+    return true;
+}
+
+
+bool i() {
+    // a buffer filled with inputs rendered at the common frame size, and at a larger block size
+    std::vector<aw::FrameSizeT> sizes {0, 1024, 4096, 16384};
+    for (aw::FrameSizeT bs : sizes) {
+        aw::SamplesBuffer::set_block_size(bs);
+        aw::GenPtr gbuf = aw::Gen::make(aw::GenID::SecondsBuffer);
+        gbuf->set_slot_by_index(1, 60);
+        aw::GenPtr g1 = aw::Gen::make(aw::GenID::Sine);
+        g1->set_input_by_index(0, 2);
+        aw::GenPtr g2 = aw::Gen::make(aw::GenID::Phasor);
+        g2->set_input_by_index(0, g1 * 100 + 200);
+        gbuf->set_input_by_index(0, g2 * .5 + .25);
+        aw::Timer t1("block size " + std::to_string(bs));
+        t1.start();
+        gbuf->render(1);
+        std::cout << "total time for 60 seconds of audio: " << t1 << std::endl;
+    }
+    aw::SamplesBuffer::set_block_size(4096);
+    return true;
+}
+
+
+bool j() {
+    // getting 60 seconds from a stereo root into planar buffers, by frame through a vector, and with render_range()
+    aw::RenderCountT count = 44100 * 60 / 64;
+    aw::VVSampleT planar(2, aw::VSampleT(count * 64, 0));
+    std::vector<aw::SampleT*> dst {planar[0].data(), planar[1].data()};
+    for (int k=0; k < 4; ++k) {
+        aw::GenPtr g1 = aw::Gen::make(aw::GenID::Phasor);
+        g1->set_input_by_index(0, 200);
+        if (k >= 2) {
+            // a deep network of about 200 Gens
+            for (int i=0; i < 100; ++i) {
+                g1 = g1 * .999 + .001;
+            }
+        }
+        aw::GenPtr g2 = aw::Gen::make(aw::GenID::Panner);
+        g2->set_input_by_index(0, g1);
+        g2->set_input_by_index(1, .3);
+        aw::Timer t1(std::string(k >= 2 ? "deep network, " : "") +
+                (k % 2 == 0 ? "render and write_outputs_to_vector" :
+                "render_range"));
+        t1.start();
+        if (k % 2 == 0) {
+            aw::VSampleT v;
+            for (aw::RenderCountT f=1; f <= count; ++f) {
+                g2->render(f);
+                g2->write_outputs_to_vector(v);
+                std::copy(v.begin(), v.begin() + 64,
+                        dst[0] + (f - 1) * 64);
+                std::copy(v.begin() + 64, v.end(), dst[1] + (f - 1) * 64);
+            }
+        }
+        else {
+            g2->render_range(1, count, dst.data(), 2);
+        }
+        std::cout << "total time for 60 seconds of audio: " << t1 << std::endl;
+    }
+    return true;
+}
+
+
+bool k() {
+    // cloning a voice of about 200 Gens, against building it again
+    auto build = []() {
+        aw::GenPtr lfo = aw::Gen::make(aw::GenID::Sine);
+        lfo->set_input_by_index(0, 3);
+        aw::GenPtr g = aw::Gen::make(aw::GenID::Sine);
+        g->set_input_by_index(0, 220);
+        for (int i=0; i < 66; ++i) {
+            g = g * .99 + lfo; // a Multiply, an Add, and a Constant
+        }
+        return g;
+    };
+    aw::GenPtr voice = build();
+    voice->render(1);
+    std::size_t count = 1000;
+    aw::Timer t1("build 1000 voices");
+    t1.start();
+    for (std::size_t i=0; i < count; ++i) {
+        aw::GenPtr v = build();
+    }
+    std::cout << t1 << std::endl;
+    aw::Timer t2("clone 1000 voices");
+    t2.start();
+    for (std::size_t i=0; i < count; ++i) {
+        aw::GenPtr v = voice->clone();
+    }
+    std::cout << t2 << std::endl;
+    return true;
+}
+
+
+bool l() {
+    // sixteen voices with a note every quarter second: summed by hand, each rendered every frame, and with a VoiceAllocator, rendering only sounding voices
+    std::size_t count = 16;
+    auto build = [](aw::GenPtr trig, aw::GenPtr val) {
+        aw::GenPtr env = aw::Gen::make(aw::GenID::AttackDecay);
+        env->set_input_by_index(0, trig);
+        env->set_input_by_index(1, .005);
+        env->set_input_by_index(2, .1);
+        aw::GenPtr osc = aw::Gen::make(aw::GenID::Sine);
+        osc->set_input_by_index(0, val);
+        return osc * env;
+    };
+    aw::RenderCountT frames = 44100 * 60 / 64;
+    aw::RenderCountT spacing = 44100 / 4 / 64;
+    for (int k=0; k < 2; ++k) {
+        std::vector<aw::ConstantPtr> trigs;
+        std::vector<aw::ConstantPtr> vals;
+        aw::GenPtr root;
+        if (k == 0) {
+            root = aw::Gen::make(aw::GenID::Add);
+            for (std::size_t i=0; i < count; ++i) {
+                trigs.push_back(std::dynamic_pointer_cast<aw::Constant>(
+                        aw::Gen::make(aw::GenID::Constant)));
+                vals.push_back(std::dynamic_pointer_cast<aw::Constant>(
+                        aw::Gen::make(aw::GenID::Constant)));
+                root->add_input_by_index(0, build(trigs[i], vals[i]));
+            }
+        }
+        else {
+            trigs.push_back(std::dynamic_pointer_cast<aw::Constant>(
+                    aw::Gen::make(aw::GenID::Constant)));
+            vals.push_back(std::dynamic_pointer_cast<aw::Constant>(
+                    aw::Gen::make(aw::GenID::Constant)));
+            aw::GenPtr trig = aw::Gen::make(aw::GenID::Constant);
+            aw::GenPtr val = aw::Gen::make(aw::GenID::Constant);
+            root = aw::Gen::make(aw::GenID::VoiceAllocator);
+            root->set_input_by_index(0, trigs[0]);
+            root->set_input_by_index(1, vals[0]);
+            std::dynamic_pointer_cast<aw::VoiceAllocator>(root)->set_voice(
+                    build(trig, val), trig, val, count);
+        }
+        aw::Timer t1(k == 0 ? "sixteen voices, summed" :
+                "sixteen voices, VoiceAllocator");
+        t1.start();
+        std::size_t note = 0;
+        for (aw::RenderCountT f=1; f <= frames; ++f) {
+            if (f % spacing == 0) {
+                std::size_t i = k == 0 ? note % count : 0;
+                vals[i]->set_value_at(f, 0, 200 + (note % 7) * 50);
+                trigs[i]->set_trigger_at(f, 0);
+                ++note;
+            }
+            root->render(f);
+        }
+        std::cout << "total time for 60 seconds of audio: " << t1 << std::endl;
+    }
+    return true;
+}
+
+
+bool m() {
+    // a 32 partial additive bank, as 32 Sines and as one Sine of 32 lanes, summed to one output
+    aw::VSampleT rates;
+    for (int i=1; i <= 32; ++i) {
+        rates.push_back(110 * i);
+    }
+    aw::RenderCountT frames = 44100 * 60 / 64;
+    for (int k=0; k < 2; ++k) {
+        aw::GenPtr mix = aw::Gen::make(aw::GenID::Add);
+        if (k == 0) {
+            for (auto r : rates) {
+                aw::GenPtr g = aw::Gen::make(aw::GenID::Sine);
+                g->set_input_by_index(0, r);
+                mix->add_input_by_index(0, g);
+            }
+        }
+        else {
+            aw::GenPtr g = aw::Gen::make(aw::GenID::Sine);
+            g->set_lane_count(rates.size());
+            g->set_input_by_index(0, aw::Gen::make_lanes(rates));
+            for (aw::PIndexT l=0; l < rates.size(); ++l) {
+                mix->add_input_by_index(0, g, l);
+            }
+        }
+        aw::Timer t1(k == 0 ? "32 Sines" : "one Sine of 32 lanes");
+        t1.start();
+        for (aw::RenderCountT f=1; f <= frames; ++f) {
+            mix->render(f);
+        }
+        std::cout << "total time for 60 seconds of audio: " << t1 << std::endl;
+    }
+    return true;
+}
+
+
+bool n() {
+    // 32 bipolar lanes mapped to 0 to 1, as 32 Maps and as one Map of 32 lanes, summed to one output
+    aw::VSampleT rates;
+    for (int i=1; i <= 32; ++i) {
+        rates.push_back(110 * i);
+    }
+    aw::RenderCountT frames = 44100 * 60 / 64;
+    for (int k=0; k < 2; ++k) {
+        aw::GenPtr mix = aw::Gen::make(aw::GenID::Add);
+        aw::GenPtr src = aw::Gen::make(aw::GenID::Sine);
+        src->set_lane_count(rates.size());
+        src->set_input_by_index(0, aw::Gen::make_lanes(rates));
+        if (k == 0) {
+            for (aw::PIndexT l=0; l < rates.size(); ++l) {
+                aw::GenPtr g = aw::Gen::make(aw::GenID::Map);
+                g->set_input_by_index(0, src, l);
+                g->set_input_by_index(1, -1);
+                g->set_input_by_index(2, 1);
+                g->set_input_by_index(3, 0);
+                g->set_input_by_index(4, 1);
+                mix->add_input_by_index(0, g);
+            }
+        }
+        else {
+            aw::GenPtr g = aw::Gen::make(aw::GenID::Map);
+            g->set_lane_count(rates.size());
+            g->set_input_by_index(0, src);
+            g->set_input_by_index(1, -1);
+            g->set_input_by_index(2, 1);
+            g->set_input_by_index(3, 0);
+            g->set_input_by_index(4, 1);
+            for (aw::PIndexT l=0; l < rates.size(); ++l) {
+                mix->add_input_by_index(0, g, l);
+            }
+        }
+        aw::Timer t1(k == 0 ? "32 Maps" : "one Map of 32 lanes");
+        t1.start();
+        for (aw::RenderCountT f=1; f <= frames; ++f) {
+            mix->render(f);
+        }
+        std::cout << "total time for 60 seconds of audio: " << t1 << std::endl;
+    }
+    return true;
+}
+
+
 int main() {
 
     assert(
@@ -200,7 +523,16 @@ int main() {
         b() &&
         c() &&
         d() &&
-        e() 
+        e() &&
+        f() &&
+        g() &&
+        h() &&
+        i() &&
+        j() &&
+        k() &&
+        l() &&
+        m() &&
+        n()
         );
     
 }
@@ -220,11 +552,84 @@ int main() {
 //total time for 60 second of audio: <Timer: mapping two sinewaves: 417.88 msec>
 
 
+// 20261019, resampling throughput, -O3, SSE2
+//total time for 60 seconds of audio: <Timer: convert 48000 to 44100, low: 59.851 msec>
+//total time for 60 seconds of audio: <Timer: streaming Resampler at a rate of 1.5, low: 417.09 msec>
+//total time for 60 seconds of audio: <Timer: convert 48000 to 44100, medium: 58.033 msec>
+//total time for 60 seconds of audio: <Timer: streaming Resampler at a rate of 1.5, medium: 837.365 msec>
+//total time for 60 seconds of audio: <Timer: convert 48000 to 44100, high: 87.035 msec>
+//total time for 60 seconds of audio: <Timer: streaming Resampler at a rate of 1.5, high: 1223.83 msec>
+
+
+
+
+
+
+
+
+
+
+
+// 20261019, 64 bit FrameSizeT and OutputsSizeT, -O3; three runs each, within the variance of runs
+// uint32_t
+//total time for 60 second of audio: <Timer: fm mod: 130.182 msec>
+//total time for 60 second of audio: <Timer: mapping two sinewaves: 157.547 msec>
+//total time for 60 seconds of audio: <Timer: recording a stereo sine: 60.296 msec>
+//total time for 60 seconds of audio: <Timer: sequencing a stereo buffer: 130.45 msec>
+// uint64_t
+//total time for 60 second of audio: <Timer: fm mod: 127.016 msec>
+//total time for 60 second of audio: <Timer: mapping two sinewaves: 114.718 msec>
+//total time for 60 seconds of audio: <Timer: recording a stereo sine: 73.84 msec>
+//total time for 60 seconds of audio: <Timer: sequencing a stereo buffer: 136.86 msec>
 
+// 20261019, parallel fill, -O3; on a single core host, so no gain is expected; measures overhead only
+//total time for 60 seconds of audio: <Timer: eight voices, joint: 1378.26 msec>
+//total time for 60 seconds of audio: <Timer: eight voices, parallel: 1348.27 msec>
 
+// 20261019, offline block size, -O3; per-block overhead is small against per-sample work in these Gens, so times are within the variance of runs
+//total time for 60 seconds of audio: <Timer: block size 0: 111.023 msec>
+//total time for 60 seconds of audio: <Timer: block size 1024: 142.917 msec>
+//total time for 60 seconds of audio: <Timer: block size 4096: 113.178 msec>
+//total time for 60 seconds of audio: <Timer: block size 16384: 131.551 msec>
 
+// 20261019, render_range, -O3
+//total time for 60 seconds of audio: <Timer: render and write_outputs_to_vector: 64.735 msec>
+//total time for 60 seconds of audio: <Timer: render_range: 58.577 msec>
 
+// 20261019, render_range rendering larger frames of 1024 samples, with a deep network, -O3; two runs; per-sample work dominates at any frame size, so the gain is within the variance of runs
+//total time for 60 seconds of audio: <Timer: render and write_outputs_to_vector: 81.05 msec>
+//total time for 60 seconds of audio: <Timer: render_range: 70.547 msec>
+//total time for 60 seconds of audio: <Timer: deep network, render and write_outputs_to_vector: 2573.93 msec>
+//total time for 60 seconds of audio: <Timer: deep network, render_range: 2403.12 msec>
+//total time for 60 seconds of audio: <Timer: render and write_outputs_to_vector: 66.643 msec>
+//total time for 60 seconds of audio: <Timer: render_range: 79.521 msec>
+//total time for 60 seconds of audio: <Timer: deep network, render and write_outputs_to_vector: 2396.77 msec>
+//total time for 60 seconds of audio: <Timer: deep network, render_range: 2669.72 msec>
 
+// 20261019, clone of a voice of 200 Gens (not counting slots), -O3
+//<Timer: build 1000 voices: 930.634 msec>
+//<Timer: clone 1000 voices: 240.284 msec>
 
+// 20261019, sixteen voices with a note every quarter second, -O3; three runs each
+//total time for 60 seconds of audio: <Timer: sixteen voices, summed: 1687.41 msec>
+//total time for 60 seconds of audio: <Timer: sixteen voices, VoiceAllocator: 59.666 msec>
+//total time for 60 seconds of audio: <Timer: sixteen voices, summed: 1790.96 msec>
+//total time for 60 seconds of audio: <Timer: sixteen voices, VoiceAllocator: 81.354 msec>
+//total time for 60 seconds of audio: <Timer: sixteen voices, summed: 2126.38 msec>
+//total time for 60 seconds of audio: <Timer: sixteen voices, VoiceAllocator: 78.506 msec>
 
+// 20261019, 32 partial additive bank, -O3; two runs each; sin() dominates and has no vector form here, so lanes save only per-Gen overhead, within the variance of runs
+//total time for 60 seconds of audio: <Timer: 32 Sines: 1779.22 msec>
+//total time for 60 seconds of audio: <Timer: one Sine of 32 lanes: 1872.09 msec>
+//total time for 60 seconds of audio: <Timer: 32 Sines: 1699.72 msec>
+//total time for 60 seconds of audio: <Timer: one Sine of 32 lanes: 1585.69 msec>
 
+// 20261019, as above, with Sine lanes taking the sine with sin_samples() (SSE2, two at once) and Map rendering with map_samples(); two runs each; the Map case includes its source, one Sine of 32 lanes
+//total time for 60 seconds of audio: <Timer: 32 Sines: 1962.35 msec>
+//total time for 60 seconds of audio: <Timer: one Sine of 32 lanes: 1079.91 msec>
+//total time for 60 seconds of audio: <Timer: 32 Maps: 2378.2 msec>
+//total time for 60 seconds of audio: <Timer: one Map of 32 lanes: 1836.19 msec>
+//total time for 60 seconds of audio: <Timer: 32 Sines: 1786.53 msec>
+//total time for 60 seconds of audio: <Timer: one Sine of 32 lanes: 1070.93 msec>
+//total time for 60 seconds of audio: <Timer: 32 Maps: 1843.67 msec>
+//total time for 60 seconds of audio: <Timer: one Map of 32 lanes: 1463.41 msec>
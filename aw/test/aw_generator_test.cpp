@@ -10,6 +10,9 @@
 #include <boost/test/unit_test.hpp>
 
 #include <stdexcept>
+#include <thread>
+#include <chrono>
+#include <limits>
 
 
 #include "aw_generator.h"
@@ -457,6 +460,472 @@ BOOST_AUTO_TEST_CASE(aw_generator_buffer_7) {
     BOOST_CHECK_EQUAL(g1->get_outputs_size(), 4);
 }
 
+BOOST_AUTO_TEST_CASE(aw_generator_buffer_cache) {
+    // a second load of the same file is served from the decoded sample cache
+    EnvPtr e = Env::get_default_env();
+    VSampleT v;
+    for (FrameSizeT i=0; i < 3000; ++i) {
+        v.push_back(static_cast<SampleT>(i % 100) / 100);
+        v.push_back(-static_cast<SampleT>(i % 50) / 50);
+    }
+	GenPtr g1 = Gen::make(GenID::SamplesBuffer);
+    g1->set_slot_by_index(0, 2); // channels
+    g1->set_outputs_from_vector(v, 2);
+    std::string fp = e->get_fp_temp("buffer_cache.aif");
+    g1->write_output_to_fp(fp);
+
+    SamplesBuffer::set_cache_enabled(true);
+	GenPtr g2 = Gen::make(GenID::SamplesBuffer);
+    g2->set_slot_by_index(0, 2);
+    g2->set_outputs_from_fp(fp); // decodes, writes the cache
+	GenPtr g3 = Gen::make(GenID::SamplesBuffer);
+    g3->set_slot_by_index(0, 2);
+    g3->set_outputs_from_fp(fp); // maps the cache
+
+    BOOST_CHECK_EQUAL(g3->get_output_count(), 2);
+    BOOST_CHECK_EQUAL(g3->get_outputs_size(), 6000);
+    BOOST_CHECK(g2->outputs == g3->outputs);
+    BOOST_CHECK_CLOSE(g3->outputs[0][99], .99, .01);
+    BOOST_CHECK_CLOSE(g3->outputs[1][49], -.98, .01);
+
+    // one cache file, with no temporary files left behind
+    boost::filesystem::path d(e->get_fp_cache(""));
+    std::size_t count {0};
+    for (boost::filesystem::directory_iterator i(d), end; i != end; ++i) {
+        BOOST_CHECK_EQUAL(i->path().extension().string(), ".awc");
+        ++count;
+    }
+    BOOST_CHECK(count >= 1);
+
+    // disabling the cache decodes again, with the same result
+    SamplesBuffer::set_cache_enabled(false);
+	GenPtr g4 = Gen::make(GenID::SamplesBuffer);
+    g4->set_slot_by_index(0, 2);
+    g4->set_outputs_from_fp(fp);
+    BOOST_CHECK(g2->outputs == g4->outputs);
+    SamplesBuffer::set_cache_enabled(true);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_buffer_async) {
+    // files load in parallel, sized at once, and are taken when first needed
+    EnvPtr e = Env::get_default_env();
+    std::vector<std::string> fps;
+    std::vector<GenPtr> sync;
+    for (FrameSizeT k=0; k < 6; ++k) {
+        VSampleT v;
+        for (FrameSizeT i=0; i < 1000 + k * 100; ++i) {
+            v.push_back(static_cast<SampleT>((i + k) % 10) / 10);
+        }
+        GenPtr b = Gen::make(GenID::SamplesBuffer);
+        b->set_outputs_from_vector(v, 1);
+        std::stringstream name;
+        name << "buffer_async_" << k << ".aif";
+        fps.push_back(e->get_fp_temp(name.str()));
+        b->write_output_to_fp(fps.back());
+        GenPtr c = Gen::make(GenID::SamplesBuffer);
+        c->set_outputs_from_fp(fps.back());
+        sync.push_back(c);
+    }
+
+    SamplesBuffer::set_load_async(true);
+    std::vector<GenPtr> loads;
+    for (FrameSizeT k=0; k < fps.size(); ++k) {
+        GenPtr b = Gen::make(GenID::SamplesBuffer);
+        fps[k] && b;
+        // the size is known before the samples are
+        BOOST_CHECK_EQUAL(b->get_frame_size(), 1000 + k * 100);
+        loads.push_back(b);
+    }
+    SamplesBuffer::set_load_async(false);
+    for (FrameSizeT k=0; k < fps.size(); ++k) {
+        loads[k]->wait_loaded();
+        SamplesBufferPtr sb = std::dynamic_pointer_cast<SamplesBuffer>(
+                loads[k]);
+        BOOST_CHECK(sb->is_loaded());
+        BOOST_CHECK(sb->get_load_seconds() > 0);
+        BOOST_CHECK(loads[k]->outputs == sync[k]->outputs);
+    }
+
+    // a sequencer takes a pending buffer when it first renders
+    SamplesBufferPtr b1 = std::dynamic_pointer_cast<SamplesBuffer>(
+            Gen::make(GenID::SamplesBuffer));
+    b1->load_async(fps[0]);
+    GenPtr s1 = Gen::make(GenID::Sequencer);
+    s1->set_slot_by_index(0, b1);
+    GenPtr c1 = Gen::make(GenID::Counter);
+    c1->set_input_by_index(0, 1); // trigger every sample
+    s1->set_input_by_index(0, c1);
+    s1->render(1);
+    BOOST_CHECK(b1->is_loaded());
+    BOOST_CHECK(b1->outputs == sync[0]->outputs);
+    BOOST_CHECK_CLOSE(s1->outputs[0][5], sync[0]->outputs[0][5], .0001);
+
+    // a missing file throws at once
+    BOOST_REQUIRE_THROW(b1->load_async(fps[0] + ".missing"),
+            std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_buffer_resample) {
+    // files at another rate are converted to that of the Env when loaded
+    EnvPtr e = Env::get_default_env();
+    std::string fp = e->get_fp_temp("buffer_resample.aif");
+    VSampleT v;
+    for (FrameSizeT i=0; i < 24000; ++i) {
+        v.push_back(std::sin(PI2 * 500 * i / 48000));
+    }
+    SoundFileWriter w1(fp, 1, 48000, SampleFormat::Float32);
+    w1.write(v.data(), v.size());
+    w1.close();
+
+    GenPtr b1 = Gen::make(GenID::SamplesBuffer);
+    b1->set_outputs_from_fp(fp);
+    BOOST_CHECK_EQUAL(b1->get_frame_size(), 22050);
+    SampleT diff {0};
+    for (FrameSizeT i=500; i < 21500; ++i) {
+        diff = std::max(diff, std::abs(b1->outputs[0][i] -
+                std::sin(PI2 * 500 * i / 44100)));
+    }
+    BOOST_CHECK_SMALL(diff, 1e-4);
+
+    // the same through the cache, and asynchronously
+    SamplesBufferPtr b2 = std::dynamic_pointer_cast<SamplesBuffer>(
+            Gen::make(GenID::SamplesBuffer));
+    b2->load_async(fp);
+    BOOST_CHECK_EQUAL(b2->get_frame_size(), 22050);
+    b2->wait_loaded();
+    BOOST_CHECK(b1->outputs == b2->outputs);
+
+    // without conversion, samples are unchanged
+    SamplesBuffer::set_resample_quality(ResampleQuality::None);
+    GenPtr b3 = Gen::make(GenID::SamplesBuffer);
+    b3->set_outputs_from_fp(fp);
+    SamplesBuffer::set_resample_quality(ResampleQuality::Medium);
+    BOOST_CHECK_EQUAL(b3->get_frame_size(), 24000);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_buffer_parallel) {
+    // channels with independent networks are filled at once, with the same result as filling jointly
+    std::vector<GenPtr> buffers;
+    for (int k=0; k < 2; ++k) {
+        GenPtr b = Gen::make(GenID::SecondsBuffer);
+        b->set_slot_by_index(0, 4);
+        b->set_slot_by_index(1, 1.01); // not a multiple of the frame size
+        for (PIndexT j=0; j < 4; ++j) {
+            GenPtr g1 = Gen::make(GenID::Sine);
+            g1->set_input_by_index(0, 100 * (j + 1));
+            GenPtr g2 = Gen::make(GenID::Sine);
+            g2->set_input_by_index(0, 30);
+            GenPtr g3 = Gen::make(GenID::Multiply);
+            g3->set_input_by_index(0, g1);
+            g3->add_input_by_index(0, g2);
+            b->set_input_by_index(j, g3);
+            b->add_input_by_index(j, .25); // two Gens summed at the input
+        }
+        buffers.push_back(b);
+    }
+    SamplesBuffer::set_parallel_fill(false);
+    buffers[0]->render(1);
+    SamplesBuffer::set_parallel_fill(true);
+    BOOST_CHECK(SamplesBuffer::get_parallel_fill());
+    buffers[1]->render(1);
+    BOOST_CHECK_EQUAL(buffers[1]->get_frame_size(), 44541);
+    BOOST_CHECK(buffers[0]->outputs == buffers[1]->outputs);
+    BOOST_CHECK(buffers[1]->outputs[3][100] != 0);
+
+    // a Gen shared by two channels falls back to filling jointly
+    GenPtr b3 = Gen::make(GenID::SecondsBuffer);
+    b3->set_slot_by_index(0, 2);
+    b3->set_slot_by_index(1, .5);
+    GenPtr g4 = Gen::make(GenID::Sine);
+    g4->set_input_by_index(0, 100);
+    GenPtr g5 = Gen::make(GenID::Sine);
+    g5->set_input_by_index(0, 100);
+    b3->set_input_by_index(0, g4);
+    b3->set_input_by_index(1, g4);
+    b3->render(1);
+    BOOST_CHECK(b3->outputs[0] == b3->outputs[1]);
+    g5->render(1);
+    for (FrameSizeT i=0; i < g5->get_frame_size(); ++i) {
+        BOOST_CHECK_EQUAL(b3->outputs[0][i], g5->outputs[0][i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_buffer_block_size) {
+    // inputs rendered with a larger frame size fill the same samples, and are left in the same state
+    std::vector<GenPtr> buffers;
+    std::vector<GenPtr> lfos;
+    for (int k=0; k < 3; ++k) {
+        GenPtr lfo = Gen::make(GenID::Sine);
+        lfo->set_input_by_index(0, 3);
+        GenPtr ph = Gen::make(GenID::Phasor);
+        ph->set_input_by_index(0, 7);
+        GenPtr ad = Gen::make(GenID::AttackDecay);
+        ad->set_input_by_index(0, ph, 1); // trigger
+        ad->set_input_by_index(1, .01);
+        ad->set_input_by_index(2, .05);
+        GenPtr car = Gen::make(GenID::Sine);
+        car->set_input_by_index(0, lfo * 100 + 400);
+        GenPtr pan = Gen::make(GenID::Panner);
+        pan->set_input_by_index(0, car * ad);
+        pan->set_input_by_index(1, lfo);
+
+        GenPtr steps = Gen::make(GenID::SamplesBuffer);
+        Inj<SampleT>({60, 58, 60, 60, 69, 60, 60}) && steps;
+        GenPtr sq = Gen::make(GenID::Sequencer);
+        sq->set_slot_by_index(0, steps);
+        GenPtr c1 = Gen::make(GenID::Counter);
+        c1->set_input_by_index(0, ph, 1);
+        sq->set_input_by_index(0, c1);
+
+        GenPtr b = Gen::make(GenID::SecondsBuffer);
+        b->set_slot_by_index(0, 3);
+        b->set_slot_by_index(1, 1.3);
+        b->set_input_by_index(0, pan, 0);
+        b->set_input_by_index(1, pan, 1);
+        b->set_input_by_index(2, sq);
+        buffers.push_back(b);
+        lfos.push_back(lfo);
+    }
+    BOOST_CHECK_EQUAL(SamplesBuffer::get_block_size(), 4096);
+    SamplesBuffer::set_block_size(0);
+    buffers[0]->render(1);
+    SamplesBuffer::set_block_size(1000); // rounded down to 960
+    buffers[1]->render(1);
+    SamplesBuffer::set_block_size(4096);
+    buffers[2]->render(1);
+    for (int k=1; k < 3; ++k) {
+        BOOST_CHECK(buffers[0]->outputs == buffers[k]->outputs);
+        BOOST_CHECK_EQUAL(lfos[0]->get_render_count(),
+                lfos[k]->get_render_count());
+        BOOST_CHECK_EQUAL(lfos[k]->get_frame_size(), 64);
+    }
+    // rendering on continues from the same state
+    RenderCountT rc = lfos[0]->get_render_count();
+    for (int k=0; k < 3; ++k) {
+        lfos[k]->render(rc + 1);
+    }
+    BOOST_CHECK(lfos[0]->outputs == lfos[1]->outputs);
+    BOOST_CHECK(lfos[0]->outputs == lfos[2]->outputs);
+
+    // a second render falls back, as Gens beyond the inputs were not reset, with the same result
+    SamplesBuffer::set_block_size(0);
+    buffers[0]->render(2);
+    SamplesBuffer::set_block_size(4096);
+    buffers[2]->render(2);
+    BOOST_CHECK(buffers[0]->outputs == buffers[2]->outputs);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_buffer_adopt) {
+    // vectors moved into a buffer become its outputs without a copy
+    VVSampleT vvst(3, VSampleT(1000));
+    for (FrameSizeT i=0; i < 1000; ++i) {
+        vvst[0][i] = i;
+        vvst[1][i] = -static_cast<SampleT>(i);
+        vvst[2][i] = .5;
+    }
+    const SampleT* p0 = vvst[0].data();
+    const SampleT* p2 = vvst[2].data();
+    SamplesBufferPtr b1 = std::dynamic_pointer_cast<SamplesBuffer>(
+            Gen::make(GenID::SamplesBuffer));
+    b1->set_outputs_from_vectors(std::move(vvst));
+    BOOST_CHECK_EQUAL(b1->get_output_count(), 3);
+    BOOST_CHECK_EQUAL(b1->get_frame_size(), 1000);
+    BOOST_CHECK_EQUAL(b1->get_outputs_size(), 3000);
+    BOOST_CHECK(b1->outputs[0].data() == p0);
+    BOOST_CHECK(b1->outputs[2].data() == p2);
+    BOOST_CHECK_EQUAL(b1->outputs[1][999], -999);
+
+    // a sequencer reads adopted samples
+    GenPtr s1 = Gen::make(GenID::Sequencer);
+    s1->set_slot_by_index(0, b1);
+    GenPtr c1 = Gen::make(GenID::Counter);
+    c1->set_input_by_index(0, 1);
+    s1->set_input_by_index(0, c1);
+    s1->render(1);
+    BOOST_CHECK_EQUAL(s1->outputs[0][10], b1->outputs[0][10]);
+
+    // injected values are copied once, then adopted
+    GenPtr b2 = Gen::make(GenID::SamplesBuffer);
+    Inj<SampleT>({{0, 1}, {2, 3}, {4, 5}}) && b2;
+    BOOST_CHECK_EQUAL(b2->get_output_count(), 2);
+    BOOST_CHECK_EQUAL(b2->get_frame_size(), 3);
+    BOOST_CHECK_EQUAL(b2->outputs[0][2], 4);
+    BOOST_CHECK_EQUAL(b2->outputs[1][1], 3);
+
+    VVSampleT uneven {{1, 2}, {1}};
+    BOOST_REQUIRE_THROW(b1->set_outputs_from_vectors(std::move(uneven)),
+            std::invalid_argument);
+    VVSampleT empty;
+    BOOST_REQUIRE_THROW(b1->set_outputs_from_vectors(std::move(empty)),
+            std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_buffer_storage) {
+    // compact storage keeps samples as encoded bytes, decoded when read
+    VSampleT v;
+    for (FrameSizeT i=0; i < 1000; ++i) {
+        v.push_back(std::sin(PI2 * i / 100));
+        v.push_back(static_cast<SampleT>(i % 10) / 10);
+    }
+    SamplesBufferPtr b1 = std::dynamic_pointer_cast<SamplesBuffer>(
+            Gen::make(GenID::SamplesBuffer));
+    b1->set_slot_by_index(0, 2);
+    b1->set_outputs_from_vector(v, 2);
+    SamplesBufferPtr b2 = std::dynamic_pointer_cast<SamplesBuffer>(
+            Gen::make(GenID::SamplesBuffer));
+    b2->set_slot_by_index(0, 2);
+    b2->set_outputs_from_vector(v, 2);
+    BOOST_CHECK_EQUAL(b2->get_storage_bytes(), 16000);
+
+    b2->set_storage(SampleFormat::PCM16);
+    BOOST_CHECK(b2->is_compact());
+    BOOST_CHECK_EQUAL(b2->get_storage_bytes(), 4000);
+    BOOST_CHECK(b2->outputs[0].empty());
+    BOOST_CHECK_EQUAL(b2->get_frame_size(), 1000);
+    VSampleT d(100);
+    b2->decode(1, 900, 100, d.data());
+    for (FrameSizeT i=0; i < 100; ++i) {
+        BOOST_CHECK(std::abs(d[i] - b1->outputs[1][900 + i]) < .0001);
+        BOOST_CHECK(std::abs(b2->get_sample(0, i) - b1->outputs[0][i])
+                < .0001);
+    }
+
+    // a sequencer reads the same values from either storage
+    GenPtr s1 = Gen::make(GenID::Sequencer);
+    s1->set_slot_by_index(0, b1);
+    GenPtr c1 = Gen::make(GenID::Counter);
+    c1->set_input_by_index(0, 1);
+    s1->set_input_by_index(0, c1);
+    GenPtr s2 = Gen::make(GenID::Sequencer);
+    s2->set_slot_by_index(0, b2);
+    GenPtr c2 = Gen::make(GenID::Counter);
+    c2->set_input_by_index(0, 1);
+    s2->set_input_by_index(0, c2);
+    for (RenderCountT f=1; f < 4; ++f) {
+        s1->render(f);
+        s2->render(f);
+        for (FrameSizeT i=0; i < s1->get_frame_size(); ++i) {
+            BOOST_CHECK(std::abs(s1->outputs[0][i] - s2->outputs[0][i])
+                    < .0001);
+            BOOST_CHECK(std::abs(s1->outputs[1][i] - s2->outputs[1][i])
+                    < .0001);
+        }
+    }
+
+    // new outputs are stored compactly; returning to Float64 restores them
+    b2->set_outputs_from_vector(v, 2);
+    BOOST_CHECK(b2->is_compact());
+    b2->set_storage(SampleFormat::PCM24);
+    BOOST_CHECK_EQUAL(b2->get_storage_bytes(), 6000);
+    b2->set_storage(SampleFormat::Float64);
+    BOOST_CHECK(!b2->is_compact());
+    BOOST_CHECK_EQUAL(b2->outputs[0].size(), 1000);
+    BOOST_CHECK(std::abs(b2->outputs[0][25] - 1) < .0001);
+
+    // rendering records into compact storage
+    SamplesBufferPtr b3 = std::dynamic_pointer_cast<SamplesBuffer>(
+            Gen::make(GenID::SamplesBuffer));
+    b3->set_storage(SampleFormat::Float32);
+    GenPtr g1 = Gen::make(GenID::Sine);
+    g1->set_input_by_index(0, 100);
+    b3->set_input_by_index(0, g1);
+    b3->render(1);
+    BOOST_CHECK(b3->is_compact());
+    BOOST_CHECK(std::abs(b3->get_sample(0, 1)) > 0);
+
+    GenPtr bp = Gen::make(GenID::BreakPoints);
+    BOOST_REQUIRE_THROW(std::dynamic_pointer_cast<SamplesBuffer>(bp
+            )->set_storage(SampleFormat::PCM16), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_resampler_a) {
+    // a sine read at twice the rate is an octave higher; rates change at audio rate
+    GenPtr s1 = Gen::make(GenID::Sine);
+    s1->set_input_by_index(0, 441);
+    GenPtr r1 = Gen::make(GenID::Resampler);
+    r1->set_input_by_index(0, s1);
+    r1->set_input_by_index(1, 2);
+    ResamplerPtr rp = std::dynamic_pointer_cast<Resampler>(r1);
+    BOOST_CHECK(rp->get_quality() == ResampleQuality::Medium);
+
+    GenPtr s2 = Gen::make(GenID::Sine);
+    s2->set_input_by_index(0, 882);
+    FrameSizeT fs = r1->get_frame_size();
+    SampleT diff {0};
+    for (RenderCountT rc=1; rc <= 40; ++rc) {
+        r1->render(rc);
+        s2->render(rc);
+        // after the first frames, where the kernel reaches before the input
+        if (rc < 10) continue;
+        for (FrameSizeT i=0; i < fs; ++i) {
+            diff = std::max(diff, std::abs(r1->outputs[0][i] -
+                    s2->outputs[0][i]));
+        }
+    }
+    BOOST_CHECK_SMALL(diff, 1e-3);
+
+    // at a rate of zero, the output holds
+    GenPtr s3 = Gen::make(GenID::Sine);
+    s3->set_input_by_index(0, 441);
+    GenPtr r2 = Gen::make(GenID::Resampler);
+    r2->set_input_by_index(0, s3);
+    r2->set_input_by_index(1, 0);
+    r2->render(1);
+    SampleT held = r2->outputs[0][0];
+    r2->render(20);
+    BOOST_CHECK_EQUAL(r2->outputs[0][fs - 1], held);
+
+    // a constant signal passes at any rate, and the rate is limited
+    GenPtr r3 = Gen::make(GenID::Resampler);
+    ResamplerPtr rp3 = std::dynamic_pointer_cast<Resampler>(r3);
+    rp3->set_quality(ResampleQuality::High);
+    r3->set_input_by_index(0, .5);
+    GenPtr p1 = Gen::make(GenID::Phasor);
+    p1->set_input_by_index(0, 100);
+    r3->set_input_by_index(1, p1 * 20); // 0 to 20, above the limit
+    r3->render(100);
+    for (FrameSizeT i=0; i < fs; ++i) {
+        BOOST_CHECK_CLOSE(r3->outputs[0][i], .5, .001);
+    }
+    BOOST_CHECK_EQUAL(rp3->get_max_rate(), 8);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_resampler_b) {
+    // a snapshot restores the history and position read at a varying rate
+    auto build = []() {
+        GenPtr s1 = Gen::make(GenID::Sine);
+        s1->set_input_by_index(0, 300);
+        GenPtr p1 = Gen::make(GenID::Phasor);
+        p1->set_input_by_index(0, 3);
+        GenPtr r1 = Gen::make(GenID::Resampler);
+        r1->set_input_by_index(0, s1);
+        r1->set_input_by_index(1, p1 * 2.5 + .25);
+        return r1;
+    };
+    GenPtr r1 = build();
+    for (RenderCountT rc=1; rc <= 30; ++rc) {
+        r1->render(rc);
+    }
+    StateBlob b = r1->snapshot_network();
+    VVSampleT expected;
+    for (RenderCountT rc=31; rc <= 60; ++rc) {
+        r1->render(rc);
+        expected.push_back(r1->outputs[0]);
+    }
+    // into the same network, and into one built again
+    GenPtr r2 = build();
+    for (GenPtr g : {r1, r2}) {
+        b.rewind();
+        g->restore_network(b);
+        bool matched = true;
+        for (RenderCountT rc=31; rc <= 60; ++rc) {
+            g->render(rc);
+            matched = matched && g->outputs[0] == expected[rc - 31];
+        }
+        BOOST_CHECK(matched);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(aw_generator_phasor_1) {    
 	GenPtr g1 = Gen::make(GenID::Phasor);
     
@@ -2041,6 +2510,78 @@ BOOST_AUTO_TEST_CASE(aw_generator_counter_a) {
 
 
 
+BOOST_AUTO_TEST_CASE(aw_generator_events_a) {
+    // trigger outputs keep sparse events that match the dense frame
+
+	GenPtr phasor = Gen::make(GenID::Phasor);
+   	2000 >> phasor;
+
+    BOOST_CHECK_EQUAL(phasor->output_has_events(0), false);
+    BOOST_CHECK_EQUAL(phasor->output_has_events(1), true);
+
+    FrameSizeT count(0);
+    for (RenderCountT rc=1; rc < 20; ++rc) {
+        phasor->render(rc);
+        VFrameSizeType dense;
+        for (FrameSizeT i=0; i < phasor->get_frame_size(); ++i) {
+            if (phasor->outputs[1][i] > TRIG_THRESH) dense.push_back(i);
+        }
+        BOOST_CHECK(dense == phasor->output_events[1]);
+        count += dense.size();
+    }
+    BOOST_CHECK(count > 0);
+
+    // constants are event sources only when never or always triggering
+    BOOST_CHECK_EQUAL(Gen::make(0)->output_has_events(0), true);
+    BOOST_CHECK_EQUAL(Gen::make(1)->output_has_events(0), true);
+    BOOST_CHECK_EQUAL(Gen::make(1)->output_events[0].size(),
+            phasor->get_frame_size());
+    BOOST_CHECK_EQUAL(Gen::make(.5)->output_has_events(0), false);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_generator_events_b) {
+    // a Counter reading sparse events must match a Counter reading dense triggers
+
+	GenPtr phasor = Gen::make(GenID::Phasor);
+	GenPtr reset = Gen::make(GenID::Phasor);
+	GenPtr direction = Gen::make(GenID::Phasor);
+   	3000 >> phasor;
+   	700 >> reset;
+   	300 >> direction;
+    // map direction phasor to 0 to 3, covering forward, reverse, cycle
+    GenPtr dir_map = direction * 3;
+
+	GenPtr count_sparse = Gen::make(GenID::Counter);
+   	Inj<GenPtr>({phasor % 1, reset % 1, dir_map}) >> count_sparse;
+   	7 || count_sparse;
+
+    // passing through Add produces an output without events
+	GenPtr count_dense = Gen::make(GenID::Counter);
+   	Inj<GenPtr>({(phasor % 1) + 0, (reset % 1) + 0, dir_map}) >> count_dense;
+   	7 || count_dense;
+
+	GenPtr ad_sparse = Gen::make(GenID::AttackDecay);
+    Inj<GenPtr>({phasor % 1, Gen::make(.001), Gen::make(.002)}) >> ad_sparse;
+	GenPtr ad_dense = Gen::make(GenID::AttackDecay);
+    Inj<GenPtr>({(phasor % 1) + 0, Gen::make(.001), Gen::make(.002)}) >> ad_dense;
+
+    for (RenderCountT rc=1; rc < 200; ++rc) {
+        count_sparse->render(rc);
+        count_dense->render(rc);
+        ad_sparse->render(rc);
+        ad_dense->render(rc);
+        BOOST_REQUIRE(count_sparse->outputs[0] == count_dense->outputs[0]);
+        BOOST_REQUIRE(ad_sparse->outputs[0] == ad_dense->outputs[0]);
+        BOOST_REQUIRE(ad_sparse->outputs[2] == ad_dense->outputs[2]);
+    }
+    BOOST_CHECK(ad_sparse->output_events[2].size() <= 
+            ad_sparse->get_frame_size());
+}
+
+
+
+
 BOOST_AUTO_TEST_CASE(aw_to_samp) {
 	SampleT post;
 
@@ -2286,3 +2827,823 @@ BOOST_AUTO_TEST_CASE(aw_sequencer_a) {
 
 
 
+
+
+//! Build a network carrying state in phasors, an envelope, a counter, and a sine.
+GenPtr make_state_network() {
+	GenPtr ph = Gen::make(GenID::Phasor);
+    7 >> ph;
+	GenPtr ad = Gen::make(GenID::AttackDecay);
+    Inj<GenPtr>({ph % 1, Gen::make(.01), Gen::make(.03)}) >> ad;
+	GenPtr ct = Gen::make(GenID::Counter);
+    Inj<GenPtr>({ph % 1, Gen::make(0),
+            Gen::make(PTypeDirection::Opt::Cycle)}) >> ct;
+    5 || ct;
+	GenPtr s = Gen::make(GenID::Sine);
+    220 >> s;
+    return (s * ad) + ct;
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_state_a) {
+    // restoring a snapshot continues with the same output, in the same or a new network
+
+    GenPtr g1 = make_state_network();
+    FrameSizeT fs = g1->get_common_frame_size();
+    RenderCountT rc;
+    for (rc=1; rc <= 300; ++rc) {
+        g1->render(rc);
+    }
+    StateBlob b = g1->snapshot_network();
+    BOOST_CHECK_EQUAL(g1->get_render_count(), 300);
+
+    VSampleT post;
+    for (rc=301; rc <= 700; ++rc) {
+        g1->render(rc);
+        post.insert(post.end(), g1->outputs[0].begin(),
+                g1->outputs[0].end());
+    }
+    // the envelope and counter must have moved on
+    BOOST_CHECK(post[0] != post[fs * 200]);
+
+    g1->restore_network(b);
+    BOOST_CHECK_EQUAL(g1->get_render_count(), 300);
+    bool same {true};
+    for (rc=301; rc <= 700; ++rc) {
+        g1->render(rc);
+        for (FrameSizeT i=0; i < fs; ++i) {
+            if (g1->outputs[0][i] != post[(rc - 301) * fs + i]) same = false;
+        }
+    }
+    BOOST_CHECK(same);
+
+    // a new network of the same structure, through a file
+    std::string fp = Env::get_default_env()->get_fp_temp("state_a.aws");
+    b.write_to_fp(fp);
+    StateBlob b2;
+    b2.read_from_fp(fp);
+    BOOST_CHECK_EQUAL(b2.size(), b.size());
+
+    GenPtr g2 = make_state_network();
+    g2->restore_network(b2);
+    same = true;
+    for (rc=301; rc <= 700; ++rc) {
+        g2->render(rc);
+        for (FrameSizeT i=0; i < fs; ++i) {
+            if (g2->outputs[0][i] != post[(rc - 301) * fs + i]) same = false;
+        }
+    }
+    BOOST_CHECK(same);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_state_b) {
+    // mismatched networks and truncated blobs are rejected
+
+    GenPtr g1 = make_state_network();
+    g1->render(4);
+    StateBlob b = g1->snapshot_network();
+
+    GenPtr g2 = Gen::make(GenID::Sine);
+    BOOST_REQUIRE_THROW(g2->restore_network(b), std::invalid_argument);
+
+    StateBlob b4;
+    BOOST_REQUIRE_THROW(g1->restore_network(b4), std::invalid_argument);
+
+    // state of a single Gen
+    GenPtr s1 = Gen::make(GenID::Sine);
+    440 >> s1;
+    s1->render(3);
+    StateBlob b5;
+    s1->write_state(b5);
+    s1->render(4);
+    VSampleT frame4(s1->outputs[0]);
+    s1->reset();
+    s1->read_state(b5);
+    s1->render(4);
+    BOOST_CHECK(s1->outputs[0] == frame4);
+}
+
+
+//! Build a network of time-driven Gens with constant inputs; optionally add an envelope, which cannot be moved analytically.
+GenPtr make_seek_network(bool envelope) {
+	GenPtr bps = Gen::make(GenID::BreakPoints);
+    Inj<SampleT>({{0, 0}, {37, 1}, {100, -1}, {153, 0}}) && bps;
+	GenPtr bpi = Gen::make(GenID::BPIntegrator);
+    bpi->set_slot_by_index(0, bps);
+    bpi->set_slot_by_index(1, PTypeInterpolate::Linear);
+    bpi->set_slot_by_index(2, PTypeTimeContext::Samples);
+    Inj<SampleT>({0, 1, 1}) >> bpi; // trig, cycle, exponent
+
+	GenPtr s = Gen::make(GenID::Sine);
+    220 >> s;
+	GenPtr ph = Gen::make(GenID::Phasor);
+    3 >> ph;
+    GenPtr root = (s * ph) + bpi;
+    if (envelope) {
+        GenPtr ad = Gen::make(GenID::AttackDecay);
+        Inj<GenPtr>({ph % 1, Gen::make(.01), Gen::make(.03)}) >> ad;
+        root = root * ad;
+    }
+    return root;
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_seek_a) {
+    // analytic seeks match rendering, forward and backward
+
+    GenPtr g1 = make_seek_network(false);
+    GenPtr g2 = make_seek_network(false);
+    FrameSizeT fs = g1->get_common_frame_size();
+    SampleT diff {0};
+
+    g1->render(1000);
+    BOOST_CHECK(g2->seek(1000));
+    BOOST_CHECK_EQUAL(g2->get_render_count(), 1000);
+    for (RenderCountT rc=1000; rc <= 1010; ++rc) {
+        g1->render(rc);
+        g2->render(rc);
+        for (FrameSizeT i=0; i < fs; ++i) {
+            diff = std::max(diff, std::abs(g1->outputs[0][i] -
+                    g2->outputs[0][i]));
+        }
+    }
+    BOOST_CHECK_SMALL(diff, 1e-6);
+
+    // backward resets first
+    GenPtr g3 = make_seek_network(false);
+    g3->render(517);
+    BOOST_CHECK(g2->seek(517));
+    diff = 0;
+    for (FrameSizeT i=0; i < fs; ++i) {
+        diff = std::max(diff, std::abs(g3->outputs[0][i] -
+                g2->outputs[0][i]));
+    }
+    BOOST_CHECK_SMALL(diff, 1e-6);
+
+    // forty minutes in, without rendering each frame
+    RenderCountT f = (40 * 60 * g2->get_sampling_rate()) / fs;
+    BOOST_CHECK(g2->seek(f));
+    BOOST_CHECK_EQUAL(g2->get_render_count(), f);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_clone_a) {
+    // a clone continues from the state of the original, sharing only buffers at slots
+    GenPtr lfo = Gen::make(GenID::Sine);
+    lfo->set_input_by_index(0, 3);
+    GenPtr ph = Gen::make(GenID::Phasor);
+    ph->set_input_by_index(0, 7);
+    GenPtr ad = Gen::make(GenID::AttackDecay);
+    ad->set_input_by_index(0, ph, 1);
+    ad->set_input_by_index(1, .01);
+    ad->set_input_by_index(2, .05);
+    GenPtr steps = Gen::make(GenID::SamplesBuffer);
+    Inj<SampleT>({200, 300, 250, 400}) && steps;
+    GenPtr sq = Gen::make(GenID::Sequencer);
+    sq->set_slot_by_index(0, steps);
+    GenPtr c1 = Gen::make(GenID::Counter);
+    c1->set_input_by_index(0, ph, 1);
+    sq->set_input_by_index(0, c1);
+    GenPtr car = Gen::make(GenID::Sine);
+    car->set_input_by_index(0, lfo * 20 + sq);
+    GenPtr pan = Gen::make(GenID::Panner);
+    pan->set_input_by_index(0, car * ad);
+    pan->set_input_by_index(1, lfo); // lfo is read twice
+
+    for (RenderCountT f=1; f <= 100; ++f) {
+        pan->render(f);
+    }
+    GenPtr pan2 = pan->clone();
+    BOOST_CHECK(pan2 != pan);
+    BOOST_CHECK(pan2->get_class_id() == GenID::Panner);
+    BOOST_CHECK_EQUAL(pan2->get_render_count(), 100);
+    BOOST_CHECK(pan2->outputs == pan->outputs);
+    BOOST_CHECK_EQUAL(steps.use_count(), 3); // here, and at two Sequencers
+
+    // the shared lfo is copied once, and not shared with the original
+    GenPtr lfo2 = pan2->get_input_gens_by_index(1)[0].first;
+    BOOST_CHECK(lfo2 != lfo);
+    GenPtr ad2 = pan2->get_input_gens_by_index(0)[0].first->
+            get_input_gens_by_index(0)[1].first;
+    BOOST_CHECK(ad2->get_class_id() == GenID::AttackDecay);
+
+    for (RenderCountT f=101; f <= 300; ++f) {
+        pan->render(f);
+        pan2->render(f);
+        BOOST_CHECK(pan2->outputs == pan->outputs);
+    }
+    // rendering the clone leaves the original in place
+    pan2->render(301);
+    BOOST_CHECK_EQUAL(pan->get_render_count(), 300);
+    BOOST_CHECK_EQUAL(lfo->get_render_count(), 300);
+
+    GenPtr fp = Gen::make(GenID::FilePlayer);
+    GenPtr a1 = Gen::make(GenID::Add);
+    a1->set_input_by_index(0, fp);
+    BOOST_REQUIRE_THROW(a1->clone(), std::domain_error);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_voice_allocator_a) {
+    // a voice is an envelope scaled by the note value
+    GenPtr trig = Gen::make(GenID::Constant);
+    GenPtr val = Gen::make(GenID::Constant);
+    GenPtr env = Gen::make(GenID::AttackDecay);
+    env->set_input_by_index(0, trig);
+    env->set_input_by_index(1, .001);
+    env->set_input_by_index(2, .01);
+    GenPtr voice = env * val;
+
+    GenPtr notes = Gen::make(GenID::Constant);
+    GenPtr pitch = Gen::make(GenID::Constant);
+    GenPtr g1 = Gen::make(GenID::VoiceAllocator);
+    VoiceAllocatorPtr va = std::dynamic_pointer_cast<VoiceAllocator>(g1);
+    g1->set_input_by_index(0, notes);
+    g1->set_input_by_index(1, pitch);
+    BOOST_REQUIRE_THROW(va->set_voice(voice, env, val, 2),
+            std::invalid_argument);
+    BOOST_REQUIRE_THROW(va->set_voice(voice, trig, notes, 2),
+            std::invalid_argument);
+    va->set_voice(voice, trig, val, 2, env);
+    BOOST_CHECK_EQUAL(va->get_voice_count(), 2);
+    BOOST_CHECK_EQUAL(g1->get_output_count(), 1);
+    BOOST_CHECK(va->get_steal() == VoiceSteal::Oldest);
+
+    // reference voices render every frame, and receive the same notes
+    std::vector<std::unordered_map<const Gen*, GenPtr>> refs(2);
+    std::vector<GenPtr> ref_voices;
+    for (auto& r : refs) {
+        ref_voices.push_back(voice->clone(r));
+    }
+    auto note = [&](RenderCountT f, FrameSizeT offset, SampleT v,
+            std::size_t r) {
+        std::dynamic_pointer_cast<Constant>(notes)->set_trigger_at(f, offset);
+        std::dynamic_pointer_cast<Constant>(pitch)->set_value_at(f, offset, v);
+        std::dynamic_pointer_cast<Constant>(refs[r][trig.get()])->
+                set_trigger_at(f, offset);
+        std::dynamic_pointer_cast<Constant>(refs[r][val.get()])->
+                set_value_at(f, offset, v);
+    };
+    FrameSizeT fs = g1->get_frame_size();
+    bool matched = true;
+    bool clone_matched = true;
+    SampleT peak = 0;
+    std::vector<PIndexT> active;
+    GenPtr g2;
+    for (RenderCountT f=1; f <= 100; ++f) {
+        if (f == 2) note(f, 10, 1, 0);
+        else if (f == 5) note(f, 3, 2, 1);
+        // with both voices asleep, the first is reused
+        else if (f == 60) note(f, 0, 1, 0);
+        else if (f == 61) note(f, 0, 2, 1);
+        // the oldest voice is stolen
+        else if (f == 62) note(f, 7, 4, 0);
+        g1->render(f);
+        ref_voices[0]->render(f);
+        ref_voices[1]->render(f);
+        for (FrameSizeT k=0; k < fs; ++k) {
+            matched = matched && g1->outputs[0][k] ==
+                    ref_voices[0]->outputs[0][k] + ref_voices[1]->outputs[0][k];
+            peak = std::max(peak, g1->outputs[0][k]);
+        }
+        active.push_back(va->get_active_voice_count());
+        // a clone has its own voices, continuing those sounding
+        if (f == 63) g2 = g1->clone();
+        else if (f > 63) {
+            g2->render(f);
+            clone_matched = clone_matched && g2->outputs == g1->outputs;
+        }
+    }
+    BOOST_CHECK(matched);
+    BOOST_CHECK(clone_matched);
+    BOOST_CHECK(peak > 3.9); // the stolen voice, with value 4
+    BOOST_CHECK_EQUAL(active[0], 0);
+    BOOST_CHECK_EQUAL(active[2], 1);
+    BOOST_CHECK_EQUAL(active[5], 2);
+    BOOST_CHECK_EQUAL(active[50], 0); // voices sleep
+    BOOST_CHECK_EQUAL(active[62], 2);
+    BOOST_CHECK_EQUAL(active[99], 0);
+    BOOST_CHECK(g2 != nullptr);
+
+    // without stealing, notes beyond the voices are dropped
+    va->set_steal(VoiceSteal::None);
+    note(101, 0, 1, 0);
+    note(101, 1, 1, 1);
+    g1->render(101);
+    notes->render(101);
+    std::dynamic_pointer_cast<Constant>(notes)->set_trigger_at(102, 0);
+    g1->render(102);
+    BOOST_CHECK_EQUAL(va->get_active_voice_count(), 2);
+
+    BOOST_REQUIRE_THROW(va->set_sleep(-1, 4), std::invalid_argument);
+    BOOST_REQUIRE_THROW(va->set_sleep(0, 0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_voice_allocator_b) {
+    // voices are reset with the allocator and stored in its snapshots
+    GenPtr trig = Gen::make(GenID::Constant);
+    GenPtr val = Gen::make(GenID::Constant);
+    GenPtr env = Gen::make(GenID::AttackDecay);
+    env->set_input_by_index(0, trig);
+    env->set_input_by_index(1, .001);
+    env->set_input_by_index(2, .05);
+    GenPtr osc = Gen::make(GenID::Sine);
+    osc->set_input_by_index(0, val);
+    GenPtr voice = osc * env;
+
+    GenPtr notes = Gen::make(GenID::Constant);
+    GenPtr pitch = Gen::make(GenID::Constant);
+    GenPtr g1 = Gen::make(GenID::VoiceAllocator);
+    VoiceAllocatorPtr va = std::dynamic_pointer_cast<VoiceAllocator>(g1);
+    g1->set_input_by_index(0, notes);
+    g1->set_input_by_index(1, pitch);
+    va->set_voice(voice, trig, val, 3, env);
+    ConstantPtr n1 = std::dynamic_pointer_cast<Constant>(notes);
+    ConstantPtr p1 = std::dynamic_pointer_cast<Constant>(pitch);
+
+    auto play = [&](RenderCountT first, RenderCountT last) {
+        VVSampleT frames;
+        for (RenderCountT f=first; f <= last; ++f) {
+            if (f == 2 || f == 9) {
+                p1->set_value_at(f, 5, 300 + f * 10);
+                n1->set_trigger_at(f, 5);
+            }
+            g1->render(f);
+            frames.push_back(g1->outputs[0]);
+        }
+        return frames;
+    };
+    VVSampleT first = play(1, 5);
+    StateBlob b = g1->snapshot_network();
+    VVSampleT expected = play(6, 20);
+    BOOST_CHECK_EQUAL(va->get_active_voice_count(), 2);
+
+    g1->restore_network(b);
+    BOOST_CHECK_EQUAL(va->get_active_voice_count(), 1);
+    BOOST_CHECK(play(6, 20) == expected);
+
+    // after a reset, voices start again from their reset state
+    g1->reset_network();
+    BOOST_CHECK_EQUAL(va->get_active_voice_count(), 0);
+    BOOST_CHECK(play(1, 5) == first);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_lanes_a) {
+    // one Sine of four lanes renders as four Sines, to within the error of sin_samples()
+    VSampleT rates {110, 220, 330, 440.5};
+    GenPtr g1 = Gen::make(GenID::Sine);
+    g1->set_lane_count(4);
+    g1->set_input_by_index(0, Gen::make_lanes(rates));
+    BOOST_CHECK_EQUAL(g1->get_lane_count(), 4);
+    BOOST_CHECK_EQUAL(g1->get_output_count(), 4);
+
+    std::vector<GenPtr> sines;
+    for (auto r : rates) {
+        GenPtr g = Gen::make(GenID::Sine);
+        g->set_input_by_index(0, r);
+        sines.push_back(g);
+    }
+    // scalars are broadcast to every lane by operators
+    GenPtr g2 = g1 * .5;
+    BOOST_CHECK_EQUAL(g2->get_lane_count(), 4);
+    // lanes at a Map are read lane by lane; the scalar bounds by every lane
+    GenPtr g3 = Gen::make(GenID::Map);
+    g3->set_lane_count(4);
+    g3->set_input_by_index(0, g2);
+    g3->set_input_by_index(1, -.5);
+    g3->set_input_by_index(2, .5);
+    g3->set_input_by_index(3, 0);
+    g3->set_input_by_index(4, 100);
+
+    bool matched = true;
+    FrameSizeT fs = g1->get_frame_size();
+    for (RenderCountT f=1; f <= 50; ++f) {
+        g3->render(f);
+        for (PIndexT l=0; l < 4; ++l) {
+            sines[l]->render(f);
+            for (FrameSizeT k=0; k < fs; ++k) {
+                SampleT s = sines[l]->outputs[0][k];
+                matched = matched &&
+                        std::fabs(g1->outputs[l][k] - s) < 1e-12 &&
+                        g2->outputs[l][k] == g1->outputs[l][k] * .5 &&
+                        std::fabs(g3->outputs[l][k] - (s * .5 + .5) * 100)
+                        < 1e-9;
+            }
+        }
+    }
+    BOOST_CHECK(matched);
+
+    // lane state is copied and stored
+    GenPtr g4 = g3->clone();
+    StateBlob b = g3->snapshot_network();
+    g3->render(51);
+    VVSampleT expected = g3->outputs;
+    g4->render(51);
+    BOOST_CHECK(g4->outputs == expected);
+    g3->restore_network(b);
+    g3->render(51);
+    BOOST_CHECK(g3->outputs == expected);
+
+    BOOST_REQUIRE_THROW(g1->set_lane_count(0), std::invalid_argument);
+    BOOST_REQUIRE_THROW(Gen::make(GenID::Phasor)->set_lane_count(2),
+            std::domain_error);
+    BOOST_REQUIRE_THROW(Gen::make_lanes({}), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_lanes_b) {
+    // channels of an Add are not lanes: stereo operands combine channel by channel
+    std::vector<GenPtr> pans;
+    for (SampleT p : {.2, .5, .9}) {
+        GenPtr g = Gen::make(GenID::Panner);
+        g->set_input_by_index(0, 1);
+        g->set_input_by_index(1, p);
+        pans.push_back(g);
+    }
+    GenPtr g1 = (pans[0] + pans[1]) + pans[2];
+    BOOST_CHECK_EQUAL(g1->get_lane_count(), 1);
+    BOOST_CHECK_EQUAL(g1->get_output_count(), 2);
+    GenPtr g2 = (pans[0] + pans[1]) * .5;
+    BOOST_CHECK_EQUAL(g2->get_output_count(), 1);
+    g1->render(1);
+    g2->render(1);
+    for (PIndexT c=0; c < 2; ++c) {
+        SampleT expected = 0;
+        for (auto& p : pans) {
+            expected += p->outputs[c][0];
+        }
+        BOOST_CHECK_CLOSE(g1->outputs[c][0], expected, 1e-9);
+    }
+    BOOST_CHECK_CLOSE(g2->outputs[0][0],
+            (pans[0]->outputs[0][0] + pans[1]->outputs[0][0]) * .5, 1e-9);
+
+    // a single output is read by every lane; a Panner is not, as it has two
+    GenPtr lanes = Gen::make_lanes({1, 2, 3});
+    GenPtr g3 = lanes * pans[0];
+    BOOST_CHECK_EQUAL(g3->get_output_count(), 2);
+    BOOST_CHECK_EQUAL(g3->get_lane_count(), 1);
+    GenPtr g4 = lanes * Gen::make(2);
+    BOOST_CHECK_EQUAL(g4->get_lane_count(), 3);
+    g4->render(1);
+    BOOST_CHECK_EQUAL(g4->outputs[2][0], 6);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_render_range_a) {
+    // frames rendered into caller buffers match frames rendered one at a time
+    std::vector<GenPtr> roots;
+    for (int k=0; k < 2; ++k) {
+        GenPtr g1 = Gen::make(GenID::Sine);
+        g1->set_input_by_index(0, 5);
+        GenPtr g2 = Gen::make(GenID::Phasor);
+        g2->set_input_by_index(0, g1 * 50 + 100);
+        roots.push_back(g2);
+    }
+    FrameSizeT fs = roots[0]->get_frame_size();
+    RenderCountT count {40};
+    VVSampleT planar(2, VSampleT(count * fs, -1));
+    std::vector<SampleT*> dst {planar[0].data(), planar[1].data()};
+    roots[0]->render_range(1, count, dst.data(), 2);
+    BOOST_CHECK_EQUAL(roots[0]->get_render_count(), count);
+    for (RenderCountT f=1; f <= count; ++f) {
+        roots[1]->render(f);
+        for (FrameSizeT i=0; i < fs; ++i) {
+            BOOST_CHECK_EQUAL(planar[0][(f - 1) * fs + i],
+                    roots[1]->outputs[0][i]);
+            BOOST_CHECK_EQUAL(planar[1][(f - 1) * fs + i],
+                    roots[1]->outputs[1][i]);
+        }
+    }
+    // continuing, and starting again from an earlier frame
+    roots[0]->render_range(count + 1, 1, dst.data(), 2);
+    roots[1]->render(count + 1);
+    BOOST_CHECK(std::equal(roots[1]->outputs[0].begin(),
+            roots[1]->outputs[0].end(), planar[0].begin()));
+    roots[0]->render_range(3, 2, dst.data(), 2);
+    BOOST_CHECK_EQUAL(roots[0]->get_render_count(), 4);
+    roots[1]->reset_network();
+    roots[1]->render(3);
+    BOOST_CHECK(std::equal(roots[1]->outputs[1].begin(),
+            roots[1]->outputs[1].end(), planar[1].begin()));
+
+    // ranges of several blocks starting after 1 render larger frames, and match frame by frame, also for networks that cannot
+    for (int k=0; k < 2; ++k) {
+        GenPtr g3 = k == 0 ? roots[1]->clone() : make_seek_network(true);
+        GenPtr g4 = g3->clone();
+        g3->reset_network();
+        g4->reset_network();
+        RenderCountT start {7};
+        // several larger frames of 1024 samples
+        RenderCountT n = ((4096 / fs) * 3) + 5;
+        PIndexT outs = g3->get_output_count();
+        VVSampleT ranged(outs, VSampleT(n * fs, -1));
+        std::vector<SampleT*> dst3;
+        for (PIndexT i=0; i < outs; ++i) {
+            dst3.push_back(ranged[i].data());
+        }
+        g3->render_range(start, n, dst3.data(), outs);
+        BOOST_CHECK_EQUAL(g3->get_render_count(), start + n - 1);
+        BOOST_CHECK_EQUAL(g3->get_frame_size(), fs);
+        bool matched {true};
+        for (RenderCountT f=1; f < start + n; ++f) {
+            g4->render(f);
+            if (f < start) continue;
+            for (PIndexT i=0; i < outs; ++i) {
+                matched = matched && std::equal(g4->outputs[i].begin(),
+                        g4->outputs[i].end(),
+                        ranged[i].begin() + (f - start) * fs);
+            }
+        }
+        BOOST_CHECK(matched);
+        // outputs hold the last frame, and rendering continues
+        BOOST_CHECK(g3->outputs == g4->outputs);
+        g3->render(start + n);
+        g4->render(start + n);
+        BOOST_CHECK(g3->outputs == g4->outputs);
+    }
+
+    BOOST_REQUIRE_THROW(roots[0]->render_range(0, 1, dst.data(), 2),
+            std::invalid_argument);
+    BOOST_REQUIRE_THROW(roots[0]->render_range(1, 1, dst.data(), 1),
+            std::invalid_argument);
+    BOOST_REQUIRE_THROW(roots[0]->render_range(2,
+            std::numeric_limits<RenderCountT>::max() - 1, dst.data(), 2),
+            std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(aw_generator_seek_b) {
+    // networks with state that cannot be moved analytically are rendered frame by frame, matching a serial render
+
+    GenPtr g1 = make_seek_network(true);
+    GenPtr g2 = make_seek_network(true);
+    for (RenderCountT rc=1; rc <= 300; ++rc) {
+        g1->render(rc);
+    }
+    BOOST_CHECK_EQUAL(g2->seek(300), false);
+    BOOST_CHECK(g1->outputs[0] == g2->outputs[0]);
+    g1->render(301);
+    g2->render(301);
+    BOOST_CHECK(g1->outputs[0] == g2->outputs[0]);
+
+    // a Counter advances once per trigger, and so depends on every frame of its input
+    GenPtr g3 = Gen::make(GenID::Counter);
+    GenPtr p3 = Gen::make(GenID::Phasor);
+    p3->set_input_by_index(0, 40);
+    g3->set_input_by_index(0, p3, 1);
+    GenPtr g4 = g3->clone();
+    for (RenderCountT rc=1; rc <= 200; ++rc) {
+        g3->render(rc);
+    }
+    BOOST_CHECK_EQUAL(g4->seek(200), false);
+    BOOST_CHECK(g3->outputs[0] == g4->outputs[0]);
+    BOOST_CHECK(g3->outputs[0][0] > 10);
+    // seeking forward again continues frame by frame
+    for (RenderCountT rc=201; rc <= 350; ++rc) {
+        g3->render(rc);
+    }
+    g4->seek(350);
+    BOOST_CHECK(g3->outputs[0] == g4->outputs[0]);
+
+    // seeking to zero leaves a reset network
+    g2->seek(0);
+    BOOST_CHECK_EQUAL(g2->get_render_count(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_file_player_a) {
+    // frames are played from blocks read ahead, then silence after the end
+
+    EnvPtr e = Env::get_default_env();
+    FrameSizeT fs = e->get_common_frame_size();
+    FrameSizeT len = fs * 10 + 17;
+    VSampleT v;
+    for (FrameSizeT i=0; i < len; ++i) {
+        v.push_back(static_cast<SampleT>(i) / len);
+        v.push_back(-static_cast<SampleT>(i) / len);
+    }
+	GenPtr b1 = Gen::make(GenID::SamplesBuffer);
+    b1->set_slot_by_index(0, 2); // channels
+    b1->set_outputs_from_vector(v, 2);
+    std::string fp = e->get_fp_temp("file_player_a.aif");
+    b1->write_output_to_fp(fp);
+
+	GenPtr g1 = Gen::make(GenID::FilePlayer);
+    FilePlayerPtr p1 = std::dynamic_pointer_cast<FilePlayer>(g1);
+    BOOST_REQUIRE_THROW(g1->set_outputs(fp + ".missing"),
+            std::invalid_argument);
+    p1->set_read_ahead(4);
+    fp && g1;
+    BOOST_CHECK_EQUAL(g1->get_output_count(), 2);
+    BOOST_CHECK_EQUAL(p1->get_file_frames(), len);
+    // filled on reset
+    BOOST_CHECK_EQUAL(p1->get_buffered(), 4);
+
+    // 16 bit files are quantized
+    SampleT tol {2.0 / 32768};
+    SampleT diff {0};
+    for (RenderCountT rc=1; rc <= 11; ++rc) {
+        g1->render(rc);
+        for (FrameSizeT i=0; i < fs; ++i) {
+            FrameSizeT t = (rc - 1) * fs + i;
+            SampleT x = t < len ? v[t * 2] : 0;
+            SampleT y = t < len ? v[t * 2 + 1] : 0;
+            diff = std::max(diff, std::abs(g1->outputs[0][i] - x));
+            diff = std::max(diff, std::abs(g1->outputs[1][i] - y));
+        }
+        // give the reader time to stay ahead
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    BOOST_CHECK_SMALL(diff, tol);
+    g1->render(12);
+    BOOST_CHECK_EQUAL(g1->get_output_average(0, true), 0);
+    BOOST_CHECK_EQUAL(p1->get_underrun_count(), 0);
+
+    // seeking moves in the file
+    BOOST_CHECK(g1->seek(4));
+    BOOST_CHECK_CLOSE(g1->outputs[0][5],
+            v[(3 * fs + 5) * 2], 100 * tol / v[(3 * fs + 5) * 2]);
+    g1->render(5);
+    BOOST_CHECK_CLOSE(g1->outputs[1][0],
+            v[(4 * fs) * 2 + 1], 100 * tol / v[(4 * fs) * 2]);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_file_player_b) {
+    // a snapshot stores the position in the file, and restoring seeks to it
+    EnvPtr e = Env::get_default_env();
+    FrameSizeT fs = e->get_common_frame_size();
+    FrameSizeT len = fs * 12;
+    VSampleT v;
+    for (FrameSizeT i=0; i < len; ++i) {
+        v.push_back(static_cast<SampleT>(i % 500) / 500);
+    }
+	GenPtr b1 = Gen::make(GenID::SamplesBuffer);
+    b1->set_outputs_from_vector(v, 1);
+    std::string fp = e->get_fp_temp("file_player_b.aif");
+    b1->write_output_to_fp(fp);
+
+	GenPtr g1 = Gen::make(GenID::FilePlayer);
+    fp && g1;
+    for (RenderCountT rc=1; rc <= 3; ++rc) {
+        g1->render(rc);
+    }
+    StateBlob b = g1->snapshot_network();
+    VVSampleT expected;
+    for (RenderCountT rc=4; rc <= 6; ++rc) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        g1->render(rc);
+        expected.push_back(g1->outputs[0]);
+    }
+    g1->restore_network(b);
+    bool matched = true;
+    for (RenderCountT rc=4; rc <= 6; ++rc) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        g1->render(rc);
+        matched = matched && g1->outputs[0] == expected[rc - 4];
+    }
+    BOOST_CHECK(matched);
+    BOOST_CHECK(expected[0] != expected[1]);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_sound_file_writer_a) {
+    // many small chunks are written in order, in each format
+    EnvPtr e = Env::get_default_env();
+    FrameSizeT len = 64 * 40 + 5;
+    VSampleT v;
+    for (FrameSizeT i=0; i < len; ++i) {
+        v.push_back(static_cast<SampleT>(i % 200) / 200);
+        v.push_back(-static_cast<SampleT>(i % 300) / 300);
+    }
+    std::vector<SampleFormat> formats {SampleFormat::PCM16,
+            SampleFormat::PCM24, SampleFormat::Float32};
+    std::vector<SampleT> tols {2.0 / 32768, 2.0 / 8388608, 1e-6};
+    std::vector<std::string> names {"writer_a_16.aif", "writer_a_24.aif",
+            "writer_a_32.wav"};
+    for (std::size_t k=0; k < formats.size(); ++k) {
+        std::string fp = e->get_fp_temp(names[k]);
+        SoundFileWriter w1(fp, 2, 44100, formats[k], 64, 2);
+        BOOST_CHECK_EQUAL(w1.is_open(), true);
+        // uneven writes span chunks
+        FrameSizeT pos {0};
+        FrameSizeT n {1};
+        while (pos < len) {
+            FrameSizeT m = std::min(n, len - pos);
+            w1.write(v.data() + (pos * 2), m);
+            pos += m;
+            n = (n * 7) % 150 + 1;
+        }
+        BOOST_CHECK_EQUAL(w1.get_frames(), len);
+        w1.close();
+        BOOST_CHECK_EQUAL(w1.is_open(), false);
+        BOOST_REQUIRE_THROW(w1.write(v.data(), 1), std::invalid_argument);
+
+        GenPtr b1 = Gen::make(GenID::SamplesBuffer);
+        b1->set_slot_by_index(0, 2);
+        b1->set_outputs_from_fp(fp);
+        BOOST_CHECK_EQUAL(b1->get_frame_size(), len);
+        SampleT diff {0};
+        for (FrameSizeT i=0; i < len; ++i) {
+            diff = std::max(diff, std::abs(b1->outputs[0][i] - v[i * 2]));
+            diff = std::max(diff, std::abs(b1->outputs[1][i] - v[i * 2 + 1]));
+        }
+        BOOST_CHECK_SMALL(diff, tols[k]);
+
+        // a buffer writes through the same writer
+        std::string fp2 = e->get_fp_temp("b_" + names[k]);
+        b1->write_output_to_fp(fp2, 2, formats[k]);
+        GenPtr b2 = Gen::make(GenID::SamplesBuffer);
+        b2->set_outputs_from_fp(fp2);
+        BOOST_CHECK_EQUAL(b2->get_frame_size(), len);
+        BOOST_CHECK_CLOSE(b2->outputs[0][299], b1->outputs[1][299], .01);
+    }
+    BOOST_REQUIRE_THROW(SoundFileWriter("/no/such/dir/a.aif", 1, 44100),
+            std::invalid_argument);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_command_queue_a) {
+    // changes are applied only when drained, and replaced Gens are released on collect
+
+    GenPtr g1 = Gen::make(GenID::Add);
+    g1->set_input_by_index(0, 2);
+    CommandQueue q(2, 4);
+
+    GenPtr c1 = Gen::make(3);
+    std::weak_ptr<Gen> w1 = g1->get_input_gens_by_index(0)[0].first;
+    BOOST_CHECK(q.set_input(g1, 0, c1));
+    BOOST_REQUIRE_THROW(q.set_input(g1, 3, c1), std::invalid_argument);
+    g1->render(1);
+    BOOST_CHECK_EQUAL(g1->outputs[0][0], 2);
+
+    BOOST_CHECK_EQUAL(q.drain(), 1);
+    g1->render(2);
+    BOOST_CHECK_EQUAL(g1->outputs[0][0], 3);
+    // the replaced Constant is held until collected
+    BOOST_CHECK_EQUAL(w1.expired(), false);
+    BOOST_CHECK_EQUAL(q.collect(), 1);
+    BOOST_CHECK_EQUAL(w1.expired(), true);
+
+    BOOST_CHECK(q.add_input(g1, 0, 4));
+    BOOST_CHECK(q.add_input(g1, 0, 5));
+    // full until collected
+    BOOST_CHECK_EQUAL(q.add_input(g1, 0, 6), false);
+    BOOST_CHECK_EQUAL(q.drain(), 2);
+    g1->render(3);
+    BOOST_CHECK_EQUAL(g1->outputs[0][0], 12);
+    BOOST_CHECK_EQUAL(g1->get_input_gens_by_index(0).size(), 3);
+
+    // exceeding the add reserve is rejected, not allocated
+    BOOST_CHECK(q.add_input(g1, 0, 1));
+    BOOST_CHECK(q.add_input(g1, 0, 1));
+    q.drain();
+    q.collect();
+    BOOST_CHECK_EQUAL(q.get_rejected(), 0);
+    BOOST_CHECK(q.add_input(g1, 0, 1));
+    q.drain();
+    q.collect();
+    BOOST_CHECK_EQUAL(q.get_rejected(), 1);
+    BOOST_CHECK_EQUAL(g1->get_input_gens_by_index(0).size(), 5);
+    BOOST_CHECK_EQUAL(q.get_in_flight(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_command_queue_b) {
+    // slots, and a control thread posting while a render thread drains
+
+    GenPtr g1 = Gen::make(GenID::Sine);
+    CommandQueue q(8);
+    BOOST_CHECK(q.set_slot(g1, 0, 2));
+    // a value slot is read when applied, so only a Constant is accepted, and is checked when posted
+    BOOST_REQUIRE_THROW(q.set_slot(g1, 0, Gen::make(GenID::Sine)),
+            std::invalid_argument);
+    BOOST_REQUIRE_THROW(q.set_slot(g1, 0, GenPtr()), std::invalid_argument);
+    BOOST_REQUIRE_THROW(q.set_slot(g1, 1, 2), std::invalid_argument);
+    BOOST_CHECK_EQUAL(q.get_in_flight(), 1);
+    q.drain();
+    BOOST_CHECK_EQUAL(g1->get_slot_gen_at_index(0)->outputs[0][0], 2);
+    q.collect();
+
+    GenPtr g2 = Gen::make(GenID::Add);
+    g2->set_input_by_index(0, 0);
+    const int count {2000};
+    std::thread control([&](){
+        int posted {0};
+        while (posted < count) {
+            if (q.set_input(g2, 0, posted + 1)) {
+                ++posted;
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    RenderCountT rc {1};
+    SampleT last {0};
+    bool ordered {true};
+    while (last < count) {
+        q.drain();
+        g2->render(rc++);
+        if (g2->outputs[0][0] < last) ordered = false;
+        last = g2->outputs[0][0];
+    }
+    control.join();
+    q.collect();
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_EQUAL(last, count);
+    BOOST_CHECK_EQUAL(q.get_in_flight(), 0);
+}
@@ -0,0 +1,210 @@
+// g++-4.7 -std=c++11 -I ../src  aw_performer_nrt_test.cpp ../src/aw_performer_nrt.cpp ../src/aw_generator.cpp ../src/aw_common.cpp ../src/aw_illustration.cpp -DSTAND_ALONE -l boost_unit_test_framework -l boost_filesystem -l boost_system -l sndfile -pthread -Wall -g -o aw_performer_nrt_test
+
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+#include <thread>
+
+#include "aw_common.h"
+#include "aw_generator.h"
+#include "aw_performer_nrt.h"
+
+using namespace aw;
+
+
+BOOST_AUTO_TEST_CASE(aw_performer_nrt_a) {
+    // start and duration in samples need not align with frames
+
+    // a counter triggered every sample counts samples
+    GenPtr c1 = Gen::make(GenID::Counter);
+    c1->set_input_by_index(0, 1);
+    GenPtr g1 = Gen::make(GenID::Add);
+    g1->set_input_by_index(0, c1);
+
+    std::shared_ptr<VectorSink> s1 = std::make_shared<VectorSink>();
+    NRTPerformer p1(g1, s1);
+
+    BOOST_CHECK_EQUAL(p1.render_samples(0, 300), 300);
+    BOOST_CHECK_EQUAL(s1->channels, 1);
+    BOOST_CHECK_EQUAL(s1->samples.size(), 300);
+    VSampleT all(s1->samples);
+    BOOST_CHECK_EQUAL(all[299] - all[200], 99);
+
+    // the root is reset for each performance
+    BOOST_CHECK_EQUAL(p1.render_samples(70, 200), 200);
+    BOOST_CHECK_EQUAL(s1->samples.size(), 200);
+    BOOST_CHECK_EQUAL(s1->samples[0], all[70]);
+    BOOST_CHECK_EQUAL(s1->samples[199], all[269]);
+    BOOST_CHECK_EQUAL(p1.get_frames_written(), 200);
+    FrameSizeT fs = g1->get_frame_size();
+    BOOST_CHECK_EQUAL(p1.get_frames_rendered(), ((270 / fs) + 1) * fs);
+    BOOST_CHECK(p1.get_realtime_factor() > 0);
+    BOOST_CHECK(p1.get_throughput() > 0);
+
+    BOOST_CHECK_EQUAL(p1.render_samples(10, 0), 0);
+    BOOST_CHECK_EQUAL(s1->samples.size(), 0);
+
+    BOOST_REQUIRE_THROW(p1.render_seconds(-1, 1), std::invalid_argument);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_performer_nrt_b) {
+    // seconds, multiple channels, and stopping from another thread
+
+    GenPtr g1 = Gen::make(GenID::Panner);
+    g1->set_input_by_index(0, 1);
+    g1->set_input_by_index(1, 0);
+    std::shared_ptr<VectorSink> s1 = std::make_shared<VectorSink>();
+    NRTPerformer p1(g1, s1);
+
+    OutputsSizeT sr = g1->get_sampling_rate();
+    BOOST_CHECK_EQUAL(p1(.5), sr / 2);
+    BOOST_CHECK_EQUAL(s1->channels, 2);
+    BOOST_CHECK_EQUAL(s1->samples.size(), sr);
+    BOOST_CHECK_CLOSE(s1->samples[0], g1->outputs[0][0], .0001);
+    BOOST_CHECK_CLOSE(s1->samples[1], g1->outputs[1][0], .0001);
+
+    // an hour is not rendered if stopped
+    std::thread t([&](){
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        p1.stop();
+    });
+    SampleTimeT written = p1.render_seconds(0, 3600);
+    t.join();
+    BOOST_CHECK(written < SampleTimeT(3600) * sr);
+    BOOST_CHECK_EQUAL(written, p1.get_frames_written());
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_performer_nrt_c) {
+    // writing to a file in bounded memory
+
+    EnvPtr e = Env::get_default_env();
+    std::string fp = e->get_fp_temp("aw_performer_nrt_test.aif");
+    GenPtr g1 = Gen::make(GenID::Sine);
+    g1->set_input_by_index(0, 220);
+    NRTPerformer p1(g1, std::make_shared<FileSink>(fp));
+    BOOST_CHECK_EQUAL(p1(1), g1->get_sampling_rate());
+
+    GenPtr g2 = Gen::make(GenID::SamplesBuffer);
+    g2->set_outputs_from_fp(fp);
+    BOOST_CHECK_EQUAL(g2->get_frame_size(), g1->get_sampling_rate());
+
+    // float samples, in a longer render than the writer holds
+    std::string fp2 = e->get_fp_temp("aw_performer_nrt_test.wav");
+    NRTPerformer p2(g1, std::make_shared<FileSink>(fp2,
+            SampleFormat::Float32));
+    BOOST_CHECK_EQUAL(p2(3), g1->get_sampling_rate() * 3);
+    GenPtr g3 = Gen::make(GenID::SamplesBuffer);
+    g3->set_outputs_from_fp(fp2);
+    BOOST_CHECK_EQUAL(g3->get_frame_size(), g1->get_sampling_rate() * 3);
+    BOOST_CHECK_CLOSE(g3->get_output_average(0, true),
+            2 / 3.14159265, 1);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_performer_nrt_parallel_a) {
+    // segments are stitched sample-exactly, and start from the state of a serial render
+
+    FrameSizeT fs = Env::get_default_env()->get_common_frame_size();
+    // a counter triggered every sample has state depending on all history
+    GenFactoryT f1 = [](){
+        GenPtr c1 = Gen::make(GenID::Counter);
+        c1->set_input_by_index(0, 1);
+        GenPtr g1 = Gen::make(GenID::Panner);
+        g1->set_input_by_index(0, c1);
+        g1->set_input_by_index(1, .25);
+        return g1;
+    };
+    std::shared_ptr<VectorSink> s1 = std::make_shared<VectorSink>();
+    NRTPerformer p1(f1(), s1);
+    p1.render_samples(30, fs * 40);
+
+    // a Counter cannot seek analytically: segments restore checkpoints
+    BOOST_CHECK(!f1()->can_seek_analytically());
+    std::shared_ptr<VectorSink> s2 = std::make_shared<VectorSink>();
+    NRTParallelPerformer p2(f1, s2, 4);
+    p2.set_segment_size(fs * 3 + 1); // rounded up to 4 frames
+    p2.set_verify(true);
+    BOOST_CHECK_EQUAL(p2.render_samples(30, fs * 40), fs * 40);
+    BOOST_CHECK_EQUAL(p2.get_max_difference(), 0);
+    BOOST_CHECK(s1->samples == s2->samples);
+    BOOST_CHECK(p2.get_realtime_factor() > 0);
+
+    // a pre-roll that reaches back to the start is also exact
+    std::shared_ptr<VectorSink> s4 = std::make_shared<VectorSink>();
+    NRTParallelPerformer p4(f1, s4, 4);
+    p4.set_segment_size(fs * 4);
+    p4.set_pre_roll(fs * 50);
+    p4.set_verify(true);
+    BOOST_CHECK_EQUAL(p4.render_samples(30, fs * 40), fs * 40);
+    BOOST_CHECK_EQUAL(p4.get_max_difference(), 0);
+    BOOST_CHECK(s1->samples == s4->samples);
+
+    // a shorter pre-roll renders in parallel, and verify reports that counts restart
+    p4.set_pre_roll(fs * 2);
+    BOOST_CHECK_EQUAL(p4.render_samples(30, fs * 40), fs * 40);
+    BOOST_CHECK(p4.get_max_difference() > 0);
+    // the first segment starts at the beginning, and matches
+    BOOST_CHECK(p4.get_first_difference() >= fs * 4 - 30);
+    BOOST_CHECK_EQUAL(s4->samples.size(), s1->samples.size());
+
+    // an envelope cycling from a phasor carries state across segments
+    GenFactoryT f2 = [](){
+        GenPtr ph = Gen::make(GenID::Phasor);
+        ph->set_input_by_index(0, 30);
+        GenPtr ad = Gen::make(GenID::AttackDecay);
+        ad->set_input_by_index(0, ph, 1);
+        ad->set_input_by_index(1, .003);
+        ad->set_input_by_index(2, .011);
+        return ad;
+    };
+    std::shared_ptr<VectorSink> s3 = std::make_shared<VectorSink>();
+    NRTParallelPerformer p3(f2, s3, 3);
+    p3.set_segment_size(fs * 5 + 3);
+    p3.set_verify(true);
+    BOOST_CHECK_EQUAL(p3.render_samples(7, fs * 60), fs * 60);
+    BOOST_CHECK_EQUAL(p3.get_max_difference(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_performer_nrt_parallel_b) {
+    // a graph without history is exact with no pre-roll
+
+    FrameSizeT fs = Env::get_default_env()->get_common_frame_size();
+    GenFactoryT f1 = [](){
+        GenPtr g1 = Gen::make(GenID::Multiply);
+        g1->set_input_by_index(0, 3);
+        g1->add_input_by_index(0, .5);
+        return g1;
+    };
+    std::shared_ptr<VectorSink> s1 = std::make_shared<VectorSink>();
+    NRTParallelPerformer p1(f1, s1);
+    p1.set_segment_size(fs);
+    p1.set_verify(true);
+    BOOST_CHECK_EQUAL(p1.render_samples(0, fs * 100 + 7), fs * 100 + 7);
+    BOOST_CHECK_EQUAL(p1.get_max_difference(), 0);
+    BOOST_CHECK_EQUAL(s1->samples.size(), fs * 100 + 7);
+    BOOST_CHECK_EQUAL(s1->samples[fs * 100 + 6], 1.5);
+
+    BOOST_CHECK_EQUAL(p1.render_samples(0, 0), 0);
+
+    // a Sine with constant inputs seeks analytically, matching within rounding
+    GenFactoryT f2 = [](){
+        GenPtr g1 = Gen::make(GenID::Sine);
+        g1->set_input_by_index(0, 331);
+        return g1;
+    };
+    BOOST_CHECK(f2()->can_seek_analytically());
+    std::shared_ptr<VectorSink> s2 = std::make_shared<VectorSink>();
+    NRTParallelPerformer p2(f2, s2, 2);
+    p2.set_segment_size(fs * 7);
+    p2.set_verify(true);
+    BOOST_CHECK_EQUAL(p2.render_samples(0, fs * 50), fs * 50);
+    BOOST_CHECK(p2.get_max_difference() < 1e-9);
+}
@@ -0,0 +1,231 @@
+// g++-4.7 -std=c++11 -I ../src  aw_scheduler_test.cpp ../src/aw_scheduler.cpp ../src/aw_generator.cpp ../src/aw_common.cpp ../src/aw_illustration.cpp -DSTAND_ALONE -l boost_unit_test_framework -l boost_filesystem -l boost_system -l sndfile -pthread -Wall -g -o aw_scheduler_test
+
+
+#define BOOST_TEST_DYN_LINK
+#ifdef STAND_ALONE
+#   define BOOST_TEST_MODULE main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+#include <thread>
+
+#include "aw_common.h"
+#include "aw_generator.h"
+#include "aw_scheduler.h"
+
+using namespace aw;
+
+
+BOOST_AUTO_TEST_CASE(aw_scheduler_a) {
+    // value changes land on exact samples within a frame
+
+    EnvPtr e = Env::get_default_env();
+    FrameSizeT fs = e->get_common_frame_size();
+
+    GenPtr g1 = Gen::make(GenID::Add);
+    Scheduler s(e, 16);
+    PIndexT t = s.add_target(g1, 0, 3);
+    BOOST_CHECK_EQUAL(s.get_target_gen(t)->outputs[0][0], 3);
+    BOOST_REQUIRE_THROW(s.add_target(g1, 4, 0), std::invalid_argument);
+
+    BOOST_CHECK(s.schedule_value(10, t, 5));
+    BOOST_CHECK(s.schedule_value(fs + 20, t, 7));
+    BOOST_CHECK_EQUAL(s.get_pending(), 2);
+
+    s.render(g1, 1);
+    BOOST_CHECK_EQUAL(g1->outputs[0][9], 3);
+    BOOST_CHECK_EQUAL(g1->outputs[0][10], 5);
+    BOOST_CHECK_EQUAL(g1->outputs[0][fs-1], 5);
+    BOOST_CHECK_EQUAL(s.get_pending(), 1);
+
+    s.render(g1, 2);
+    BOOST_CHECK_EQUAL(g1->outputs[0][0], 5);
+    BOOST_CHECK_EQUAL(g1->outputs[0][19], 5);
+    BOOST_CHECK_EQUAL(g1->outputs[0][20], 7);
+    BOOST_CHECK_EQUAL(s.get_pending(), 0);
+
+    // value persists without further events
+    s.render(g1, 3);
+    BOOST_CHECK_EQUAL(g1->outputs[0][0], 7);
+
+    // events in the past are delivered at the start of the next frame
+    BOOST_CHECK(s.schedule_value(0, t, 1));
+    s.render(g1, 4);
+    BOOST_CHECK_EQUAL(g1->outputs[0][0], 1);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_scheduler_b) {
+    // triggers are single samples, and read by Gens that consume events
+
+    EnvPtr e = Env::get_default_env();
+    FrameSizeT fs = e->get_common_frame_size();
+
+    GenPtr c1 = Gen::make(GenID::Counter);
+    Scheduler s(e);
+    PIndexT t = s.add_target(c1, 0); // trigger input
+
+    s.schedule_trigger(5, t);
+    s.schedule_trigger(fs + 1, t);
+    // far in the future, through all levels of the wheel
+    s.schedule_trigger(fs * 2000 + 3, t);
+
+    s.render(c1, 1);
+    BOOST_CHECK_EQUAL(c1->outputs[0][4], 0);
+    BOOST_CHECK_EQUAL(c1->outputs[0][5], 1);
+    BOOST_CHECK_EQUAL(s.get_target_gen(t)->outputs[0][5], 1);
+    BOOST_CHECK_EQUAL(s.get_target_gen(t)->outputs[0][6], 0);
+
+    s.render(c1, 2);
+    BOOST_CHECK_EQUAL(c1->outputs[0][0], 1);
+    BOOST_CHECK_EQUAL(c1->outputs[0][1], 2);
+    // the trigger of the previous frame is restored
+    BOOST_CHECK_EQUAL(s.get_target_gen(t)->outputs[0][1], 1);
+    BOOST_CHECK_EQUAL(s.get_target_gen(t)->outputs[0][5], 0);
+
+    for (RenderCountT rc=3; rc <= 2001; ++rc) {
+        s.render(c1, rc);
+    }
+    BOOST_CHECK_EQUAL(c1->outputs[0][2], 2);
+    BOOST_CHECK_EQUAL(c1->outputs[0][3], 3);
+    BOOST_CHECK_EQUAL(s.get_pending(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_scheduler_c) {
+    // order, pool exhaustion, and many events across wheel levels
+
+    EnvPtr e = Env::get_default_env();
+    GenPtr g1 = Gen::make(GenID::Add);
+    Scheduler s(e, 4);
+    PIndexT t = s.add_target(g1, 0);
+
+    // same sample: last scheduled wins
+    BOOST_CHECK(s.schedule_value(3, t, 1));
+    BOOST_CHECK(s.schedule_value(3, t, 2));
+    BOOST_CHECK(s.schedule_value(70000, t, 9));
+    BOOST_CHECK(s.schedule_value(20000000, t, 11));
+    BOOST_CHECK_EQUAL(s.schedule_value(4, t, 0), false);
+    BOOST_CHECK_EQUAL(s.get_available(), 0);
+
+    s.render(g1, 1);
+    BOOST_CHECK_EQUAL(g1->outputs[0][3], 2);
+
+    FrameSizeT fs = e->get_common_frame_size();
+    RenderCountT rc_a = (70000 / fs) + 1;
+    for (RenderCountT rc=2; rc <= rc_a; ++rc) {
+        s.render(g1, rc);
+    }
+    BOOST_CHECK_EQUAL(g1->outputs[0][70000 % fs], 9);
+    BOOST_CHECK_EQUAL(g1->outputs[0][(70000 % fs) - 1], 2);
+
+    // skipping frames delivers at the start of the frame requested
+    s.render(g1, (20000000 / fs) + 10);
+    BOOST_CHECK_EQUAL(g1->outputs[0][0], 11);
+    BOOST_CHECK_EQUAL(s.get_available(), 4);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_scheduler_d) {
+    // events posted from a control thread are received at the next block
+
+    EnvPtr e = Env::get_default_env();
+    FrameSizeT fs = e->get_common_frame_size();
+    GenPtr g1 = Gen::make(GenID::Add);
+    Scheduler s1(e, 2, 4);
+    PIndexT t = s1.add_target(g1, 0);
+    BOOST_REQUIRE_THROW(s1.post_value(0, 1, 1), std::invalid_argument);
+
+    BOOST_CHECK(s1.post_value(5, t, 1));
+    BOOST_CHECK(s1.post_value(6, t, 2));
+    BOOST_CHECK(s1.post_value(7, t, 3));
+    BOOST_CHECK(s1.post_trigger(8, t));
+    BOOST_CHECK_EQUAL(s1.post_value(9, t, 4), false);
+    // nothing is in the wheel until received by deliver()
+    BOOST_CHECK_EQUAL(s1.get_pending(), 0);
+    s1.render(g1, 1);
+    // the pool holds two; the rest are dropped
+    BOOST_CHECK_EQUAL(g1->outputs[0][5], 1);
+    BOOST_CHECK_EQUAL(g1->outputs[0][6], 2);
+    BOOST_CHECK_EQUAL(g1->outputs[0][7], 2);
+    BOOST_CHECK_EQUAL(s1.get_dropped(), 2);
+    s1.reset();
+    BOOST_CHECK_EQUAL(s1.get_dropped(), 0);
+
+    GenPtr g2 = Gen::make(GenID::Add);
+    const int count {2000};
+    // the pool must hold every event posted ahead of rendering
+    Scheduler s2(e, count, 8);
+    t = s2.add_target(g2, 0);
+    std::thread control([&](){
+        int posted {0};
+        while (posted < count) {
+            // events already passed are received at the start of the next block
+            if (s2.post_value((posted + 1) * fs, t, posted + 1)) {
+                ++posted;
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    RenderCountT rc {1};
+    SampleT last {0};
+    bool ordered {true};
+    while (last < count) {
+        s2.render(g2, rc++);
+        for (FrameSizeT i=0; i < fs; ++i) {
+            if (g2->outputs[0][i] < last) ordered = false;
+            last = g2->outputs[0][i];
+        }
+        // give the control thread time to post
+        std::this_thread::yield();
+    }
+    control.join();
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_EQUAL(last, count);
+    BOOST_CHECK_EQUAL(s2.get_dropped(), 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(aw_scheduler_e) {
+    // skipping frames to events far apart, across every level and the overflow, and the scheduler of an Env
+
+    EnvPtr e = Env::get_default_env();
+    FrameSizeT fs = e->get_common_frame_size();
+    GenPtr g1 = Gen::make(GenID::Add);
+    SchedulerPtr s = Scheduler::get_env_scheduler(e);
+    BOOST_CHECK_EQUAL(s, Scheduler::get_env_scheduler(e));
+    PIndexT t = s->add_target(g1, 0);
+
+    std::vector<SampleTimeT> times {5, 300, 70000, 70000 + (fs * 3) + 1,
+            // 40 minutes at 44.1k, as after seeking
+            (44100ULL * 60 * 40) + 17,
+            (SampleTimeT(1) << 32) + 100,
+            (SampleTimeT(1) << 33) + 3};
+    for (std::size_t i=0; i < times.size(); ++i) {
+        BOOST_CHECK(s->schedule_value(times[i], t, i + 1));
+    }
+    // render only the frames with events; each is delivered at its sample
+    for (std::size_t i=0; i < times.size(); ++i) {
+        s->render(g1, (times[i] / fs) + 1);
+        BOOST_CHECK_EQUAL(g1->outputs[0][times[i] % fs], i + 1);
+        if (times[i] % fs > 0) {
+            BOOST_CHECK_EQUAL(g1->outputs[0][(times[i] % fs) - 1], i);
+        }
+        BOOST_CHECK_EQUAL(s->get_pending(), times.size() - i - 1);
+    }
+    BOOST_CHECK_EQUAL(s->get_now(), ((times.back() / fs) + 1) * fs);
+
+    // another Env has its own scheduler
+    BOOST_CHECK(s != Scheduler::get_env_scheduler(
+            Env::make_with_frame_size(32)));
+    // a new scheduler is created once no caller holds the previous
+    std::weak_ptr<Scheduler> w(s);
+    s = nullptr;
+    BOOST_CHECK(w.expired());
+    s = Scheduler::get_env_scheduler(e);
+    BOOST_CHECK_EQUAL(s->get_now(), 0);
+    BOOST_REQUIRE_THROW(s->get_target_gen(0), std::invalid_argument);
+}